@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "rlib.h"
+#include "cvec.h"
+
+/*
+ * Per access cost of rlib's Array against the typed ObjPtrVec, both holding
+ * pointers the way rtblockArray does. Best of BENCH_RUNS, in ns per op.
+ */
+
+#define BENCH_OPS  100000000
+#define BENCH_RUNS 5
+#define BENCH_LEN  64
+
+static char s_objs[BENCH_LEN]; // stand ins, only their addresses are stored
+static void* volatile s_sink;
+
+static double nsPerOp(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / BENCH_OPS;
+}
+
+static double arrayPushPop()
+{
+    Array a;
+    ARR_INIT(&a, Obj*);
+    Obj* obj = (Obj*)s_objs;
+    Obj* out = NULL;
+
+    clock_t start = clock();
+    for (size_t i = 0; i < BENCH_OPS; i++)
+    {
+        array_push(&a, &obj);
+        array_pop(&a, &out);
+    }
+    double ns = nsPerOp(start);
+
+    s_sink = out;
+    array_free(&a);
+    return ns;
+}
+
+static double vecPushPop()
+{
+    ObjPtrVec v;
+    objvec_init(&v);
+    Obj* obj = (Obj*)s_objs;
+    Obj* out = NULL;
+
+    clock_t start = clock();
+    for (size_t i = 0; i < BENCH_OPS; i++)
+    {
+        objvec_push(&v, obj);
+        out = objvec_pop(&v);
+        s_sink = out;
+    }
+    double ns = nsPerOp(start);
+
+    objvec_free(&v);
+    return ns;
+}
+
+static double arrayGet()
+{
+    Array a;
+    ARR_INIT(&a, Obj*);
+    for (size_t i = 0; i < BENCH_LEN; i++)
+    {
+        Obj* obj = (Obj*)&s_objs[i];
+        array_push(&a, &obj);
+    }
+    Obj* out = NULL;
+
+    clock_t start = clock();
+    for (size_t i = 0; i < BENCH_OPS; i++)
+    {
+        array_get(&a, i % BENCH_LEN, &out);
+        s_sink = out;
+    }
+    double ns = nsPerOp(start);
+
+    array_free(&a);
+    return ns;
+}
+
+static double vecGet()
+{
+    ObjPtrVec v;
+    objvec_init(&v);
+    for (size_t i = 0; i < BENCH_LEN; i++)
+        objvec_push(&v, (Obj*)&s_objs[i]);
+
+    clock_t start = clock();
+    for (size_t i = 0; i < BENCH_OPS; i++)
+        s_sink = objvec_get(&v, i % BENCH_LEN);
+    double ns = nsPerOp(start);
+
+    objvec_free(&v);
+    return ns;
+}
+
+static double best(double (*bench)())
+{
+    double ret = bench();
+    for (int i = 1; i < BENCH_RUNS; i++)
+    {
+        double ns = bench();
+        if (ns < ret)
+            ret = ns;
+    }
+    return ret;
+}
+
+int main()
+{
+    printf("push+pop   Array %.2f ns   ObjPtrVec %.2f ns\n", best(arrayPushPop), best(vecPushPop));
+    printf("get        Array %.2f ns   ObjPtrVec %.2f ns\n", best(arrayGet), best(vecGet));
+
+    return 0;
+}
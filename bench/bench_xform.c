@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "clisp.h"
+
+/*
+ * Sums (map +) -> (filter number?) -> (map +) over a 100k vector, once
+ * through nested lazy seqs and once through transduce. The stages are
+ * builtins, so closure calls don't add their envs to the count. The gc is
+ * held off, every obj a pipeline allocates is still in the heap to be counted.
+ */
+
+static void countObj(void* ctx, Obj* obj)
+{
+    (void)obj;
+    (*(size_t*)ctx)++;
+}
+
+static size_t objCount(VM* vm)
+{
+    size_t count = 0;
+    cheap_forEachObj(&vm->heap, countObj, &count);
+    return count;
+}
+
+static void run(VM* vm, const char* name, const char* input)
+{
+    size_t objs = objCount(vm);
+    size_t bytes = vm->bytesAllocatedTotal;
+    clock_t start = clock();
+
+    const char* ret = vm_rep(vm, input);
+
+    double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%-18s %8zu objs %10zu bytes %8.3fs  = %s\n",
+           name, objCount(vm) - objs, vm->bytesAllocatedTotal - bytes, secs, ret);
+}
+
+int main()
+{
+    rlog_setLevel(RLOG_ERROR);
+
+    VMConfig config;
+    vm_defaultConfig(&config);
+    config.gcMinHeap = (size_t)1 << 40;
+
+    VM* vm = vm_createWithConfig(&config);
+
+    vm_rep(vm, "(do (def! xs (into [] (range 100000))) nil)");
+
+    run(vm, "nested lazy seqs", "(reduce + 0 (map + (filter number? (map + xs))))");
+    run(vm, "transduce", "(transduce (comp (map +) (filter number?) (map +)) + 0 xs)");
+
+    vm_free(vm);
+
+    return 0;
+}
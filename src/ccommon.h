@@ -15,9 +15,6 @@ typedef struct sValue Value;
 typedef struct sObj Obj;
 typedef struct sExceptionObj ExceptionObj;
 
-typedef Array ValueArray;
-typedef Array ObjPtrArray;
-
 typedef Value (*FuncPtr)(VM* vm, int len, Value* params, ExceptionObj** exception);
 
 typedef enum ErrorCode
@@ -41,9 +38,9 @@ typedef enum ErrorCode
 #define VECTOR_GET_CHILD(vobj, index, varName) \
     Value varName; \
     vectorobj_get((vobj), (index), &varName)
-#define VALUE_ARR_GET_CHILD(arr, index, varName) \
+#define LISTLIKE_GET_CHILD(v, index, varName) \
     Value varName; \
-    array_get((arr), index, &varName);
+    value_listLikeGet((v), (index), &varName)
 
 #define DEF_FUNC(funcName) \
     static Value funcName(VM* vm, int len, Value* params, ExceptionObj** exception)
@@ -91,6 +88,24 @@ typedef enum ErrorCode
     } while (false)
 #endif
 
+/**
+ * VM_SPUSH/VM_SPOP guard objects which stay referenced from C locals while
+ * they are in use. With GC_SCAN_STACK the collector finds them on the C stack,
+ * so these compile to nothing. Objects only referenced from malloc'd memory
+ * (e.g. a list payload) still need VM_PUSH/VM_POP.
+ */
+#ifdef GC_SCAN_STACK
+#define VM_SPUSH(obj)  ((void)0)
+#define VM_SPUSHV(val) ((void)0)
+#define VM_SPOP(obj)   ((void)0)
+#define VM_SPOPV(val)  ((void)0)
+#else
+#define VM_SPUSH(obj)  VM_PUSH(obj)
+#define VM_SPUSHV(val) VM_PUSHV(val)
+#define VM_SPOP(obj)   VM_POP(obj)
+#define VM_SPOPV(val)  VM_POPV(val)
+#endif
+
 /* ----- Platform ----- */
 #if defined(WIN32) || defined(_WIN32)
     #define C_WINDOWS 1
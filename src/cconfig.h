@@ -2,7 +2,20 @@
 #define __C_CONFIG_H_
 
 #define STACK_MAX_DEPTH     1024
-#define LIST_MAX_ITEM_COUNT 256
 #define TO_STR_BUFF_COUNT   1024
+#define ROPE_LEAF_MAX       128 // concats up to this long are copied flat
+#define ROPE_MAX_DEPTH      48  // deeper ropes are flattened
+#define STR_VIEW_MIN        16  // shorter substrings are copied instead of viewed
+
+#define GC_MIN_HEAP        (4 * 1024 * 1024) // never collect while less than this is allocated
+#define GC_MAX_HEAP        0                 // soft cap of the gc trigger, 0 for no cap
+#define GC_HEAP_LIMIT      0                 // hard cap of the heap, 0 for no cap
+#define GC_TARGET_PERCENT  10.0f             // share of cpu time the collector aims to use
+#define GC_MIN_GROWTH      0.25f             // headroom over the live size after a gc, as a factor of it
+#define GC_MAX_GROWTH      8.0f
+#define GC_INIT_GROWTH     1.0f
+
+#define GC_COMPACT_FRAGMENTATION 0.5f // free share of small object pages which requests compaction
+#define GC_COMPACT_MIN_PAGES     16   // smaller heaps are never compacted automatically
 
 #endif // __C_CONFIG_H_
\ No newline at end of file
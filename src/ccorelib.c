@@ -1,5 +1,8 @@
 #include "ccorelib.h"
 
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
 #include <time.h>
 
 #include "creader.h"
@@ -31,6 +34,9 @@
 
 DEF_FUNC(plusFunc)
 {
+    if (len == 0)
+        return value_num(0);
+
     double ret = value_asNum(FIRST_VAL);
     for (size_t i = 1; i < len; i++)
         ret += value_asNum(params[i]);
@@ -49,6 +55,9 @@ DEF_FUNC(subFunc)
 
 DEF_FUNC(mulFunc)
 {
+    if (len == 0)
+        return value_num(1);
+
     double ret = value_asNum(FIRST_VAL);
     for (size_t i = 1; i < len; i++)
         ret *= value_asNum(params[i]);
@@ -170,100 +179,184 @@ DEF_FUNC(greatEqFunc)
 }
 
 /* ----- string ----- */
-DEF_FUNC(prStrFunc)
+
+/* printing and comparing see every item, lazy seqs among the params get realized */
+static bool realizeParams(VM* vm, int len, Value* params, ExceptionObj** exception)
 {
-    // TODO opt Array to StringBuilder
-    Array ca;
-    ARR_INIT_CAP(&ca, char, 256);
+    for (int i = 0; i < len; i++)
+    {
+        if (!value_realize(vm, params[i], exception))
+            return false;
+    }
 
-    StrObj* s = NULL;
+    return true;
+}
 
-    char whitespace = ' ';
-    for (int i = 0; i < len - 1; i++)
+/* keys hash by their items, so params[from], params[from + step]... get realized, values stay lazy */
+static bool realizeKeys(VM* vm, int len, Value* params, int from, int step, ExceptionObj** exception)
+{
+    for (int i = from; i < len; i += step)
     {
-        s = printReadablyStr(vm, params[i]);
-        if (s)
-        {
-            for (size_t j = 0; j < s->length; j++)
-            {
-                array_push(&ca, &s->chars[j]);
-            }
-        }
-
-        array_push(&ca, &whitespace);
+        if (!value_realize(vm, params[i], exception))
+            return false;
     }
 
-    s = printReadablyStr(vm, params[len - 1]);
-    if (s)
+    return true;
+}
+
+/**
+ * Builds a string from pieces: short ones gather in buff and join the rope
+ * a leaf at a time, long ones and ropes join it as they are. The rope so
+ * far sits in box, which stays on the rt stack from init to finish.
+ */
+typedef struct
+{
+    AtomObj* box;
+    char     buff[ROPE_LEAF_MAX];
+    int      count;
+} StrBuilder;
+
+static void builderInit(VM* vm, StrBuilder* b)
+{
+    b->box = atomobj_new(vm, value_nil());
+    b->count = 0;
+    VM_PUSH(b->box);
+}
+
+/* s must be reachable by the gc */
+static void builderJoin(VM* vm, StrBuilder* b, StrObj* s)
+{
+    Value acc = b->box->ref;
+    StrObj* ret = value_isNil(acc) ? s : strobj_concat(vm, value_asStr(acc), s);
+
+    b->box->ref = value_obj(ret);
+    CWRITE_BARRIER(vm, b->box);
+}
+
+static void builderFlush(VM* vm, StrBuilder* b)
+{
+    if (b->count == 0)
+        return;
+
+    StrObj* leaf = strobj_copy(vm, b->buff, b->count);
+    b->count = 0;
+
+    VM_SPUSH(leaf);
+    builderJoin(vm, b, leaf);
+    VM_SPOP(leaf);
+}
+
+/* chars must stay put while the builder allocates, length at most ROPE_LEAF_MAX */
+static void builderAppendChars(VM* vm, StrBuilder* b, const char* chars, int length)
+{
+    if (b->count + length > ROPE_LEAF_MAX)
+        builderFlush(vm, b);
+
+    memcpy(b->buff + b->count, chars, length);
+    b->count += length;
+}
+
+static void builderAppend(VM* vm, StrBuilder* b, StrObj* s)
+{
+    VM_SPUSH(s);
+    if (!strobj_isRope(s) && s->length <= ROPE_LEAF_MAX)
     {
-        for (size_t j = 0; j < s->length; j++)
-        {
-            array_push(&ca, &s->chars[j]);
-        }
+        builderAppendChars(vm, b, strobj_leafChars(s), s->length);
     }
+    else
+    {
+        builderFlush(vm, b);
+        builderJoin(vm, b, s);
+    }
+    VM_SPOP(s);
+}
 
-    Value ret = value_str(vm, (char*)ca.data, ca.count);
-
-    array_free(&ca);
+static StrObj* builderFinish(VM* vm, StrBuilder* b)
+{
+    StrObj* ret = NULL;
+    if (value_isNil(b->box->ref))
+    {
+        ret = strobj_copy(vm, b->buff, b->count);
+    }
+    else
+    {
+        builderFlush(vm, b);
+        ret = value_asStr(b->box->ref);
+    }
 
+    VM_POP(b->box);
     return ret;
 }
 
-DEF_FUNC(strFunc)
+/* concatenates the printed params, sep between them if not NULL */
+static StrObj* concatPrinted(VM* vm, int len, Value* params, bool readably, const char* sep)
 {
-    // TODO opt Array to StringBuilder
-    Array ca;
-    ARR_INIT_CAP(&ca, char, 256);
-
-    StrObj* s = NULL;
+    StrBuilder b;
+    builderInit(vm, &b);
 
     for (int i = 0; i < len; i++)
     {
-        s = printRawStr(vm, params[i]);
+        if (sep && i > 0)
+            builderAppendChars(vm, &b, sep, (int)strlen(sep));
+
+        StrObj* s = printStr(vm, params[i], readably);
         if (s)
-        {
-            for (size_t j = 0; j < s->length; j++)
-            {
-                array_push(&ca, &s->chars[j]);
-            }
-        }
+            builderAppend(vm, &b, s);
     }
 
-    Value ret = value_str(vm, (char*)ca.data, ca.count);
+    return builderFinish(vm, &b);
+}
+
+DEF_FUNC(prStrFunc)
+{
+    if (!realizeParams(vm, len, params, exception))
+        return value_none();
 
-    array_free(&ca);
+    return value_obj(concatPrinted(vm, len, params, true, " "));
+}
 
-    return ret;
+DEF_FUNC(strFunc)
+{
+    if (!realizeParams(vm, len, params, exception))
+        return value_none();
+
+    return value_obj(concatPrinted(vm, len, params, false, NULL));
 }
 
 DEF_FUNC(prnFunc)
 {
+    if (!realizeParams(vm, len, params, exception))
+        return value_none();
+
     StrObj* s = NULL;
 
     for (int i = 0; i < len - 1; i++)
     {
         s = printReadablyStr(vm, params[i]);
-        printf("%s ", s->chars);
+        printf("%.*s ", s->length, strobj_chars(vm, s));
     }
 
     s = printReadablyStr(vm, params[len - 1]);
-    printf("%s\n", s->chars);
+    printf("%.*s\n", s->length, strobj_chars(vm, s));
 
     return value_nil();
 }
 
 DEF_FUNC(printlnFunc)
 {
+    if (!realizeParams(vm, len, params, exception))
+        return value_none();
+
     StrObj* s = NULL;
 
     for (int i = 0; i < len - 1; i++)
     {
         s = printRawStr(vm, params[i]);
-        printf("%s ", s->chars);
+        printf("%.*s ", s->length, strobj_chars(vm, s));
     }
 
     s = printRawStr(vm, params[len - 1]);
-    printf("%s\n", s->chars);
+    printf("%.*s\n", s->length, strobj_chars(vm, s));
 
     return value_nil();
 }
@@ -286,9 +379,20 @@ DEF_FUNC(emptyCheckFunc)
 {
     ASSERT_ONE_PARAM("empty?");
 
-    ValueArray* array = value_listLikeGetArr(FIRST_VAL);
-    if (array)
-        return value_bool(array->count == 0);
+    if (value_isLazySeq(FIRST_VAL))
+    {
+        if (!lazyseqobj_realize(vm, value_asLazySeq(FIRST_VAL), exception))
+            return value_none();
+
+        return value_bool(value_asLazySeq(FIRST_VAL)->length == 0);
+    }
+
+    if (value_isListLike(FIRST_VAL))
+        return value_bool(value_listLikeCount(FIRST_VAL) == 0);
+    else if (value_isSet(FIRST_VAL))
+        return value_bool(value_asSet(FIRST_VAL)->map->count == 0);
+    else if (value_isSorted(FIRST_VAL))
+        return value_bool(value_asSorted(FIRST_VAL)->count == 0);
     else
         return VAL_TRUE;
 }
@@ -297,11 +401,26 @@ DEF_FUNC(countFunc)
 {
     ASSERT_ONE_PARAM("count");
 
-    ValueArray* array = value_listLikeGetArr(FIRST_VAL);
-    if (array)
-        return value_num(array->count);
+    if (value_isLazySeq(FIRST_VAL) && !lazyseqobj_force(vm, value_asLazySeq(FIRST_VAL), exception))
+        return value_none();
+
+    if (value_isSeq(FIRST_VAL))
+        return value_num(value_listLikeCount(FIRST_VAL));
+    else if (value_isTransient(FIRST_VAL) && value_asTransient(FIRST_VAL)->coll != NULL)
+    {
+        Obj* coll = value_asTransient(FIRST_VAL)->coll;
+        return value_num(obj_isMap(coll) ? obj_asMap(coll)->count : obj_asVector(coll)->count);
+    }
     else if (value_isStr(FIRST_VAL))
         return value_num(value_asStr(FIRST_VAL)->length);
+    else if (value_isMap(FIRST_VAL))
+        return value_num(value_asMap(FIRST_VAL)->count);
+    else if (value_isRecord(FIRST_VAL))
+        return value_num(value_asRecord(FIRST_VAL)->shape->count);
+    else if (value_isSet(FIRST_VAL))
+        return value_num(value_asSet(FIRST_VAL)->map->count);
+    else if (value_isSorted(FIRST_VAL))
+        return value_num(value_asSorted(FIRST_VAL)->count);
     else
         return value_num(0);
 }
@@ -336,6 +455,7 @@ DEF_FUNC(resetFunc)
     ASSERT(value_isAtom(FIRST_VAL), "RuntimeError: reset arg is not a atom");
 
     value_asAtom(FIRST_VAL)->ref = SECOND_VAL;
+    CWRITE_BARRIER(vm, value_asAtom(FIRST_VAL));
     return SECOND_VAL;
 }
 
@@ -353,12 +473,15 @@ DEF_FUNC(swapFunc)
     for (size_t i = 2; i < len; i++)
         listobj_set(lobj, i - 1, params[i]);
 
-    Value ret = value_invoke(vm, SECOND_VAL, len - 1, (Value*)lobj->items.data, exception);
+    Value ret = value_invoke(vm, SECOND_VAL, len - 1, listobj_items(lobj), exception);
 
     VM_POP(lobj);
 
     if (!HAS_EXCEPTION())
+    {
         aobj->ref = ret;
+        CWRITE_BARRIER(vm, aobj);
+    }
 
     return ret;
 }
@@ -367,6 +490,9 @@ DEF_FUNC(swapFunc)
 
 DEF_FUNC(equalFunc)
 {
+    if (!realizeParams(vm, len, params, exception))
+        return value_none();
+
     for (size_t i = 1; i < len; i++)
     {
         if (!value_eq(vm, params[i - 1], params[i]))
@@ -380,7 +506,7 @@ DEF_FUNC(readStringFunc)
 {
     ASSERT(value_isStr(FIRST_VAL), "RuntimeError: read-string arg is not string");
 
-    Value ret = readStr(vm, value_asStr(FIRST_VAL)->chars);
+    Value ret = readStr(vm, strobj_cstr(vm, value_asStr(FIRST_VAL)));
     vm_clearBlockCmArr(vm);
     return ret;
 }
@@ -392,7 +518,7 @@ DEF_FUNC(slurpFunc)
     int fileSize;
     char* fileContent;
 
-    if (!readFile(value_asStr(FIRST_VAL)->chars, &fileContent, &fileSize))
+    if (!readFile(strobj_cstr(vm, value_asStr(FIRST_VAL)), &fileContent, &fileSize))
     {
         return value_nil();
     }
@@ -410,44 +536,51 @@ DEF_FUNC(evalFunc)
 
 DEF_FUNC(consFunc)
 {
-    ASSERT(value_isList(SECOND_VAL), "RuntimeError: cons 2rd arg is not a list");
+    ASSERT(value_isSeq(SECOND_VAL) || value_isNil(SECOND_VAL),
+           "RuntimeError: cons 2rd arg is not listlike");
 
-    ListObj* lobj = value_asList(SECOND_VAL);
-    ListObj* nobj = listobj_newWithNil(vm, lobj->items.count + 1);
+    if (value_isList(SECOND_VAL))
+        return value_obj(listobj_cons(vm, FIRST_VAL, value_asList(SECOND_VAL)));
 
-    listobj_set(nobj, 0, FIRST_VAL);
+    // keeps a lazy rest unrealized
+    if (value_isLazySeq(SECOND_VAL))
+        return value_obj(lazyseqobj_cons(vm, FIRST_VAL, value_asObj(SECOND_VAL)));
 
-    for (size_t i = 1; i < lobj->items.count + 1; i++)
-    {
-        LIST_GET_CHILD(lobj, i - 1, value);
-        listobj_set(nobj, i, value);
-    }
+    ListObj* rest = listobj_newWithListLike(vm, SECOND_VAL, 0);
+
+    VM_SPUSH(rest);
+    ListObj* ret = listobj_cons(vm, FIRST_VAL, rest);
+    VM_SPOP(rest);
 
-    return value_obj(nobj);
+    return value_obj(ret);
 }
 
-static Value concat(VM* vm, int len, Value* arr)
+static Value concat(VM* vm, int len, Value* arr, ExceptionObj** exception)
 {
-    ValueArray va;
-    ARR_INIT(&va, Value);
+    ValueVec va;
+    valuevec_init(&va);
 
     for (size_t i = 0; i < len; i++)
     {
         Value v = arr[i];
-        if (value_isList(v) || value_isVector(v))
+        if (value_isLazySeq(v) && !lazyseqobj_force(vm, value_asLazySeq(v), exception))
+        {
+            valuevec_free(&va);
+            return value_none();
+        }
+
+        if (value_isSeq(v))
         {
-            ValueArray* l = value_listLikeGetArr(v);
+            SeqIter iter;
+            value_iterInit(v, &iter);
 
             Value lv;
-            for (size_t j = 0; j < l->count; j++)
-            {
-                array_get(l, j, &lv);
-                array_push(&va, &lv);
-            }
+            while (seqiter_next(&iter, &lv))
+                valuevec_push(&va, lv);
         }
         else if (value_isMap(v))
         {
-            array_push(&va, &v);
+            valuevec_push(&va, v);
         }
         else if (value_isNil(v))
         {
@@ -455,32 +588,48 @@ static Value concat(VM* vm, int len, Value* arr)
         }
         else
         {
-            array_push(&va, &v);
+            valuevec_push(&va, v);
         }
     }
 
-    Value ret = value_listWithArr(vm, va.count, (Value*)va.data);
-    array_free(&va);
+    Value ret = value_listWithArr(vm, va.count, va.data);
+    valuevec_free(&va);
 
     return ret;
 }
 
 DEF_FUNC(concatFunc)
 {
-    return concat(vm, len, params);
+    return concat(vm, len, params, exception);
 }
 
 DEF_FUNC(nthFunc)
 {
-    ASSERT(value_isListLike(FIRST_VAL), "RuntimeError: nth arg is not listlike");
+    ASSERT(value_isSeq(FIRST_VAL), "RuntimeError: nth arg is not listlike");
 
-    ValueArray* va = value_listLikeGetArr(FIRST_VAL);
     int index = value_asNum(SECOND_VAL);
+    int skipped = 0;
+    Value seq = FIRST_VAL;
+
+    // a lazy seq is realized up to index, a list may follow it
+    while (value_isLazySeq(seq) && index >= 0)
+    {
+        LazySeqObj* ls = value_asLazySeq(seq);
+        if (!lazyseqobj_realize(vm, ls, exception))
+            return value_none();
 
-    if (index < 0 || index >= va->count)
-        THROW_EXCEPTION("nth out of range (%d/%d)", index, va->count);
+        if (index - skipped < ls->length)
+            return ls->chunk->items[ls->offset + index - skipped];
 
-    VALUE_ARR_GET_CHILD(va, index, ret);
+        skipped += ls->length;
+        seq = ls->more ? value_obj(ls->more) : value_nil();
+    }
+
+    int count = skipped + value_listLikeCount(seq);
+    if (index < 0 || index >= count)
+        THROW_EXCEPTION("nth out of range (%d/%d)", index, count);
+
+    LISTLIKE_GET_CHILD(seq, index - skipped, ret);
     return ret;
 }
 
@@ -491,13 +640,21 @@ DEF_FUNC(firstFunc)
     if (value_isNil(FIRST_VAL))
         return value_nil();
 
-    ASSERT(value_isListLike(FIRST_VAL), "RuntimeError: first arg is not listlike");
+    ASSERT(value_isSeq(FIRST_VAL), "RuntimeError: first arg is not listlike");
+
+    if (value_isLazySeq(FIRST_VAL))
+    {
+        LazySeqObj* ls = value_asLazySeq(FIRST_VAL);
+        if (!lazyseqobj_realize(vm, ls, exception))
+            return value_none();
+
+        return ls->length > 0 ? ls->chunk->items[ls->offset] : value_nil();
+    }
 
-    ValueArray* va = value_listLikeGetArr(FIRST_VAL);
-    if (va->count == 0)
+    if (value_listLikeCount(FIRST_VAL) == 0)
         return value_nil();
 
-    VALUE_ARR_GET_CHILD(va, 0, ret);
+    LISTLIKE_GET_CHILD(FIRST_VAL, 0, ret);
     return ret;
 }
 
@@ -508,227 +665,1717 @@ DEF_FUNC(restFunc)
     if (value_isNil(FIRST_VAL))
         return value_listWithEmpty(vm);
 
-    ASSERT(value_isListLike(FIRST_VAL), "RuntimeError: rest arg is not listlike");
+    ASSERT(value_isSeq(FIRST_VAL), "RuntimeError: rest arg is not listlike");
+
+    if (value_isLazySeq(FIRST_VAL))
+    {
+        LazySeqObj* ls = value_asLazySeq(FIRST_VAL);
+        if (!lazyseqobj_realize(vm, ls, exception))
+            return value_none();
+
+        return lazyseqobj_rest(vm, ls);
+    }
+
+    if (value_isList(FIRST_VAL))
+        return value_obj(listobj_rest(vm, value_asList(FIRST_VAL)));
 
-    ValueArray* va = value_listLikeGetArr(FIRST_VAL);
-    if (va->count <= 1)
+    int count = value_listLikeCount(FIRST_VAL);
+    if (count <= 1)
         return value_listWithEmpty(vm);
 
-    Value ret = value_listWithArr(vm, va->count - 1, (Value*)va->data + 1);
-    return ret;
+    // vectors share their items with the seq of them from 1 on
+    return value_obj(sliceobj_new(vm, FIRST_VAL, 1, count - 1, false));
 }
 
 DEF_FUNC(throwFunc)
 {
     ASSERT_ONE_PARAM("throw");
 
-    THROW_EXCEPTION("%s", value_asStr(FIRST_VAL)->chars);
+    if (value_isStr(FIRST_VAL))
+        THROW_EXCEPTION("%s", strobj_cstr(vm, value_asStr(FIRST_VAL)));
+
+    // exceptions carry a message, anything else thrown is printed into one
+    StrObj* info = printRawStr(vm, FIRST_VAL);
+    VM_SPUSH(info);
+    THROW("%s", strobj_cstr(vm, info));
+    VM_SPOP(info);
+
+    return value_none();
 }
 
 DEF_FUNC(applyFunc)
 {
     ASSERT(value_isCallable(FIRST_VAL), "RuntimeError: apply arg is not callable");
 
-    Value args = concat(vm, len - 1, (Value*)params + 1);
+    Value args = concat(vm, len - 1, (Value*)params + 1, exception);
+    if (HAS_EXCEPTION())
+        return value_none();
+
     Value funcValue = FIRST_VAL;
 
     VM_PUSHV(args);
 
     ListObj* lobj = value_asList(args);
     Value ret = value_invoke(vm, funcValue,
-                             lobj->items.count, (Value*)lobj->items.data, exception);
+                             lobj->count, listobj_items(lobj), exception);
 
     VM_POPV(args);
 
     return ret;
 }
 
-DEF_FUNC(mapFunc)
+/* what the lazy seq fns read coll as, none if it isn't a seq */
+/* list of the items of s, in map order */
+static Value setItems(VM* vm, SetObj* s)
 {
-    ASSERT(value_isCallable(FIRST_VAL), "RuntimeError: map arg is not callable");
+    VM_SPUSH(s);
+    ListObj* lobj = listobj_newWithNil(vm, s->map->count);
+    VM_SPOP(s);
 
-    Value args = concat(vm, len - 1, (Value*)params + 1);
-    Value funcValue = FIRST_VAL;
+    MapIter iter;
+    mapobj_iterInit(s->map, &iter);
 
-    VM_PUSHV(args);
+    Value item;
+    for (int i = 0; mapobj_iterNext(&iter, &item, NULL); i++)
+        listobj_set(lobj, i, item);
 
-    ListObj* lobj = value_asList(args);
+    return value_obj(lobj);
+}
 
-    ListObj* ret = listobj_newWithNil(vm, lobj->items.count);
-    VM_PUSH(ret);
+/* keys of a sorted coll a subseq keeps, a missing end is open */
+typedef struct
+{
+    bool  hasLow, lowInclusive;
+    Value low;
+    bool  hasHigh, highInclusive;
+    Value high;
+} SortedBounds;
 
-    for (size_t i = 0; i < lobj->items.count; i++)
-    {
-        LIST_GET_CHILD(lobj, i, item);
-        Value itemRet = value_invoke(vm, funcValue, 1, &item, exception);
+/**
+ * list of the keys of a sorted set or the [key value] entries of a sorted
+ * map within bounds, nil if there are none; the keys are compared before
+ * anything is allocated
+ */
+static Value sortedItems(VM* vm, SortedObj* s, SortedBounds* bounds, bool reverse, ExceptionObj** exception)
+{
+    SortedIter iter;
+    bool hasStart = bounds && (reverse ? bounds->hasHigh : bounds->hasLow);
+    bool hasEnd = bounds && (reverse ? bounds->hasLow : bounds->hasHigh);
 
-        if (HAS_EXCEPTION())
-        {
-            VM_POP(ret);
-            VM_POPV(args);
+    if (hasStart)
+    {
+        Value start = reverse ? bounds->high : bounds->low;
+        bool inclusive = reverse ? bounds->highInclusive : bounds->lowInclusive;
+        if (!sortediter_seek(vm, s, &iter, start, inclusive, reverse, exception))
             return value_none();
-        }
-        else
+    }
+    else
+    {
+        sortediter_init(s, &iter, reverse);
+    }
+
+    Callback cb;
+    callback_init(&cb, s->cmp);
+
+    ValueVec va;
+    valuevec_init(&va);
+
+    Value key, value;
+    while (sortediter_next(&iter, &key, &value))
+    {
+        if (hasEnd)
         {
-            listobj_set(ret, i, itemRet);
+            int c;
+            if (!sortedobj_compare(vm, s, &cb, key, reverse ? bounds->low : bounds->high, &c, exception))
+            {
+                valuevec_free(&va);
+                return value_none();
+            }
+
+            bool inclusive = reverse ? bounds->lowInclusive : bounds->highInclusive;
+            if (reverse ? (c < 0 || (c == 0 && !inclusive)) : (c > 0 || (c == 0 && !inclusive)))
+                break;
         }
+
+        valuevec_push(&va, key);
+        valuevec_push(&va, value);
     }
 
-    VM_POP(ret);
-    VM_POPV(args);
+    int count = va.count / 2;
+    if (count == 0)
+    {
+        valuevec_free(&va);
+        return value_nil();
+    }
 
-    return value_obj(ret);
-}
+    ListObj* lobj = listobj_newWithNil(vm, count);
+    VM_PUSH(lobj);
 
-DEF_FUNC(nilCheckFunc)
-{
-    ASSERT_ONE_PARAM("nil?");
+    Value* pairs = va.data;
+    for (int i = 0; i < count; i++)
+    {
+        Value item = s->isSet ? pairs[2 * i] : value_vector(vm, 2, pairs[2 * i], pairs[2 * i + 1]);
+        listobj_set(lobj, i, item);
+    }
 
-    return value_bool(value_isNil(FIRST_VAL));
+    VM_POP(lobj);
+    valuevec_free(&va);
+
+    return value_obj(lobj);
 }
 
-DEF_FUNC(trueCheckFunc)
+static Value seqSrc(VM* vm, Value coll)
 {
-    ASSERT_ONE_PARAM("true?");
+    if (value_isNil(coll) || value_isSeq(coll))
+        return coll;
 
-    return value_bool(value_isBool(FIRST_VAL) && value_asBool(FIRST_VAL));
+    if (value_isSet(coll))
+        return setItems(vm, value_asSet(coll));
+
+    // no bounds, no compares, can't throw
+    if (value_isSorted(coll))
+        return sortedItems(vm, value_asSorted(coll), NULL, false, NULL);
+
+    if (value_isStr(coll))
+    {
+        LazySeqObj* ls = lazyseqobj_newOfStr(vm, value_asStr(coll));
+        return ls ? value_obj(ls) : value_nil();
+    }
+
+    return value_none();
 }
 
-DEF_FUNC(falseCheckFunc)
+/* one stage transducer of (map f), (filter pred), (take n) and (drop n) */
+static Value xformOf(VM* vm, XformKind kind, Value fn, int n)
 {
-    ASSERT_ONE_PARAM("false?");
+    XformObj* xf = xformobj_new(vm, 1);
+    xf->stages[0].kind = kind;
+    xf->stages[0].fn = fn;
+    xf->stages[0].n = n;
 
-    return value_bool(value_isBool(FIRST_VAL) && !value_asBool(FIRST_VAL));
+    return value_obj(xf);
 }
 
-DEF_FUNC(symbolCheckFunc)
+DEF_FUNC(mapFunc)
 {
-    ASSERT_ONE_PARAM("symbol?");
+    ASSERT(len >= 1, "RuntimeError: map needs a fn and a coll");
+    ASSERT(value_isCallable(FIRST_VAL), "RuntimeError: map arg is not callable");
 
-    return value_bool(value_isSymbol(FIRST_VAL));
+    if (len == 1)
+        return xformOf(vm, XFORM_MAP, FIRST_VAL, 0);
+
+    // more colls, or one which isn't a seq, are mapped as their concat
+    Value src = len == 2 ? seqSrc(vm, SECOND_VAL) : value_none();
+    if (value_isNone(src))
+    {
+        src = concat(vm, len - 1, (Value*)params + 1, exception);
+        if (HAS_EXCEPTION())
+            return value_none();
+    }
+
+    return value_obj(lazyseqobj_new(vm, LAZY_MAP, FIRST_VAL, src));
 }
 
-DEF_FUNC(symbolFunc)
+DEF_FUNC(filterFunc)
 {
-    ASSERT_ONE_PARAM("symbol");
+    ASSERT(len == 1 || len == 2, "RuntimeError: filter needs a pred and a coll");
+    ASSERT(value_isCallable(FIRST_VAL), "RuntimeError: filter arg is not callable");
 
-    ASSERT(value_isStr(FIRST_VAL), "RuntimeError: symbol arg is not a string");
+    if (len == 1)
+        return xformOf(vm, XFORM_FILTER, FIRST_VAL, 0);
 
-    StrObj* sobj = value_asStr(FIRST_VAL);
-    return value_symbolWithStr(vm, sobj);
+    Value src = seqSrc(vm, SECOND_VAL);
+    ASSERT(!value_isNone(src), "RuntimeError: filter coll is not a seq");
+
+    return value_obj(lazyseqobj_new(vm, LAZY_FILTER, FIRST_VAL, src));
 }
 
-DEF_FUNC(keywordFunc)
+static Value takeOrDrop(VM* vm, LazyKind kind, int len, Value* params, ExceptionObj** exception)
 {
-    ASSERT_ONE_PARAM("keyword");
+    ASSERT((len == 1 || len == 2) && value_isNum(FIRST_VAL), "RuntimeError: %s needs a count and a coll",
+           kind == LAZY_TAKE ? "take" : "drop");
 
-    ASSERT(value_isStr(FIRST_VAL), "RuntimeError: keyword arg is not a string");
+    int n = value_asNum(FIRST_VAL) > 0 ? (int)value_asNum(FIRST_VAL) : 0;
+    if (len == 1)
+        return xformOf(vm, kind == LAZY_TAKE ? XFORM_TAKE : XFORM_DROP, value_nil(), n);
 
-    StrObj* sobj = value_asStr(FIRST_VAL);
-    return value_keywordWithStr(vm, sobj);
+    Value src = seqSrc(vm, SECOND_VAL);
+    ASSERT(!value_isNone(src), "RuntimeError: %s coll is not a seq",
+           kind == LAZY_TAKE ? "take" : "drop");
+
+    LazySeqObj* ls = lazyseqobj_new(vm, kind, value_nil(), src);
+    ls->n = n;
+
+    return value_obj(ls);
 }
 
-DEF_FUNC(keywordCheckFunc)
+DEF_FUNC(takeFunc)
 {
-    ASSERT_ONE_PARAM("keyword?");
-
-    return value_bool(value_isKeyword(FIRST_VAL));
+    return takeOrDrop(vm, LAZY_TAKE, len, params, exception);
 }
 
-DEF_FUNC(vectorFunc)
+DEF_FUNC(dropFunc)
 {
-    return value_vectorWithArr(vm, len, params);
+    return takeOrDrop(vm, LAZY_DROP, len, params, exception);
 }
 
-DEF_FUNC(vectorCheckFunc)
+DEF_FUNC(rangeFunc)
 {
-    ASSERT_ONE_PARAM("vector?");
+    for (int i = 0; i < len; i++)
+        ASSERT(value_isNum(params[i]), "RuntimeError: range args must be numbers");
 
-    return value_bool(value_isVector(FIRST_VAL));
+    switch (len)
+    {
+    case 0:
+        return value_obj(lazyseqobj_newRange(vm, 0, HUGE_VAL, 1));
+    case 1:
+        return value_obj(lazyseqobj_newRange(vm, 0, value_asNum(FIRST_VAL), 1));
+    case 2:
+        return value_obj(lazyseqobj_newRange(vm, value_asNum(FIRST_VAL), value_asNum(SECOND_VAL), 1));
+    case 3:
+        return value_obj(lazyseqobj_newRange(vm, value_asNum(FIRST_VAL), value_asNum(SECOND_VAL),
+                                             value_asNum(params[2])));
+    default:
+        THROW_EXCEPTION("RuntimeError: range takes at most 3 args");
+    }
 }
 
-DEF_FUNC(sequentialCheckFunc)
+/* backs the lazy-seq macro, thunk is called when the seq is first used */
+DEF_FUNC(lazySeqFunc)
 {
-    ASSERT_ONE_PARAM("sequential?");
+    ASSERT_ONE_PARAM("lazy-seq*");
+    ASSERT(value_isCallable(FIRST_VAL), "RuntimeError: lazy-seq* arg is not callable");
 
-    return value_bool(value_isPair(FIRST_VAL));
+    return value_obj(lazyseqobj_new(vm, LAZY_THUNK, FIRST_VAL, value_nil()));
 }
 
-DEF_FUNC(hashMapFunc)
+DEF_FUNC(doallFunc)
 {
-    return value_mapWithArr(vm, len, params);
+    ASSERT_ONE_PARAM("doall");
+
+    if (value_isLazySeq(FIRST_VAL) && !lazyseqobj_force(vm, value_asLazySeq(FIRST_VAL), exception))
+        return value_none();
+
+    return FIRST_VAL;
 }
 
-DEF_FUNC(mapCheckFunc)
+/* ----- reduce ----- */
+
+/* returns false to end the walk */
+typedef bool (*ItemVisitor)(VM* vm, void* ctx, Value item, ExceptionObj** exception);
+
+/* visits item unless an allocation went over a limit, that is raised instead */
+static bool visitItem(VM* vm, ItemVisitor visit, void* ctx, Value item, ExceptionObj** exception)
 {
-    ASSERT_ONE_PARAM("map?");
+    if (!vm_checkMemory(vm, exception))
+        return false;
 
-    return value_bool(value_isMap(FIRST_VAL));
+    return visit(vm, ctx, item, exception);
 }
 
-DEF_FUNC(assocFunc)
+/**
+ * calls visit on each item of coll without building a seq of it: runs of a
+ * seq are read in place, a map gives [key value] vectors, a string its chars
+ */
+static bool forEachItem(VM* vm, Value coll, ItemVisitor visit, void* ctx, ExceptionObj** exception)
 {
-    ASSERT(value_isMap(FIRST_VAL), "RuntimeError: assoc arg is not a map");
-    ASSERT(len > 1 && (len - 1) % 2 == 0, "RuntimeError: assoc need even change args");
+    if (value_isSet(coll))
+    {
+        MapIter iter;
+        mapobj_iterInit(value_asSet(coll)->map, &iter);
 
-    MapObj* oldMap = value_asMap(FIRST_VAL);
+        Value item;
+        while (mapobj_iterNext(&iter, &item, NULL))
+        {
+            if (!visitItem(vm, visit, ctx, item, exception))
+                break;
+        }
 
-    MapObj* newMap = mapobj_newWithArr(vm, len - 1, &SECOND_VAL);
+        return !HAS_EXCEPTION();
+    }
 
-    VM_PUSH(newMap);
+    if (value_isSorted(coll))
+    {
+        SortedObj* sorted = value_asSorted(coll);
+        SortedIter iter;
+        sortediter_init(sorted, &iter, false);
+
+        Value key, value;
+        while (sortediter_next(&iter, &key, &value))
+        {
+            Value entry = sorted->isSet ? key : value_vector(vm, 2, key, value);
+            VM_SPUSHV(entry);
+            bool goOn = visitItem(vm, visit, ctx, entry, exception);
+            VM_SPOPV(entry);
 
-    int oldMapLen = oldMap->table.count;
+            if (!goOn)
+                break;
+        }
 
-    uint32_t* keys = CALLOCATE(vm, uint32_t, oldMapLen);
-    table_keys(&oldMap->table, keys);
+        return !HAS_EXCEPTION();
+    }
 
-    MapObjEntry entry;
-    for (size_t i = 0; i < oldMapLen; i++)
+    if (value_isRecord(coll))
     {
-        table_get(&oldMap->table, keys[i], &entry);
+        RecordObj* r = value_asRecord(coll);
+        for (int i = 0; i < r->shape->count; i++)
+        {
+            Value entry = value_vector(vm, 2, r->shape->fields[i], r->slots[i]);
+            VM_SPUSHV(entry);
+            bool goOn = visitItem(vm, visit, ctx, entry, exception);
+            VM_SPOPV(entry);
+
+            if (!goOn)
+                break;
+        }
 
-        if (!mapobj_get(newMap, entry.key, NULL))
-            mapobj_set(newMap, entry.key, entry.value);
+        return !HAS_EXCEPTION();
     }
 
-    CFREE_ARRAY(vm, uint32_t, keys, oldMapLen);
+    if (value_isMap(coll))
+    {
+        MapIter iter;
+        mapobj_iterInit(value_asMap(coll), &iter);
 
-    VM_POP(newMap);
+        Value key, value;
+        while (mapobj_iterNext(&iter, &key, &value))
+        {
+            Value entry = value_vector(vm, 2, key, value);
+            VM_SPUSHV(entry);
+            bool goOn = visitItem(vm, visit, ctx, entry, exception);
+            VM_SPOPV(entry);
 
-    return value_obj(newMap);
-}
+            if (!goOn)
+                break;
+        }
 
-DEF_FUNC(dissocFunc)
-{
-    ASSERT(value_isMap(FIRST_VAL), "RuntimeError: dissoc arg is not a map");
+        return !HAS_EXCEPTION();
+    }
 
-    MapObj* oldMap = value_asMap(FIRST_VAL);
+    if (value_isStr(coll))
+    {
+        StrObj* s = value_asStr(coll);
+        const char* chars = strobj_chars(vm, s);
+        for (int i = 0; i < s->length; i++)
+        {
+            Value c = value_str(vm, chars + i, 1);
+            VM_SPUSHV(c);
+            bool goOn = visitItem(vm, visit, ctx, c, exception);
+            VM_SPOPV(c);
 
-    MapObj* newMap = mapobj_clone(vm, oldMap);
+            if (!goOn)
+                break;
+        }
 
-    for (size_t i = 1; i < len; i++)
-        mapobj_del(newMap, params[i]);
+        return !HAS_EXCEPTION();
+    }
 
-    return value_obj(newMap);
+    // the rest of a run is reachable from src, which holds the run's items
+    Value src = coll;
+    int index = 0;
+    bool goOn = true;
+
+    while (goOn && !value_isNil(src))
+    {
+        SeqRun run;
+        if (!value_nextRun(vm, src, index, INT_MAX, &run, exception))
+            return false;
+
+        VM_SPUSHV(src);
+        for (int i = 0; goOn && i < run.count; i++)
+            goOn = visitItem(vm, visit, ctx, run.items[i], exception);
+        VM_SPOPV(src);
+
+        src = run.rest;
+        index = run.restIndex;
+    }
+
+    return !HAS_EXCEPTION();
 }
 
-DEF_FUNC(getFunc)
+static bool isReducible(Value v)
 {
-    ASSERT(value_isMap(FIRST_VAL), "RuntimeError: get arg is not a map");
+    return value_isNil(v) || value_isSeq(v) || value_isMap(v) || value_isRecord(v) || value_isSet(v)
+        || value_isSorted(v) || value_isStr(v);
+}
+
+typedef struct
+{
+    Callback cb;
+    AtomObj* acc; // rooted box, the walk allocates between steps
+    bool     hasAcc;
+} ReduceState;
+
+static bool reduceVisit(VM* vm, void* ctx, Value item, ExceptionObj** exception)
+{
+    ReduceState* state = (ReduceState*)ctx;
+    Value acc = item;
+
+    if (state->hasAcc)
+    {
+        Value args[2] = { state->acc->ref, item };
+        acc = callback_call(vm, &state->cb, 2, args, exception);
+        if (HAS_EXCEPTION())
+            return false;
+    }
+
+    bool goOn = !value_isReduced(acc);
+    state->acc->ref = goOn ? acc : value_asReduced(acc)->val;
+    state->hasAcc = true;
+    CWRITE_BARRIER(vm, state->acc);
+
+    return goOn;
+}
+
+DEF_FUNC(reduceFunc)
+{
+    ASSERT(len == 2 || len == 3, "RuntimeError: reduce needs a fn, an optional init and a coll");
+    ASSERT(value_isCallable(FIRST_VAL), "RuntimeError: reduce arg is not callable");
+
+    Value coll = params[len - 1];
+    ASSERT(isReducible(coll), "RuntimeError: reduce coll is not a seq");
+
+    ReduceState state;
+    callback_init(&state.cb, FIRST_VAL);
+    state.acc = atomobj_new(vm, len == 3 ? SECOND_VAL : value_nil());
+    state.hasAcc = len == 3;
+
+    VM_SPUSH(state.acc);
+    bool ok = forEachItem(vm, coll, reduceVisit, &state, exception);
+    VM_SPOP(state.acc);
+
+    if (!ok)
+        return value_none();
+
+    // (reduce f []) is (f)
+    if (!state.hasAcc)
+        return callback_call(vm, &state.cb, 0, &state.acc->ref, exception);
+
+    return state.acc->ref;
+}
+
+DEF_FUNC(reducedFunc)
+{
+    ASSERT_ONE_PARAM("reduced");
+
+    return value_obj(reducedobj_new(vm, FIRST_VAL));
+}
+
+DEF_FUNC(reducedCheckFunc)
+{
+    ASSERT_ONE_PARAM("reduced?");
+
+    return value_bool(value_isReduced(FIRST_VAL));
+}
+
+typedef struct
+{
+    Callback cb;
+    bool     every;
+    Value    found;
+} SomeState;
+
+/* some stops at the first truthy (pred x), every? at the first falsy one */
+static bool someVisit(VM* vm, void* ctx, Value item, ExceptionObj** exception)
+{
+    SomeState* state = (SomeState*)ctx;
+
+    Value ret = callback_call(vm, &state->cb, 1, &item, exception);
+    if (HAS_EXCEPTION())
+        return false;
+
+    if (value_true(ret) == state->every)
+        return true;
+
+    state->found = ret;
+    return false;
+}
+
+static Value someOrEvery(VM* vm, bool every, int len, Value* params, ExceptionObj** exception)
+{
+    const char* name = every ? "every?" : "some";
+    ASSERT(len == 2, "RuntimeError: %s needs a pred and a coll", name);
+    ASSERT(value_isCallable(FIRST_VAL), "RuntimeError: %s arg is not callable", name);
+    ASSERT(isReducible(SECOND_VAL), "RuntimeError: %s coll is not a seq", name);
+
+    SomeState state;
+    callback_init(&state.cb, FIRST_VAL);
+    state.every = every;
+    state.found = value_none();
+
+    if (!forEachItem(vm, SECOND_VAL, someVisit, &state, exception))
+        return value_none();
+
+    if (every)
+        return value_bool(value_isNone(state.found));
+
+    return value_isNone(state.found) ? value_nil() : state.found;
+}
+
+DEF_FUNC(someFunc)
+{
+    return someOrEvery(vm, false, len, params, exception);
+}
+
+DEF_FUNC(everyFunc)
+{
+    return someOrEvery(vm, true, len, params, exception);
+}
+
+typedef struct
+{
+    XformObj*   xf; // running copy
+    Callback*   cbs;
+    ItemVisitor sink;
+    void*       sinkCtx;
+} XformState;
+
+static bool xformVisit(VM* vm, void* ctx, Value item, ExceptionObj** exception)
+{
+    XformState* state = (XformState*)ctx;
+
+    bool done = false;
+    if (!xformobj_apply(vm, state->xf, state->cbs, &item, &done, exception))
+        return !done && !HAS_EXCEPTION();
+
+    VM_SPUSHV(item);
+    bool goOn = state->sink(vm, state->sinkCtx, item, exception);
+    VM_SPOPV(item);
+
+    return goOn && !done;
+}
+
+/* forEachItem through xf, what gets through all stages goes to sink */
+static bool forEachXformed(VM* vm, Value coll, XformObj* xf, ItemVisitor sink, void* sinkCtx,
+                           ExceptionObj** exception)
+{
+    XformState state;
+    Callback inlineCbs[XFORM_INLINE_STAGES];
+    state.xf = xformobj_running(vm, xf);
+    state.sink = sink;
+    state.sinkCtx = sinkCtx;
+    state.cbs = xformobj_initCallbacks(state.xf, inlineCbs);
+
+    VM_SPUSH(state.xf);
+    bool ok = forEachItem(vm, coll, xformVisit, &state, exception);
+    VM_SPOP(state.xf);
+
+    xformobj_freeCallbacks(state.xf, state.cbs);
+    return ok;
+}
+
+/**
+ * ctx is the transient vector, the cloned map or the set of a cloned map built
+ * into, or an atom boxing the sorted coll built so far
+ */
+static bool intoVisit(VM* vm, void* ctx, Value item, ExceptionObj** exception)
+{
+    Obj* coll = (Obj*)ctx;
+
+    if (obj_isAtom(coll))
+    {
+        AtomObj* box = obj_asAtom(coll);
+        SortedObj* sorted = value_asSorted(box->ref);
+        Value key = item;
+        Value value = item;
+
+        if (!sorted->isSet)
+        {
+            if (!value_isVector(item) || value_asVector(item)->count != 2)
+            {
+                THROW("RuntimeError: into a map takes [key value] items");
+                return false;
+            }
+
+            VECTOR_GET_CHILD(value_asVector(item), 0, entryKey);
+            VECTOR_GET_CHILD(value_asVector(item), 1, entryValue);
+            key = entryKey;
+            value = entryValue;
+        }
+
+        SortedObj* next = sortedobj_assoc(vm, sorted, key, value, exception);
+        if (next == NULL)
+            return false;
+
+        box->ref = value_obj(next);
+        CWRITE_BARRIER(vm, box);
+    }
+    else if (obj_isVector(coll))
+    {
+        vectorobj_conjInPlace(vm, obj_asVector(coll), item);
+    }
+    else if (obj_isMap(coll))
+    {
+        if (!value_isVector(item) || value_asVector(item)->count != 2)
+        {
+            THROW("RuntimeError: into a map takes [key value] items");
+            return false;
+        }
+
+        VECTOR_GET_CHILD(value_asVector(item), 0, key);
+        VECTOR_GET_CHILD(value_asVector(item), 1, value);
+        if (!value_realize(vm, key, exception))
+            return false;
+
+        mapobj_set(vm, obj_asMap(coll), key, value);
+    }
+    else if (obj_isSet(coll))
+    {
+        if (!value_realize(vm, item, exception))
+            return false;
+
+        mapobj_set(vm, obj_asSet(coll)->map, item, item);
+    }
+
+    return true;
+}
+
+/* conj of every item of from, built in place when to is a vector or map */
+DEF_FUNC(intoFunc)
+{
+    ASSERT(len == 2 || len == 3, "RuntimeError: into needs a to coll, an optional xform and a from coll");
+    ASSERT(value_isNil(FIRST_VAL) || value_isSeq(FIRST_VAL) || value_isMap(FIRST_VAL) || value_isSet(FIRST_VAL)
+           || value_isSorted(FIRST_VAL),
+           "RuntimeError: into to coll is not a seq, map or set");
+    ASSERT(len == 2 || value_isXform(SECOND_VAL), "RuntimeError: into arg is not a transducer");
+
+    Value to = FIRST_VAL;
+    Value from = params[len - 1];
+    ASSERT(isReducible(from), "RuntimeError: into from coll is not a seq");
+
+    // items conj'ed onto a list or lazy seq are gathered first, then consed
+    Obj* coll;
+    if (value_isVector(to))
+        coll = (Obj*)vectorobj_transient(vm, value_asVector(to));
+    else if (value_isSubvec(to))
+        coll = (Obj*)vectorobj_transient(vm, sliceobj_toVector(vm, value_asSlice(to)));
+    else if (value_isMap(to))
+        coll = (Obj*)mapobj_clone(vm, value_asMap(to));
+    else if (value_isSet(to))
+        coll = (Obj*)setobj_new(vm, mapobj_clone(vm, value_asSet(to)->map));
+    else if (value_isSorted(to))
+        coll = (Obj*)atomobj_new(vm, to);
+    else
+        coll = (Obj*)vectorobj_transient(vm, value_asVector(value_vectorWithEmpty(vm)));
+
+    VM_SPUSH(coll);
+    bool ok = len == 3
+        ? forEachXformed(vm, from, value_asXform(SECOND_VAL), intoVisit, coll, exception)
+        : forEachItem(vm, from, intoVisit, coll, exception);
+    VM_SPOP(coll);
+
+    if (!ok)
+        return value_none();
+
+    if (obj_isAtom(coll))
+        return obj_asAtom(coll)->ref;
+
+    if (obj_isMap(coll))
+    {
+        CWRITE_BARRIER(vm, coll);
+        return value_obj(coll);
+    }
+
+    if (obj_isSet(coll))
+    {
+        obj_asSet(coll)->meta = value_asSet(to)->meta;
+        CWRITE_BARRIER(vm, obj_asSet(coll)->map);
+        return value_obj(coll);
+    }
+
+    VectorObj* items = obj_asVector(coll);
+    vectorobj_persistent(items);
+
+    if (value_isVectorLike(to))
+    {
+        items->meta = value_meta(to);
+        return value_obj(items);
+    }
+
+    VM_SPUSH(items);
+
+    Obj* newSeq;
+    if (value_isNil(to))
+        newSeq = (Obj*)listobj_new(vm, 0);
+    else if (value_isSlice(to))
+        newSeq = (Obj*)listobj_newWithListLike(vm, to, 0);
+    else
+        newSeq = value_asObj(to);
+    for (int i = 0; i < items->count; i++)
+    {
+        VECTOR_GET_CHILD(items, i, item);
+
+        VM_SPUSH(newSeq);
+        Obj* next = obj_isList(newSeq)
+            ? (Obj*)listobj_cons(vm, item, obj_asList(newSeq))
+            : (Obj*)lazyseqobj_cons(vm, item, newSeq);
+        VM_SPOP(newSeq);
+        newSeq = next;
+    }
+
+    VM_SPOP(items);
+
+    return value_obj(newSeq);
+}
+
+/* ----- transducer ----- */
+
+/* backs comp, the stages of all args in order, nil if one isn't a transducer */
+DEF_FUNC(xformCompFunc)
+{
+    int count = 0;
+    for (int i = 0; i < len; i++)
+    {
+        if (!value_isXform(params[i]))
+            return value_nil();
+
+        count += value_asXform(params[i])->count;
+    }
+
+    XformObj* xf = xformobj_new(vm, count);
+
+    XformStage* stage = xf->stages;
+    for (int i = 0; i < len; i++)
+    {
+        XformObj* other = value_asXform(params[i]);
+        memcpy(stage, other->stages, sizeof(XformStage) * other->count);
+        stage += other->count;
+    }
+
+    return value_obj(xf);
+}
+
+DEF_FUNC(transduceFunc)
+{
+    ASSERT(len == 3 || len == 4, "RuntimeError: transduce needs an xform, a fn, an optional init and a coll");
+    ASSERT(value_isXform(FIRST_VAL), "RuntimeError: transduce arg is not a transducer");
+    ASSERT(value_isCallable(SECOND_VAL), "RuntimeError: transduce fn is not callable");
+
+    Value coll = params[len - 1];
+    ASSERT(isReducible(coll), "RuntimeError: transduce coll is not a seq");
+
+    ReduceState state;
+    callback_init(&state.cb, SECOND_VAL);
+    state.hasAcc = true;
+
+    // (transduce xf f coll) starts from (f)
+    Value init = params[2];
+    if (len == 3)
+    {
+        init = callback_call(vm, &state.cb, 0, params, exception);
+        if (HAS_EXCEPTION())
+            return value_none();
+    }
+
+    VM_SPUSHV(init);
+    state.acc = atomobj_new(vm, init);
+    VM_SPOPV(init);
+
+    VM_SPUSH(state.acc);
+    bool ok = forEachXformed(vm, coll, value_asXform(FIRST_VAL), reduceVisit, &state, exception);
+    VM_SPOP(state.acc);
+
+    return ok ? state.acc->ref : value_none();
+}
+
+/* lazy seq of coll through xf, realized a run at a time */
+DEF_FUNC(sequenceFunc)
+{
+    ASSERT(len == 1 || len == 2, "RuntimeError: sequence needs an optional xform and a coll");
+    ASSERT(len == 1 || value_isXform(FIRST_VAL), "RuntimeError: sequence arg is not a transducer");
+
+    Value src = seqSrc(vm, params[len - 1]);
+    ASSERT(!value_isNone(src), "RuntimeError: sequence coll is not a seq");
+
+    if (len == 1)
+        return value_isNil(src) ? value_listWithEmpty(vm) : src;
+
+    VM_SPUSHV(src);
+    XformObj* xf = xformobj_running(vm, value_asXform(FIRST_VAL));
+    VM_SPOPV(src);
+
+    return value_obj(lazyseqobj_new(vm, LAZY_XFORM, value_obj(xf), src));
+}
+
+DEF_FUNC(nilCheckFunc)
+{
+    ASSERT_ONE_PARAM("nil?");
+
+    return value_bool(value_isNil(FIRST_VAL));
+}
+
+DEF_FUNC(trueCheckFunc)
+{
+    ASSERT_ONE_PARAM("true?");
+
+    return value_bool(value_isBool(FIRST_VAL) && value_asBool(FIRST_VAL));
+}
+
+DEF_FUNC(falseCheckFunc)
+{
+    ASSERT_ONE_PARAM("false?");
+
+    return value_bool(value_isBool(FIRST_VAL) && !value_asBool(FIRST_VAL));
+}
+
+DEF_FUNC(symbolCheckFunc)
+{
+    ASSERT_ONE_PARAM("symbol?");
+
+    return value_bool(value_isSymbol(FIRST_VAL));
+}
+
+DEF_FUNC(symbolFunc)
+{
+    ASSERT_ONE_PARAM("symbol");
+
+    ASSERT(value_isStr(FIRST_VAL), "RuntimeError: symbol arg is not a string");
+
+    StrObj* sobj = strobj_internStr(vm, value_asStr(FIRST_VAL));
+    VM_SPUSH(sobj);
+    Value ret = value_symbolWithStr(vm, sobj);
+    VM_SPOP(sobj);
+    return ret;
+}
+
+DEF_FUNC(keywordFunc)
+{
+    ASSERT_ONE_PARAM("keyword");
+
+    ASSERT(value_isStr(FIRST_VAL), "RuntimeError: keyword arg is not a string");
+
+    StrObj* sobj = strobj_internStr(vm, value_asStr(FIRST_VAL));
+    VM_SPUSH(sobj);
+    Value ret = value_keywordWithStr(vm, sobj);
+    VM_SPOP(sobj);
+    return ret;
+}
+
+DEF_FUNC(keywordCheckFunc)
+{
+    ASSERT_ONE_PARAM("keyword?");
+
+    return value_bool(value_isKeyword(FIRST_VAL));
+}
+
+DEF_FUNC(vectorFunc)
+{
+    return value_vectorWithArr(vm, len, params);
+}
+
+DEF_FUNC(vectorCheckFunc)
+{
+    ASSERT_ONE_PARAM("vector?");
+
+    return value_bool(value_isVectorLike(FIRST_VAL));
+}
+
+/* (subvec v start) or (subvec v start end), O(1): views v without copying it */
+DEF_FUNC(subvecFunc)
+{
+    ASSERT((len == 2 || len == 3) && value_isVectorLike(FIRST_VAL),
+           "RuntimeError: subvec needs a vector, a start and an optional end");
+    ASSERT(value_isInt(SECOND_VAL) && (len == 2 || value_isInt(params[2])),
+           "RuntimeError: subvec index is not an integer");
+
+    int count = value_listLikeCount(FIRST_VAL);
+    int start = (int)value_asNum(SECOND_VAL);
+    int end = len == 3 ? (int)value_asNum(params[2]) : count;
+    if (start < 0 || start > end || end > count)
+        THROW_EXCEPTION("RuntimeError: subvec range out of bounds (%d..%d/%d)", start, end, count);
+
+    return value_obj(sliceobj_new(vm, FIRST_VAL, start, end - start, true));
+}
+
+DEF_FUNC(sequentialCheckFunc)
+{
+    ASSERT_ONE_PARAM("sequential?");
+
+    return value_bool(value_isPair(FIRST_VAL) || value_isLazySeq(FIRST_VAL));
+}
+
+DEF_FUNC(hashMapFunc)
+{
+    if (!realizeKeys(vm, len, params, 0, 2, exception))
+        return value_none();
+
+    return value_mapWithArr(vm, len, params);
+}
+
+DEF_FUNC(mapCheckFunc)
+{
+    ASSERT_ONE_PARAM("map?");
+
+    return value_bool(value_isMap(FIRST_VAL) || value_isRecord(FIRST_VAL) || value_isSortedMap(FIRST_VAL));
+}
+
+/* ----- string lib ----- */
+
+DEF_FUNC(subsFunc)
+{
+    ASSERT((len == 2 || len == 3) && value_isStr(FIRST_VAL),
+           "RuntimeError: subs needs a string, a start and an optional end");
+    ASSERT(value_isInt(SECOND_VAL) && (len == 2 || value_isInt(params[2])),
+           "RuntimeError: subs index is not an integer");
+
+    StrObj* s = value_asStr(FIRST_VAL);
+    int start = (int)value_asNum(SECOND_VAL);
+    int end = len == 3 ? (int)value_asNum(params[2]) : s->length;
+    if (start < 0 || start > end || end > s->length)
+        THROW_EXCEPTION("RuntimeError: subs range out of bounds (%d..%d/%d)", start, end, s->length);
+
+    return value_obj(strobj_sub(vm, s, start, end - start));
+}
+
+DEF_FUNC(indexOfFunc)
+{
+    ASSERT((len == 2 || len == 3) && value_isStr(FIRST_VAL) && value_isStr(SECOND_VAL),
+           "RuntimeError: index-of needs a string, a string to find and an optional start");
+    ASSERT(len == 2 || value_isInt(params[2]), "RuntimeError: index-of start is not an integer");
+
+    int from = len == 3 ? (int)value_asNum(params[2]) : 0;
+    int index = strobj_indexOf(vm, value_asStr(FIRST_VAL), value_asStr(SECOND_VAL), from);
+    return index < 0 ? value_nil() : value_num(index);
+}
+
+/* the end of the piece starting at from, an empty sep splits off one char */
+static int splitEnd(VM* vm, StrObj* s, StrObj* sep, int from)
+{
+    if (sep->length == 0)
+        return from + 1;
+
+    int index = strobj_indexOf(vm, s, sep, from);
+    return index < 0 ? s->length : index;
+}
+
+/* splits at each sep, dropping trailing empty pieces like clojure.string/split */
+DEF_FUNC(splitFunc)
+{
+    ASSERT(len == 2 && value_isStr(FIRST_VAL) && value_isStr(SECOND_VAL),
+           "RuntimeError: split needs a string and a separator string");
+
+    StrObj* s = value_asStr(FIRST_VAL);
+    StrObj* sep = value_asStr(SECOND_VAL);
+    if (s->length == 0)
+        return value_vector(vm, 1, FIRST_VAL);
+
+    // count the pieces up to the last non empty one
+    int count = 0, kept = 0;
+    for (int from = 0; from <= s->length; )
+    {
+        int end = splitEnd(vm, s, sep, from);
+        count++;
+        if (end > from)
+            kept = count;
+
+        if (end == s->length)
+            break;
+        from = end + sep->length;
+    }
+
+    VectorObj* ret = vectorobj_newWithNil(vm, kept);
+    VM_SPUSH(ret);
+
+    for (int i = 0, from = 0; i < kept; i++)
+    {
+        int end = splitEnd(vm, s, sep, from);
+        vectorobj_set(ret, i, value_obj(strobj_sub(vm, s, from, end - from)));
+        from = end + sep->length;
+    }
+
+    VM_SPOP(ret);
+    return value_obj(ret);
+}
+
+typedef struct
+{
+    StrBuilder builder;
+    StrObj*    sep; // NULL for none
+    bool       first;
+} JoinState;
+
+static bool joinVisit(VM* vm, void* ctx, Value item, ExceptionObj** exception)
+{
+    JoinState* state = (JoinState*)ctx;
+
+    if (state->sep && !state->first)
+        builderAppend(vm, &state->builder, state->sep);
+    state->first = false;
+
+    StrObj* s = printRawStr(vm, item);
+    if (s)
+        builderAppend(vm, &state->builder, s);
+
+    return true;
+}
+
+DEF_FUNC(joinFunc)
+{
+    ASSERT(len == 1 || (len == 2 && value_isStr(FIRST_VAL)),
+           "RuntimeError: join needs an optional separator string and a collection");
+
+    Value coll = params[len - 1];
+    ASSERT(isReducible(coll), "RuntimeError: join coll is not a seq");
+
+    JoinState state;
+    state.sep = len == 2 ? value_asStr(FIRST_VAL) : NULL;
+    state.first = true;
+
+    builderInit(vm, &state.builder);
+    forEachItem(vm, coll, joinVisit, &state, exception);
+    StrObj* ret = builderFinish(vm, &state.builder);
+
+    return HAS_EXCEPTION() ? value_none() : value_obj(ret);
+}
+
+/* s itself if map changes none of its chars */
+static Value mapChars(VM* vm, StrObj* s, int (*map)(int))
+{
+    char* chars = strobj_chars(vm, s);
+
+    int i = 0;
+    while (i < s->length && map((unsigned char)chars[i]) == chars[i])
+        i++;
+    if (i == s->length)
+        return value_obj(s);
+
+    StrObj* ret = strobj_new(vm, s->length);
+    memcpy(ret->chars, chars, i);
+    for (; i < s->length; i++)
+        ret->chars[i] = (char)map((unsigned char)chars[i]);
+
+    return value_obj(ret);
+}
+
+DEF_FUNC(upperCaseFunc)
+{
+    ASSERT(len == 1 && value_isStr(FIRST_VAL), "RuntimeError: upper-case needs a string");
+
+    return mapChars(vm, value_asStr(FIRST_VAL), toupper);
+}
+
+DEF_FUNC(lowerCaseFunc)
+{
+    ASSERT(len == 1 && value_isStr(FIRST_VAL), "RuntimeError: lower-case needs a string");
+
+    return mapChars(vm, value_asStr(FIRST_VAL), tolower);
+}
+
+DEF_FUNC(trimFunc)
+{
+    ASSERT(len == 1 && value_isStr(FIRST_VAL), "RuntimeError: trim needs a string");
+
+    StrObj* s = value_asStr(FIRST_VAL);
+    char* chars = strobj_chars(vm, s);
+
+    int start = 0, end = s->length;
+    while (start < end && isspace((unsigned char)chars[start]))
+        start++;
+    while (end > start && isspace((unsigned char)chars[end - 1]))
+        end--;
+
+    return value_obj(strobj_sub(vm, s, start, end - start));
+}
+
+/* ----- record ----- */
+
+/* (record-shape* Name [fields]) makes the field layout defrecord builds records of */
+DEF_FUNC(recordShapeFunc)
+{
+    ASSERT(len == 2, "RuntimeError: record-shape* needs a name and a field vector");
+    ASSERT(value_isSymbol(FIRST_VAL), "RuntimeError: record name is not a symbol");
+    ASSERT(value_isVector(SECOND_VAL), "RuntimeError: record fields are not a vector");
+
+    VectorObj* fields = value_asVector(SECOND_VAL);
+    for (int i = 0; i < fields->count; i++)
+    {
+        Value field;
+        vectorobj_get(fields, i, &field);
+        ASSERT(value_isSymbol(field), "RuntimeError: record field is not a symbol");
+    }
+
+    ShapeObj* shape = shapeobj_new(vm, value_asSymbol(FIRST_VAL), fields->count);
+    VM_SPUSH(shape);
+
+    char buff[256];
+    for (int i = 0; i < fields->count; i++)
+    {
+        Value field;
+        vectorobj_get(fields, i, &field);
+
+        StrObj* name = value_asSymbol(field)->symbol;
+        int length = snprintf(buff, sizeof(buff), ":%s", name->chars);
+        if (length >= (int)sizeof(buff))
+        {
+            VM_SPOP(shape);
+            THROW_EXCEPTION("RuntimeError: record field name is too long");
+        }
+
+        // each field of a shape is checked against the rest
+        for (int j = 0; j < i; j++)
+        {
+            if (strobj_eq(value_asKeyword(shape->fields[j])->keyword, buff, length))
+            {
+                VM_SPOP(shape);
+                THROW_EXCEPTION("RuntimeError: duplicate record field %s", name->chars);
+            }
+        }
+
+        shape->fields[i] = value_keyword(vm, buff, length);
+    }
+
+    VM_SPOP(shape);
+    return value_obj(shape);
+}
+
+/* (record* shape & values) */
+DEF_FUNC(recordFunc)
+{
+    ASSERT(len > 0 && value_isShape(FIRST_VAL), "RuntimeError: record* needs a record type");
+
+    ShapeObj* shape = value_asShape(FIRST_VAL);
+    ASSERT(len - 1 == shape->count, "RuntimeError: %s takes %d values, got %d",
+           shape->name->symbol->chars, shape->count, (int)len - 1);
+
+    RecordObj* r = recordobj_new(vm, shape);
+    memcpy(r->slots, params + 1, sizeof(Value) * shape->count);
+    return value_obj(r);
+}
+
+DEF_FUNC(recordCheckFunc)
+{
+    ASSERT_ONE_PARAM("record?");
+
+    return value_bool(value_isRecord(FIRST_VAL));
+}
+
+/* ----- sorted ----- */
+
+/* s with the keys of a set or the key value pairs of a map in items, one assoc each */
+static Value sortedWith(VM* vm, SortedObj* s, int len, Value* items, ExceptionObj** exception)
+{
+    int step = s->isSet ? 1 : 2;
+    for (int i = 0; i + step <= len; i += step)
+    {
+        VM_SPUSH(s);
+        SortedObj* next = sortedobj_assoc(vm, s, items[i], items[i + step - 1], exception);
+        VM_SPOP(s);
+
+        if (next == NULL)
+            return value_none();
+
+        s = next;
+    }
+
+    return value_obj(s);
+}
+
+static Value sortedWithout(VM* vm, SortedObj* s, int len, Value* keys, ExceptionObj** exception)
+{
+    for (int i = 0; i < len; i++)
+    {
+        VM_SPUSH(s);
+        SortedObj* next = sortedobj_dissoc(vm, s, keys[i], exception);
+        VM_SPOP(s);
+
+        if (next == NULL)
+            return value_none();
+
+        s = next;
+    }
+
+    return value_obj(s);
+}
+
+/* list of the keys or of the values of a sorted map, in order */
+static Value sortedColumn(VM* vm, SortedObj* s, bool keys)
+{
+    VM_SPUSH(s);
+    ListObj* lobj = listobj_newWithNil(vm, s->count);
+    VM_SPOP(s);
+
+    SortedIter iter;
+    sortediter_init(s, &iter, false);
+
+    Value key, value;
+    for (int i = 0; sortediter_next(&iter, &key, &value); i++)
+        listobj_set(lobj, i, keys ? key : value);
+
+    return value_obj(lobj);
+}
+
+DEF_FUNC(sortedMapFunc)
+{
+    ASSERT(len % 2 == 0, "RuntimeError: sorted-map needs even args");
+
+    return sortedWith(vm, sortedobj_new(vm, false, value_nil()), len, params, exception);
+}
+
+DEF_FUNC(sortedMapByFunc)
+{
+    ASSERT(len > 0 && value_isCallable(FIRST_VAL), "RuntimeError: sorted-map-by needs a comparator");
+    ASSERT((len - 1) % 2 == 0, "RuntimeError: sorted-map-by needs even args");
+
+    return sortedWith(vm, sortedobj_new(vm, false, FIRST_VAL), len - 1, params + 1, exception);
+}
+
+DEF_FUNC(sortedSetFunc)
+{
+    return sortedWith(vm, sortedobj_new(vm, true, value_nil()), len, params, exception);
+}
+
+DEF_FUNC(sortedSetByFunc)
+{
+    ASSERT(len > 0 && value_isCallable(FIRST_VAL), "RuntimeError: sorted-set-by needs a comparator");
+
+    return sortedWith(vm, sortedobj_new(vm, true, FIRST_VAL), len - 1, params + 1, exception);
+}
+
+DEF_FUNC(sortedCheckFunc)
+{
+    ASSERT_ONE_PARAM("sorted?");
+
+    return value_bool(value_isSorted(FIRST_VAL));
+}
+
+/* the order sorted colls use without a comparator, as -1, 0 or 1 */
+DEF_FUNC(compareFunc)
+{
+    ASSERT(len == 2, "RuntimeError: compare needs two args");
+
+    int c;
+    if (!value_compare(FIRST_VAL, SECOND_VAL, &c))
+        THROW_EXCEPTION("RuntimeError: compare args have no order");
+
+    return value_num(c);
+}
+
+/* puts the end test (one of < <= > >=) and its key into bounds */
+static bool sortedBound(Value test, Value key, SortedBounds* bounds)
+{
+    if (!value_isFunc(test))
+        return false;
+
+    FuncPtr func = value_asFunc(test)->func;
+    if (func == greatFunc || func == greatEqFunc)
+    {
+        bounds->hasLow = true;
+        bounds->lowInclusive = func == greatEqFunc;
+        bounds->low = key;
+        return true;
+    }
+
+    if (func == lessFunc || func == lessEqFunc)
+    {
+        bounds->hasHigh = true;
+        bounds->highInclusive = func == lessEqFunc;
+        bounds->high = key;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * (subseq sc test key) or (subseq sc start-test start-key end-test end-key),
+ * the tests being < <= > or >=; seeks to the start key and walks the tree
+ * from there instead of filtering every key
+ */
+static Value subseq(VM* vm, bool reverse, const char* name, int len, Value* params, ExceptionObj** exception)
+{
+    ASSERT((len == 3 || len == 5) && value_isSorted(FIRST_VAL),
+           "RuntimeError: %s needs a sorted coll and one or two tests and keys", name);
+
+    SortedBounds bounds = { 0 };
+    bool ok = sortedBound(params[1], params[2], &bounds);
+    if (ok && len == 5)
+        ok = bounds.hasLow && sortedBound(params[3], params[4], &bounds) && bounds.hasHigh;
+
+    ASSERT(ok, "RuntimeError: %s tests must be > or >= then < or <=", name);
+
+    return sortedItems(vm, value_asSorted(FIRST_VAL), &bounds, reverse, exception);
+}
+
+DEF_FUNC(subseqFunc)
+{
+    return subseq(vm, false, "subseq", len, params, exception);
+}
+
+DEF_FUNC(rsubseqFunc)
+{
+    return subseq(vm, true, "rsubseq", len, params, exception);
+}
+
+/* ----- set ----- */
+
+DEF_FUNC(hashSetFunc)
+{
+    if (!realizeParams(vm, len, params, exception))
+        return value_none();
+
+    return value_setWithArr(vm, len, params);
+}
+
+DEF_FUNC(setFunc)
+{
+    ASSERT_ONE_PARAM("set");
+    ASSERT(isReducible(FIRST_VAL), "RuntimeError: set arg is not a seq");
+
+    if (value_isSet(FIRST_VAL))
+        return FIRST_VAL;
+
+    SetObj* newSet = setobj_new(vm, mapobj_new(vm, 0));
+
+    VM_SPUSH(newSet);
+    bool ok = forEachItem(vm, FIRST_VAL, intoVisit, newSet, exception);
+    VM_SPOP(newSet);
+
+    if (!ok)
+        return value_none();
+
+    CWRITE_BARRIER(vm, newSet->map);
+    return value_obj(newSet);
+}
+
+DEF_FUNC(setCheckFunc)
+{
+    ASSERT_ONE_PARAM("set?");
+
+    return value_bool(value_isSet(FIRST_VAL) || value_isSortedSet(FIRST_VAL));
+}
+
+DEF_FUNC(disjFunc)
+{
+    ASSERT(len > 0 && (value_isSet(FIRST_VAL) || value_isSortedSet(FIRST_VAL)),
+           "RuntimeError: disj first argument must be a set");
+
+    if (value_isSorted(FIRST_VAL))
+        return sortedWithout(vm, value_asSorted(FIRST_VAL), len - 1, params + 1, exception);
+
+    if (!realizeKeys(vm, len, params, 1, 1, exception))
+        return value_none();
+
+    SetObj* oldSet = value_asSet(FIRST_VAL);
+    if (len <= 2)
+        return len == 2 ? value_obj(setobj_disj(vm, oldSet, SECOND_VAL)) : FIRST_VAL;
+
+    // one copy for all items, removed from it in place
+    SetObj* newSet = setobj_new(vm, mapobj_clone(vm, oldSet->map));
+    VM_SPUSH(newSet);
+
+    for (int i = 1; i < len; i++)
+        mapobj_del(vm, newSet->map, params[i]);
+
+    VM_SPOP(newSet);
+
+    newSet->meta = oldSet->meta;
+    return value_obj(newSet);
+}
+
+typedef enum
+{
+    SET_UNION,
+    SET_INTERSECTION,
+    SET_DIFFERENCE,
+} SetOp;
+
+/**
+ * union copies the biggest set and adds the others to it, intersection keeps
+ * the items of the smallest which are in all others, difference copies the
+ * first and removes the others; each copy is O(1) and edited in place
+ */
+static Value setOp(VM* vm, SetOp op, const char* name, int len, Value* params, ExceptionObj** exception)
+{
+    ASSERT(len > 0, "RuntimeError: %s needs at least one set", name);
+    for (int i = 0; i < len; i++)
+        ASSERT(value_isSet(params[i]), "RuntimeError: %s arg is not a set", name);
+
+    if (len == 1)
+        return FIRST_VAL;
+
+    int first = 0;
+    for (int i = 1; op != SET_DIFFERENCE && i < len; i++)
+    {
+        int count = value_asSet(params[i])->map->count;
+        int firstCount = value_asSet(params[first])->map->count;
+        if (op == SET_UNION ? count > firstCount : count < firstCount)
+            first = i;
+    }
+
+    MapObj* from = value_asSet(params[first])->map;
+    MapObj* map = op == SET_INTERSECTION ? mapobj_new(vm, 0) : mapobj_clone(vm, from);
+    VM_SPUSH(map);
+
+    if (op == SET_INTERSECTION)
+    {
+        MapIter iter;
+        mapobj_iterInit(from, &iter);
+
+        Value item;
+        while (mapobj_iterNext(&iter, &item, NULL))
+        {
+            bool inAll = true;
+            for (int i = 0; inAll && i < len; i++)
+                inAll = i == first || mapobj_get(vm, value_asSet(params[i])->map, item, NULL);
+
+            if (inAll)
+                mapobj_set(vm, map, item, item);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < len; i++)
+        {
+            if (i == first)
+                continue;
+
+            MapIter iter;
+            mapobj_iterInit(value_asSet(params[i])->map, &iter);
+
+            Value item;
+            while (mapobj_iterNext(&iter, &item, NULL))
+            {
+                if (op == SET_UNION)
+                    mapobj_set(vm, map, item, item);
+                else
+                    mapobj_del(vm, map, item);
+            }
+        }
+    }
+
+    SetObj* newSet = setobj_new(vm, map);
+    VM_SPOP(map);
+
+    return value_obj(newSet);
+}
+
+DEF_FUNC(unionFunc)
+{
+    return setOp(vm, SET_UNION, "union", len, params, exception);
+}
+
+DEF_FUNC(intersectionFunc)
+{
+    return setOp(vm, SET_INTERSECTION, "intersection", len, params, exception);
+}
+
+DEF_FUNC(differenceFunc)
+{
+    return setOp(vm, SET_DIFFERENCE, "difference", len, params, exception);
+}
+
+DEF_FUNC(assocFunc)
+{
+    ASSERT(value_isMap(FIRST_VAL) || value_isVectorLike(FIRST_VAL) || value_isRecord(FIRST_VAL)
+           || value_isSortedMap(FIRST_VAL),
+           "RuntimeError: assoc arg is not a map or vector");
+    ASSERT(len > 1 && (len - 1) % 2 == 0, "RuntimeError: assoc need even change args");
+
+    if (value_isSorted(FIRST_VAL))
+        return sortedWith(vm, value_asSorted(FIRST_VAL), len - 1, params + 1, exception);
+
+    if (!realizeKeys(vm, len, params, 1, 2, exception))
+        return value_none();
+
+    if (value_isRecord(FIRST_VAL))
+    {
+        RecordObj* oldRecord = value_asRecord(FIRST_VAL);
+
+        // a key outside the fields turns the record into a map
+        bool fieldsOnly = true;
+        for (size_t i = 1; i < len && fieldsOnly; i += 2)
+            fieldsOnly = recordobj_slot(vm, oldRecord, params[i]) >= 0;
+
+        if (!fieldsOnly)
+        {
+            MapObj* newMap = recordobj_toMap(vm, oldRecord);
+            VM_SPUSH(newMap);
+
+            for (size_t i = 1; i < len; i += 2)
+                mapobj_set(vm, newMap, params[i], params[i + 1]);
+
+            VM_SPOP(newMap);
+            return value_obj(newMap);
+        }
+
+        RecordObj* newRecord = recordobj_clone(vm, oldRecord);
+        for (size_t i = 1; i < len; i += 2)
+            newRecord->slots[recordobj_slot(vm, newRecord, params[i])] = params[i + 1];
+
+        return value_obj(newRecord);
+    }
+
+    if (value_isSubvec(FIRST_VAL))
+    {
+        SliceObj* newSlice = value_asSlice(FIRST_VAL);
+        for (size_t i = 1; i < len; i += 2)
+        {
+            ASSERT(value_isInt(params[i]), "RuntimeError: assoc vector index is not an integer");
+
+            int index = (int)value_asNum(params[i]);
+            if (index < 0 || index > newSlice->count)
+                THROW_EXCEPTION("assoc index out of range (%d/%d)", index, newSlice->count);
+
+            VM_SPUSH(newSlice);
+            SliceObj* next = sliceobj_assoc(vm, newSlice, index, params[i + 1]);
+            VM_SPOP(newSlice);
+            newSlice = next;
+        }
+
+        return value_obj(newSlice);
+    }
+
+    if (value_isVector(FIRST_VAL))
+    {
+        VectorObj* oldVector = value_asVector(FIRST_VAL);
+
+        // checked up front, the builder below can't bail out half way
+        int count = oldVector->count;
+        for (size_t i = 1; i < len; i += 2)
+        {
+            ASSERT(value_isInt(params[i]), "RuntimeError: assoc vector index is not an integer");
+
+            int index = (int)value_asNum(params[i]);
+            if (index < 0 || index > count)
+                THROW_EXCEPTION("assoc index out of range (%d/%d)", index, count);
+
+            if (index == count)
+                count++;
+        }
+
+        if (len == 3)
+            return value_obj(vectorobj_assoc(vm, oldVector, (int)value_asNum(SECOND_VAL), params[2]));
+
+        VectorObj* newVector = vectorobj_transient(vm, oldVector);
+        VM_SPUSH(newVector);
+
+        for (size_t i = 1; i < len; i += 2)
+            vectorobj_assocInPlace(vm, newVector, (int)value_asNum(params[i]), params[i + 1]);
+
+        VM_SPOP(newVector);
+
+        vectorobj_persistent(newVector);
+        newVector->meta = oldVector->meta;
+        return value_obj(newVector);
+    }
+
+    MapObj* oldMap = value_asMap(FIRST_VAL);
+
+    MapObj* newMap = mapobj_clone(vm, oldMap);
+
+    VM_PUSH(newMap);
+
+    for (size_t i = 1; i < len; i += 2)
+        mapobj_set(vm, newMap, params[i], params[i + 1]);
+
+    VM_POP(newMap);
+
+    return value_obj(newMap);
+}
+
+DEF_FUNC(dissocFunc)
+{
+    ASSERT(value_isMap(FIRST_VAL) || value_isRecord(FIRST_VAL) || value_isSortedMap(FIRST_VAL),
+           "RuntimeError: dissoc arg is not a map");
+
+    if (value_isSorted(FIRST_VAL))
+        return sortedWithout(vm, value_asSorted(FIRST_VAL), len - 1, params + 1, exception);
+
+    if (!realizeKeys(vm, len, params, 1, 1, exception))
+        return value_none();
+
+    if (value_isRecord(FIRST_VAL))
+    {
+        // a record without one of its fields is a map
+        RecordObj* r = value_asRecord(FIRST_VAL);
+        bool hasField = false;
+        for (size_t i = 1; i < len && !hasField; i++)
+            hasField = recordobj_slot(vm, r, params[i]) >= 0;
+
+        if (!hasField)
+            return FIRST_VAL;
+
+        MapObj* newMap = recordobj_toMap(vm, r);
+        VM_SPUSH(newMap);
+
+        for (size_t i = 1; i < len; i++)
+            mapobj_del(vm, newMap, params[i]);
+
+        VM_SPOP(newMap);
+        return value_obj(newMap);
+    }
+
+    MapObj* oldMap = value_asMap(FIRST_VAL);
+
+    if (len == 2)
+        return value_obj(mapobj_dissoc(vm, oldMap, SECOND_VAL));
+
+    // one copy for all keys, removed from it in place
+    MapObj* newMap = mapobj_clone(vm, oldMap);
+
+    VM_SPUSH(newMap);
+
+    for (size_t i = 1; i < len; i++)
+        mapobj_del(vm, newMap, params[i]);
+
+    VM_SPOP(newMap);
+
+    return value_obj(newMap);
+}
+
+DEF_FUNC(getFunc)
+{
+    ASSERT(value_isMap(FIRST_VAL) || value_isRecord(FIRST_VAL) || value_isSet(FIRST_VAL)
+           || value_isSorted(FIRST_VAL),
+           "RuntimeError: get arg is not a map");
 
-    MapObj* m = value_asMap(FIRST_VAL);
     Value ret;
-    if (mapobj_get(m, SECOND_VAL, &ret))
+    if (value_isSorted(FIRST_VAL))
+    {
+        if (sortedobj_get(vm, value_asSorted(FIRST_VAL), SECOND_VAL, &ret, exception))
+            return ret;
+
+        return HAS_EXCEPTION() ? value_none() : value_nil();
+    }
+
+    if (!value_realize(vm, SECOND_VAL, exception))
+        return value_none();
+
+    if (value_isRecord(FIRST_VAL))
+        return recordobj_get(vm, value_asRecord(FIRST_VAL), SECOND_VAL, &ret) ? ret : value_nil();
+
+    if (value_isSet(FIRST_VAL))
+        return setobj_get(vm, value_asSet(FIRST_VAL), SECOND_VAL, &ret) ? ret : value_nil();
+
+    MapObj* m = value_asMap(FIRST_VAL);
+    if (mapobj_get(vm, m, SECOND_VAL, &ret))
         return ret;
     return value_nil();
 }
 
 DEF_FUNC(containsCheckFunc)
 {
-    ASSERT(value_isMap(FIRST_VAL), "RuntimeError: contains? arg is not a map");
+    ASSERT(value_isMap(FIRST_VAL) || value_isRecord(FIRST_VAL) || value_isSet(FIRST_VAL)
+           || value_isSorted(FIRST_VAL),
+           "RuntimeError: contains? arg is not a map or set");
+
+    if (value_isSorted(FIRST_VAL))
+    {
+        bool found = sortedobj_get(vm, value_asSorted(FIRST_VAL), SECOND_VAL, NULL, exception);
+        return HAS_EXCEPTION() ? value_none() : value_bool(found);
+    }
+
+    if (!value_realize(vm, SECOND_VAL, exception))
+        return value_none();
+
+    if (value_isRecord(FIRST_VAL))
+        return value_bool(recordobj_slot(vm, value_asRecord(FIRST_VAL), SECOND_VAL) >= 0);
+
+    if (value_isSet(FIRST_VAL))
+        return value_bool(setobj_get(vm, value_asSet(FIRST_VAL), SECOND_VAL, NULL));
 
     MapObj* m = value_asMap(FIRST_VAL);
-    if (mapobj_get(m, SECOND_VAL, NULL))
+    if (mapobj_get(vm, m, SECOND_VAL, NULL))
         return VAL_TRUE;
     return VAL_FALSE;
 }
@@ -737,26 +2384,29 @@ DEF_FUNC(keysFunc)
 {
     ASSERT_ONE_PARAM("keys");
 
-    ASSERT(value_isMap(FIRST_VAL), "RuntimeError: keys arg is not a map");
+    ASSERT(value_isMap(FIRST_VAL) || value_isRecord(FIRST_VAL) || value_isSortedMap(FIRST_VAL),
+           "RuntimeError: keys arg is not a map");
 
-    MapObj* m = value_asMap(FIRST_VAL);
+    if (value_isSorted(FIRST_VAL))
+        return sortedColumn(vm, value_asSorted(FIRST_VAL), true);
 
-    int mlen = m->table.count;
+    if (value_isRecord(FIRST_VAL))
+    {
+        ShapeObj* shape = value_asRecord(FIRST_VAL)->shape;
+        return value_listWithArr(vm, shape->count, shape->fields);
+    }
 
-    ListObj* lobj = listobj_newWithNil(vm, mlen);
-    VM_PUSH(lobj);
+    MapObj* m = value_asMap(FIRST_VAL);
 
-    uint32_t* keys = CALLOCATE(vm, uint32_t, mlen);
-    table_keys(&m->table, keys);
+    ListObj* lobj = listobj_newWithNil(vm, m->count);
+    VM_PUSH(lobj);
 
-    MapObjEntry entry;
-    for (size_t i = 0; i < mlen; i++)
-    {
-        table_get(&m->table, keys[i], &entry);
-        listobj_set(lobj, i, entry.key);
-    }
+    MapIter iter;
+    mapobj_iterInit(m, &iter);
 
-    CFREE_ARRAY(vm, uint32_t, keys, mlen);
+    Value key;
+    for (size_t i = 0; mapobj_iterNext(&iter, &key, NULL); i++)
+        listobj_set(lobj, i, key);
 
     VM_POP(lobj);
 
@@ -767,26 +2417,29 @@ DEF_FUNC(valsFunc)
 {
     ASSERT_ONE_PARAM("vals");
 
-    ASSERT(value_isMap(FIRST_VAL), "RuntimeError: vals arg is not a map");
+    ASSERT(value_isMap(FIRST_VAL) || value_isRecord(FIRST_VAL) || value_isSortedMap(FIRST_VAL),
+           "RuntimeError: vals arg is not a map");
 
-    MapObj* m = value_asMap(FIRST_VAL);
+    if (value_isSorted(FIRST_VAL))
+        return sortedColumn(vm, value_asSorted(FIRST_VAL), false);
 
-    int mlen = m->table.count;
+    if (value_isRecord(FIRST_VAL))
+    {
+        RecordObj* r = value_asRecord(FIRST_VAL);
+        return value_listWithArr(vm, r->shape->count, r->slots);
+    }
 
-    ListObj* lobj = listobj_newWithNil(vm, mlen);
-    VM_PUSH(lobj);
+    MapObj* m = value_asMap(FIRST_VAL);
 
-    uint32_t* keys = CALLOCATE(vm, uint32_t, mlen);
-    table_keys(&m->table, keys);
+    ListObj* lobj = listobj_newWithNil(vm, m->count);
+    VM_PUSH(lobj);
 
-    MapObjEntry entry;
-    for (size_t i = 0; i < mlen; i++)
-    {
-        table_get(&m->table, keys[i], &entry);
-        listobj_set(lobj, i, entry.value);
-    }
+    MapIter iter;
+    mapobj_iterInit(m, &iter);
 
-    CFREE_ARRAY(vm, uint32_t, keys, mlen);
+    Value value;
+    for (size_t i = 0; mapobj_iterNext(&iter, NULL, &value); i++)
+        listobj_set(lobj, i, value);
 
     VM_POP(lobj);
 
@@ -798,7 +2451,7 @@ DEF_FUNC(readlineFunc)
     ASSERT(value_isStr(FIRST_VAL), "RuntimeError: readline arg is not a string");
 
     StrObj* sobj = value_asStr(FIRST_VAL);
-    printf("%s", sobj->chars);
+    printf("%s", strobj_cstr(vm, sobj));
 
     char input[256];
     if (fgets(input, 256, stdin))
@@ -886,36 +2539,45 @@ DEF_FUNC(seqFunc)
     }
     else if (value_isList(FIRST_VAL))
     {
-        if (value_asList(FIRST_VAL)->items.count == 0)
+        if (value_asList(FIRST_VAL)->count == 0)
             return value_nil();
         else
             return FIRST_VAL;
     }
-    else if (value_isVector(FIRST_VAL))
+    else if (value_isVector(FIRST_VAL) || value_isSlice(FIRST_VAL))
     {
-        VectorObj* vobj = value_asVector(FIRST_VAL);
-        if (vobj->items.count == 0)
+        int count = value_listLikeCount(FIRST_VAL);
+        if (count == 0)
             return value_nil();
+        else if (value_isSlice(FIRST_VAL) && !value_asSlice(FIRST_VAL)->isVector)
+            return FIRST_VAL;
         else
-            return value_listWithArr(vm, vobj->items.count, vobj->items.data);
+            return value_obj(sliceobj_new(vm, FIRST_VAL, 0, count, false));
     }
-    else if (value_isStr(FIRST_VAL))
+    else if (value_isLazySeq(FIRST_VAL))
+    {
+        LazySeqObj* ls = value_asLazySeq(FIRST_VAL);
+        if (!lazyseqobj_realize(vm, ls, exception))
+            return value_none();
+
+        return ls->length == 0 ? value_nil() : FIRST_VAL;
+    }
+    else if (value_isSet(FIRST_VAL))
     {
-        StrObj* sobj = value_asStr(FIRST_VAL);
-        if (sobj->length == 0)
+        if (value_asSet(FIRST_VAL)->map->count == 0)
             return value_nil();
         else
-        {
-            ListObj* lobj = listobj_newWithNil(vm, sobj->length);
-            VM_PUSH(lobj);
-
-            for (int i = 0; i < sobj->length; i++)
-                listobj_set(lobj, i, value_str(vm, &sobj->chars[i], 1));
-
-            VM_POP(lobj);
-
-            return value_obj(lobj);
-        }
+            return setItems(vm, value_asSet(FIRST_VAL));
+    }
+    else if (value_isSorted(FIRST_VAL))
+    {
+        return sortedItems(vm, value_asSorted(FIRST_VAL), NULL, false, exception);
+    }
+    else if (value_isStr(FIRST_VAL))
+    {
+        // one char string at a time, as they are used
+        LazySeqObj* ls = lazyseqobj_newOfStr(vm, value_asStr(FIRST_VAL));
+        return ls ? value_obj(ls) : value_nil();
     }
 
     ASSERT(false, "RuntimeError: seq type not support");
@@ -923,50 +2585,315 @@ DEF_FUNC(seqFunc)
 
 DEF_FUNC(conjFunc)
 {
-    ASSERT(value_isListLike(FIRST_VAL), "RuntimeError: conj first argument must be listlike");
+    ASSERT(value_isSeq(FIRST_VAL) || value_isSet(FIRST_VAL) || value_isSortedSet(FIRST_VAL),
+           "RuntimeError: conj first argument must be listlike");
 
-    if (value_isList(FIRST_VAL))
+    if (value_isSorted(FIRST_VAL))
+        return sortedWith(vm, value_asSorted(FIRST_VAL), len - 1, params + 1, exception);
+
+    if (value_isSet(FIRST_VAL))
+    {
+        if (!realizeKeys(vm, len, params, 1, 1, exception))
+            return value_none();
+
+        SetObj* oldSet = value_asSet(FIRST_VAL);
+        if (len <= 2)
+            return len == 2 ? value_obj(setobj_conj(vm, oldSet, SECOND_VAL)) : FIRST_VAL;
+
+        // one copy for all items, added to it in place
+        SetObj* newSet = setobj_new(vm, mapobj_clone(vm, oldSet->map));
+        VM_SPUSH(newSet);
+
+        for (int i = 1; i < len; i++)
+            mapobj_set(vm, newSet->map, params[i], params[i]);
+
+        VM_SPOP(newSet);
+
+        newSet->meta = oldSet->meta;
+        return value_obj(newSet);
+    }
+
+    if (value_isSubvec(FIRST_VAL))
+    {
+        // conj sets the item after the view in the vector it views
+        SliceObj* newSlice = value_asSlice(FIRST_VAL);
+        for (int i = 1; i < len; i++)
+        {
+            VM_SPUSH(newSlice);
+            SliceObj* next = sliceobj_assoc(vm, newSlice, newSlice->count, params[i]);
+            VM_SPOP(newSlice);
+            newSlice = next;
+        }
+
+        return value_obj(newSlice);
+    }
+
+    if (value_isLazySeq(FIRST_VAL))
     {
-        ListObj* rawList = value_asList(FIRST_VAL);
-        ListObj* newList = listobj_newWithNil(vm, rawList->items.count + len - 1);
-        for (int i = len - 1; i > 0; i--)
+        Obj* newSeq = value_asObj(FIRST_VAL);
+        for (int i = 1; i < len; i++)
         {
-            listobj_set(newList, len - 1 - i, params[i]);
+            VM_SPUSH(newSeq);
+            Obj* next = (Obj*)lazyseqobj_cons(vm, params[i], newSeq);
+            VM_SPOP(newSeq);
+            newSeq = next;
         }
 
-        for (int i = len - 1; i < len + rawList->items.count - 1; i++)
+        return value_obj(newSeq);
+    }
+
+    if (value_isList(FIRST_VAL) || value_isSlice(FIRST_VAL))
+    {
+        ListObj* newList = value_isList(FIRST_VAL) ? value_asList(FIRST_VAL)
+                                                   : listobj_newWithListLike(vm, FIRST_VAL, 0);
+        for (int i = 1; i < len; i++)
         {
-            LIST_GET_CHILD(rawList, i - len + 1, tempValue);
-            listobj_set(newList, i, tempValue);
+            VM_SPUSH(newList);
+            ListObj* next = listobj_cons(vm, params[i], newList);
+            VM_SPOP(newList);
+            newList = next;
         }
 
         return value_obj(newList);
     }
     else
     {
-        VectorObj* rawVector = value_asVector(FIRST_VAL);
-        VectorObj* newVector = vectorobj_newWithNil(vm, rawVector->items.count + len - 1);
-        for (int i = 0; i < rawVector->items.count; i++)
+        VectorObj* oldVector = value_asVector(FIRST_VAL);
+        if (len <= 2)
+            return len == 2 ? value_obj(vectorobj_conj(vm, oldVector, SECOND_VAL)) : FIRST_VAL;
+
+        VectorObj* newVector = vectorobj_transient(vm, oldVector);
+        VM_SPUSH(newVector);
+
+        for (int i = 1; i < len; i++)
+            vectorobj_conjInPlace(vm, newVector, params[i]);
+
+        VM_SPOP(newVector);
+
+        vectorobj_persistent(newVector);
+        newVector->meta = oldVector->meta;
+        return value_obj(newVector);
+    }
+}
+
+/* ----- transient ----- */
+
+DEF_FUNC(transientFunc)
+{
+    ASSERT_ONE_PARAM("transient");
+
+    Obj* coll;
+    if (value_isVector(FIRST_VAL))
+        coll = (Obj*)vectorobj_transient(vm, value_asVector(FIRST_VAL));
+    else if (value_isSubvec(FIRST_VAL))
+        coll = (Obj*)vectorobj_transient(vm, sliceobj_toVector(vm, value_asSlice(FIRST_VAL)));
+    else if (value_isMap(FIRST_VAL))
+        coll = (Obj*)mapobj_clone(vm, value_asMap(FIRST_VAL));
+    else
+        THROW_EXCEPTION("RuntimeError: transient arg is not a vector or map");
+
+    return value_obj(transientobj_new(vm, coll));
+}
+
+/* the coll behind a live transient, NULL with an exception otherwise */
+static Obj* transientColl(VM* vm, Value v, const char* funcName, ExceptionObj** exception)
+{
+    if (!value_isTransient(v))
+    {
+        THROW("RuntimeError: %s arg is not a transient", funcName);
+        return NULL;
+    }
+
+    Obj* coll = value_asTransient(v)->coll;
+    if (coll == NULL)
+        THROW("RuntimeError: %s on a transient after persistent!", funcName);
+
+    return coll;
+}
+
+DEF_FUNC(persistentFunc)
+{
+    ASSERT_ONE_PARAM("persistent!");
+
+    Obj* coll = transientColl(vm, FIRST_VAL, "persistent!", exception);
+    if (coll == NULL)
+        return value_none();
+
+    if (obj_isVector(coll))
+        vectorobj_persistent(obj_asVector(coll));
+
+    value_asTransient(FIRST_VAL)->coll = NULL;
+    return value_obj(coll);
+}
+
+DEF_FUNC(transientConjFunc)
+{
+    Obj* coll = transientColl(vm, FIRST_VAL, "conj!", exception);
+    if (coll == NULL)
+        return value_none();
+
+    for (int i = 1; i < len; i++)
+    {
+        if (obj_isVector(coll))
         {
-            VECTOR_GET_CHILD(rawVector, i, tempValue);
-            vectorobj_set(newVector, i, tempValue);
+            vectorobj_conjInPlace(vm, obj_asVector(coll), params[i]);
+            continue;
         }
 
-        for (int i = rawVector->items.count; i < rawVector->items.count + len - 1; i++)
+        Value entry = params[i];
+        ASSERT(value_isVector(entry) && value_asVector(entry)->count == 2,
+               "RuntimeError: conj! to a map takes [key value] vectors");
+
+        VECTOR_GET_CHILD(value_asVector(entry), 0, key);
+        VECTOR_GET_CHILD(value_asVector(entry), 1, value);
+        if (!value_realize(vm, key, exception))
+            return value_none();
+
+        mapobj_set(vm, obj_asMap(coll), key, value);
+        CWRITE_BARRIER(vm, coll);
+    }
+
+    return FIRST_VAL;
+}
+
+DEF_FUNC(transientAssocFunc)
+{
+    Obj* coll = transientColl(vm, FIRST_VAL, "assoc!", exception);
+    if (coll == NULL)
+        return value_none();
+
+    ASSERT(len > 1 && (len - 1) % 2 == 0, "RuntimeError: assoc! need even change args");
+
+    if (obj_isMap(coll) && !realizeKeys(vm, len, params, 1, 2, exception))
+        return value_none();
+
+    for (int i = 1; i < len; i += 2)
+    {
+        if (obj_isMap(coll))
         {
-            vectorobj_set(newVector, i, params[i - rawVector->items.count + 1]);
+            mapobj_set(vm, obj_asMap(coll), params[i], params[i + 1]);
+            CWRITE_BARRIER(vm, coll);
+            continue;
         }
 
-        return value_obj(newVector);
+        VectorObj* vo = obj_asVector(coll);
+        ASSERT(value_isInt(params[i]), "RuntimeError: assoc! vector index is not an integer");
+
+        int index = (int)value_asNum(params[i]);
+        if (index < 0 || index > vo->count)
+            THROW_EXCEPTION("assoc! index out of range (%d/%d)", index, vo->count);
+
+        vectorobj_assocInPlace(vm, vo, index, params[i + 1]);
     }
+
+    return FIRST_VAL;
+}
+
+DEF_FUNC(transientDissocFunc)
+{
+    Obj* coll = transientColl(vm, FIRST_VAL, "dissoc!", exception);
+    if (coll == NULL)
+        return value_none();
+
+    ASSERT(obj_isMap(coll), "RuntimeError: dissoc! arg is not a transient map");
+
+    if (!realizeKeys(vm, len, params, 1, 1, exception))
+        return value_none();
+
+    for (int i = 1; i < len; i++)
+        mapobj_del(vm, obj_asMap(coll), params[i]);
+
+    CWRITE_BARRIER(vm, coll);
+    return FIRST_VAL;
 }
 
 DEF_FUNC(gcFunc)
 {
+    // objs can't move under running c frames, compaction waits for the next top level
+    // form of the repl or of the file being run
+    if (len > 0 && value_isKeyword(FIRST_VAL)
+        && strobj_eq(value_asKeyword(FIRST_VAL)->keyword, ":compact", 8))
+    {
+        vm->compactRequested = true;
+        return value_nil();
+    }
+
     ccollectGarbage(vm);
     return value_nil();
 }
 
+/*
+ * (gc-config! :min-heap n :max-heap n :heap-limit n :target-percent n), returns
+ * the resulting config. Scripts may only tighten an existing heap limit.
+ */
+DEF_FUNC(gcConfigFunc)
+{
+    ASSERT(len % 2 == 0, "RuntimeError: gc-config! needs key value pairs");
+
+    VMConfig config = vm->config;
+
+    for (size_t i = 0; i < len; i += 2)
+    {
+        ASSERT(value_isKeyword(params[i]), "RuntimeError: gc-config! key is not a keyword");
+        ASSERT(value_isNum(params[i + 1]) && value_asNum(params[i + 1]) >= 0,
+               "RuntimeError: gc-config! value is not a non-negative number");
+        // (double)SIZE_MAX rounds up, a value equal to it doesn't fit either
+        ASSERT(value_asNum(params[i + 1]) < (double)SIZE_MAX, "RuntimeError: gc-config! value is too large");
+
+        StrObj* key = value_asKeyword(params[i])->keyword;
+        double num = value_asNum(params[i + 1]);
+
+        if (strobj_eq(key, ":min-heap", 9))
+            config.gcMinHeap = (size_t)num;
+        else if (strobj_eq(key, ":max-heap", 9))
+        {
+            ASSERT(num > 0, "RuntimeError: gc-config! :max-heap must be positive");
+            config.gcMaxHeap = (size_t)num;
+        }
+        else if (strobj_eq(key, ":heap-limit", 11))
+        {
+            ASSERT(vm->config.heapLimit == 0 || (num > 0 && num <= vm->config.heapLimit),
+                   "RuntimeError: gc-config! can't raise the heap limit");
+            config.heapLimit = (size_t)num;
+        }
+        else if (strobj_eq(key, ":target-percent", 15))
+        {
+            ASSERT(num > 0 && num <= 100, "RuntimeError: gc-config! :target-percent must be in (0, 100]");
+            config.gcTargetPercent = (float)num;
+        }
+        else
+            THROW_EXCEPTION("RuntimeError: gc-config! unknown key %s", key->chars);
+    }
+
+    ASSERT(config.gcMaxHeap == 0 || config.gcMinHeap <= config.gcMaxHeap,
+           "RuntimeError: gc-config! :min-heap is over :max-heap");
+
+    vm_setConfig(vm, &config);
+
+    Value kvs[8];
+    kvs[0] = value_keyword(vm, ":min-heap", 9);
+    VM_SPUSHV(kvs[0]);
+    kvs[1] = value_num((double)config.gcMinHeap);
+    kvs[2] = value_keyword(vm, ":max-heap", 9);
+    VM_SPUSHV(kvs[2]);
+    kvs[3] = value_num((double)config.gcMaxHeap);
+    kvs[4] = value_keyword(vm, ":heap-limit", 11);
+    VM_SPUSHV(kvs[4]);
+    kvs[5] = value_num((double)config.heapLimit);
+    kvs[6] = value_keyword(vm, ":target-percent", 15);
+    VM_SPUSHV(kvs[6]);
+    kvs[7] = value_num(config.gcTargetPercent);
+
+    Value ret = value_mapWithArr(vm, 8, kvs);
+
+    VM_SPOPV(kvs[6]);
+    VM_SPOPV(kvs[4]);
+    VM_SPOPV(kvs[2]);
+    VM_SPOPV(kvs[0]);
+
+    return ret;
+}
+
 void initCoreLib(VM* vm)
 {
     if (vm == NULL)
@@ -987,6 +2914,13 @@ void initCoreLib(VM* vm)
     vm_registerFunc(vm, "str", 3, strFunc);
     vm_registerFunc(vm, "prn", 3, prnFunc);
     vm_registerFunc(vm, "println", 7, printlnFunc);
+    vm_registerFunc(vm, "subs", 4, subsFunc);
+    vm_registerFunc(vm, "index-of", 8, indexOfFunc);
+    vm_registerFunc(vm, "split", 5, splitFunc);
+    vm_registerFunc(vm, "join", 4, joinFunc);
+    vm_registerFunc(vm, "upper-case", 10, upperCaseFunc);
+    vm_registerFunc(vm, "lower-case", 10, lowerCaseFunc);
+    vm_registerFunc(vm, "trim", 4, trimFunc);
 
     vm_registerFunc(vm, "list", 4, listFunc);
     vm_registerFunc(vm, "list?", 5, listCheckFunc);
@@ -1015,6 +2949,29 @@ void initCoreLib(VM* vm)
 
     vm_registerFunc(vm, "apply", 5, applyFunc);
     vm_registerFunc(vm, "map", 3, mapFunc);
+    vm_registerFunc(vm, "filter", 6, filterFunc);
+    vm_registerFunc(vm, "take", 4, takeFunc);
+    vm_registerFunc(vm, "drop", 4, dropFunc);
+    vm_registerFunc(vm, "range", 5, rangeFunc);
+    vm_registerFunc(vm, "lazy-seq*", 9, lazySeqFunc);
+    vm_registerFunc(vm, "doall", 5, doallFunc);
+
+    vm_registerFunc(vm, "reduce", 6, reduceFunc);
+    vm_registerFunc(vm, "reduced", 7, reducedFunc);
+    vm_registerFunc(vm, "reduced?", 8, reducedCheckFunc);
+    vm_registerFunc(vm, "some", 4, someFunc);
+    vm_registerFunc(vm, "every?", 6, everyFunc);
+    vm_registerFunc(vm, "into", 4, intoFunc);
+
+    vm_registerFunc(vm, "xform-comp*", 11, xformCompFunc);
+    vm_registerFunc(vm, "transduce", 9, transduceFunc);
+    vm_registerFunc(vm, "sequence", 8, sequenceFunc);
+
+    vm_registerFunc(vm, "transient", 9, transientFunc);
+    vm_registerFunc(vm, "persistent!", 11, persistentFunc);
+    vm_registerFunc(vm, "conj!", 5, transientConjFunc);
+    vm_registerFunc(vm, "assoc!", 6, transientAssocFunc);
+    vm_registerFunc(vm, "dissoc!", 7, transientDissocFunc);
 
     vm_registerFunc(vm, "nil?", 4, nilCheckFunc);
     vm_registerFunc(vm, "true?", 5, trueCheckFunc);
@@ -1025,9 +2982,28 @@ void initCoreLib(VM* vm)
     vm_registerFunc(vm, "keyword?", 8, keywordCheckFunc);
     vm_registerFunc(vm, "vector", 6, vectorFunc);
     vm_registerFunc(vm, "vector?", 7, vectorCheckFunc);
+    vm_registerFunc(vm, "subvec", 6, subvecFunc);
     vm_registerFunc(vm, "sequential?", 11, sequentialCheckFunc);
     vm_registerFunc(vm, "hash-map", 8, hashMapFunc);
     vm_registerFunc(vm, "map?", 4, mapCheckFunc);
+    vm_registerFunc(vm, "record-shape*", 13, recordShapeFunc);
+    vm_registerFunc(vm, "record*", 7, recordFunc);
+    vm_registerFunc(vm, "record?", 7, recordCheckFunc);
+    vm_registerFunc(vm, "hash-set", 8, hashSetFunc);
+    vm_registerFunc(vm, "set", 3, setFunc);
+    vm_registerFunc(vm, "set?", 4, setCheckFunc);
+    vm_registerFunc(vm, "disj", 4, disjFunc);
+    vm_registerFunc(vm, "union", 5, unionFunc);
+    vm_registerFunc(vm, "intersection", 12, intersectionFunc);
+    vm_registerFunc(vm, "difference", 10, differenceFunc);
+    vm_registerFunc(vm, "sorted-map", 10, sortedMapFunc);
+    vm_registerFunc(vm, "sorted-map-by", 13, sortedMapByFunc);
+    vm_registerFunc(vm, "sorted-set", 10, sortedSetFunc);
+    vm_registerFunc(vm, "sorted-set-by", 13, sortedSetByFunc);
+    vm_registerFunc(vm, "sorted?", 7, sortedCheckFunc);
+    vm_registerFunc(vm, "compare", 7, compareFunc);
+    vm_registerFunc(vm, "subseq", 6, subseqFunc);
+    vm_registerFunc(vm, "rsubseq", 7, rsubseqFunc);
 
     vm_registerFunc(vm, "assoc", 5, assocFunc);
     vm_registerFunc(vm, "dissoc", 6, dissocFunc);
@@ -1048,4 +3024,5 @@ void initCoreLib(VM* vm)
     vm_registerFunc(vm, "conj", 4, conjFunc);
 
     vm_registerFunc(vm, "gc", 2, gcFunc);
+    vm_registerFunc(vm, "gc-config!", 10, gcConfigFunc);
 }
@@ -0,0 +1,823 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "cheap.h"
+
+#ifdef C_WINDOWS
+#include <malloc.h>
+#endif
+
+static const uint32_t s_classSizes[HEAP_SIZE_CLASS_COUNT] = {
+    16,   32,   48,   64,   80,   96,   112,  128,
+    160,  192,  224,  256,  320,  384,  448,  512,
+    640,  768,  896,  1024, 1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192,
+};
+
+// size class index by (size + HEAP_SLOT_ALIGN - 1) / HEAP_SLOT_ALIGN
+static uint8_t s_classIndex[HEAP_MAX_SMALL_SIZE / HEAP_SLOT_ALIGN + 1];
+static bool    s_classIndexInited = false;
+
+static void initClassIndex()
+{
+    if (s_classIndexInited)
+        return;
+
+    int cls = 0;
+    for (size_t i = 0; i <= HEAP_MAX_SMALL_SIZE / HEAP_SLOT_ALIGN; i++)
+    {
+        while (s_classSizes[cls] < i * HEAP_SLOT_ALIGN)
+            cls++;
+        s_classIndex[i] = (uint8_t)cls;
+    }
+
+    s_classIndexInited = true;
+}
+
+static size_t roundUp(size_t size, size_t align)
+{
+    return (size + align - 1) & ~(align - 1);
+}
+
+static void* allocBlock(size_t size)
+{
+#ifdef C_WINDOWS
+    return _aligned_malloc(size, HEAP_PAGE_SIZE);
+#else
+    void* p = NULL;
+    if (posix_memalign(&p, HEAP_PAGE_SIZE, size) != 0)
+        return NULL;
+    return p;
+#endif
+}
+
+static void freeBlock(void* p)
+{
+#ifdef C_WINDOWS
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+static int ctz64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while ((x & 1) == 0)
+    {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* ----- page set ----- */
+
+static size_t pageHome(Heap* heap, const char* block)
+{
+    uintptr_t key = (uintptr_t)block >> HEAP_PAGE_SHIFT;
+    return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (heap->pageCapacity - 1);
+}
+
+static void pageSetInsert(Heap* heap, HeapPage* page);
+
+static void pageSetGrow(Heap* heap)
+{
+    HeapPage** oldPages = heap->pages;
+    size_t oldCapacity = heap->pageCapacity;
+
+    heap->pageCapacity = oldCapacity == 0 ? 64 : oldCapacity * 2;
+    heap->pages = ALLOCATE(HeapPage*, heap->pageCapacity);
+    memset(heap->pages, 0, sizeof(HeapPage*) * heap->pageCapacity);
+    heap->pageCount = 0;
+
+    for (size_t i = 0; i < oldCapacity; i++)
+    {
+        if (oldPages[i])
+            pageSetInsert(heap, oldPages[i]);
+    }
+
+    if (oldPages)
+        FREE_ARRAY(HeapPage*, oldPages, oldCapacity);
+}
+
+static void pageSetInsert(Heap* heap, HeapPage* page)
+{
+    if ((heap->pageCount + 1) * 4 > heap->pageCapacity * 3)
+        pageSetGrow(heap);
+
+    size_t mask = heap->pageCapacity - 1;
+    size_t i = pageHome(heap, page->block);
+    while (heap->pages[i])
+        i = (i + 1) & mask;
+
+    heap->pages[i] = page;
+    heap->pageCount++;
+}
+
+static void pageSetRemove(Heap* heap, HeapPage* page)
+{
+    size_t mask = heap->pageCapacity - 1;
+    size_t i = pageHome(heap, page->block);
+    while (heap->pages[i] != page)
+        i = (i + 1) & mask;
+
+    // backward shift deletion, keeps probe chains intact without tombstones
+    size_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (heap->pages[j] == NULL)
+            break;
+
+        size_t k = pageHome(heap, heap->pages[j]->block);
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+        {
+            heap->pages[i] = heap->pages[j];
+            i = j;
+        }
+    }
+
+    heap->pages[i] = NULL;
+    heap->pageCount--;
+}
+
+/* index of the last large page whose block starts at or before p, -1 if none */
+static ptrdiff_t largePageFloor(Heap* heap, const char* p)
+{
+    HeapPage** pages = heap->largePages.data;
+    ptrdiff_t lo = 0;
+    ptrdiff_t hi = (ptrdiff_t)heap->largePages.count - 1;
+    ptrdiff_t found = -1;
+
+    while (lo <= hi)
+    {
+        ptrdiff_t mid = lo + (hi - lo) / 2;
+        if (pages[mid]->block <= p)
+        {
+            found = mid;
+            lo = mid + 1;
+        }
+        else
+            hi = mid - 1;
+    }
+
+    return found;
+}
+
+static void largePageInsert(Heap* heap, HeapPage* page)
+{
+    HeapPageVec* v = &heap->largePages;
+    size_t i = (size_t)(largePageFloor(heap, page->block) + 1);
+
+    pagevec_push(v, page);
+    memmove(v->data + i + 1, v->data + i, sizeof(HeapPage*) * (v->count - 1 - i));
+    v->data[i] = page;
+}
+
+static void largePageRemove(Heap* heap, HeapPage* page)
+{
+    HeapPageVec* v = &heap->largePages;
+    size_t i = (size_t)largePageFloor(heap, page->block);
+
+    memmove(v->data + i, v->data + i + 1, sizeof(HeapPage*) * (v->count - 1 - i));
+    v->count--;
+}
+
+/* ----- page ----- */
+
+static HeapPage* newPage(Heap* heap, int sizeClass, size_t size)
+{
+    size_t blockSize = sizeClass < 0
+                       ? roundUp(size + HEAP_PAGE_HEADER_SIZE, HEAP_PAGE_SIZE)
+                       : HEAP_PAGE_SIZE;
+    char* block = blockSize == HEAP_PAGE_SIZE && heap->spareCount > 0
+                  ? (char*)heap->spareBlocks[--heap->spareCount]
+                  : (char*)allocBlock(blockSize);
+    if (block == NULL)
+    {
+        RLOG_ERROR("HeapError: out of memory (%zu bytes)", blockSize);
+        return NULL;
+    }
+
+    HeapPage* page = ALLOCATE(HeapPage, 1);
+    *(HeapPage**)block = page;
+
+    page->block = block;
+    page->start = block + HEAP_PAGE_HEADER_SIZE;
+    page->size = blockSize;
+    page->sizeClass = sizeClass;
+    page->slotSize = sizeClass < 0 ? (uint32_t)roundUp(size, HEAP_SLOT_ALIGN) : s_classSizes[sizeClass];
+    page->slotCount = sizeClass < 0
+                      ? 1
+                      : (uint32_t)((HEAP_PAGE_SIZE - HEAP_PAGE_HEADER_SIZE) / page->slotSize);
+    page->liveCount = 0;
+    page->bumpIndex = 0;
+    page->freeList = NULL;
+    page->inFreePages = false;
+    page->arena = false;
+    page->nextFree = NULL;
+    page->nextArena = NULL;
+    page->forward = NULL;
+
+    size_t words = HEAP_BITMAP_WORDS(page->slotCount);
+    page->allocBits = ALLOCATE(uint64_t, words);
+    memset(page->allocBits, 0, sizeof(uint64_t) * words);
+    page->markBits = ALLOCATE(uint64_t, words);
+    memset(page->markBits, 0, sizeof(uint64_t) * words);
+
+    pageSetInsert(heap, page);
+    if (sizeClass < 0)
+        largePageInsert(heap, page);
+
+    if ((uintptr_t)block < heap->lowest)
+        heap->lowest = (uintptr_t)block;
+    if ((uintptr_t)block + blockSize > heap->highest)
+        heap->highest = (uintptr_t)block + blockSize;
+
+    return page;
+}
+
+static void freePage(HeapPage* page, bool freeBlk)
+{
+    if (page->forward)
+        FREE_ARRAY(void*, page->forward, page->slotCount);
+
+    FREE_ARRAY(uint64_t, page->allocBits, HEAP_BITMAP_WORDS(page->slotCount));
+    FREE_ARRAY(uint64_t, page->markBits, HEAP_BITMAP_WORDS(page->slotCount));
+    if (freeBlk)
+        freeBlock(page->block);
+    FREE(HeapPage, page);
+}
+
+static void destroyPage(Heap* heap, HeapPage* page)
+{
+    pageSetRemove(heap, page);
+    if (page->sizeClass < 0)
+        largePageRemove(heap, page);
+
+    // pages come and go with every collection, handing their blocks straight
+    // back makes libc trim and re-fault the same memory over and over
+    bool spare = page->size == HEAP_PAGE_SIZE && heap->spareCount < HEAP_SPARE_BLOCKS;
+    if (spare)
+        heap->spareBlocks[heap->spareCount++] = page->block;
+    freePage(page, !spare);
+}
+
+static void pushFreePage(Heap* heap, HeapPage* page)
+{
+    page->nextFree = heap->freePages[page->sizeClass];
+    heap->freePages[page->sizeClass] = page;
+    page->inFreePages = true;
+}
+
+/* ----- heap ----- */
+
+void cheap_init(Heap* heap)
+{
+    initClassIndex();
+
+    heap->pages = NULL;
+    pagevec_init(&heap->largePages);
+    heap->pageCapacity = 0;
+    heap->pageCount = 0;
+    heap->usedBytes = 0;
+    heap->lowest = UINTPTR_MAX;
+    heap->highest = 0;
+
+    for (int i = 0; i < HEAP_SIZE_CLASS_COUNT; i++)
+        heap->freePages[i] = NULL;
+    heap->spareCount = 0;
+}
+
+void cheap_free(Heap* heap)
+{
+    for (size_t i = 0; i < heap->pageCapacity; i++)
+    {
+        if (heap->pages[i])
+            freePage(heap->pages[i], true);
+    }
+
+    for (int i = 0; i < heap->spareCount; i++)
+        freeBlock(heap->spareBlocks[i]);
+
+    if (heap->pages)
+        FREE_ARRAY(HeapPage*, heap->pages, heap->pageCapacity);
+    pagevec_free(&heap->largePages);
+
+    cheap_init(heap);
+}
+
+size_t cheap_slotSize(size_t size)
+{
+    if (size > HEAP_MAX_SMALL_SIZE)
+        return roundUp(size, HEAP_SLOT_ALIGN);
+
+    return s_classSizes[s_classIndex[(size + HEAP_SLOT_ALIGN - 1) / HEAP_SLOT_ALIGN]];
+}
+
+void* cheap_alloc(Heap* heap, size_t size)
+{
+    HeapPage* page;
+    char* slot;
+
+    if (size > HEAP_MAX_SMALL_SIZE)
+    {
+        page = newPage(heap, -1, size);
+        if (page == NULL)
+            return NULL;
+
+        slot = page->start;
+        page->bumpIndex = 1;
+    }
+    else
+    {
+        int cls = s_classIndex[(size + HEAP_SLOT_ALIGN - 1) / HEAP_SLOT_ALIGN];
+
+        page = heap->freePages[cls];
+        if (page == NULL)
+        {
+            page = newPage(heap, cls, size);
+            if (page == NULL)
+                return NULL;
+
+            pushFreePage(heap, page);
+        }
+
+        if (page->freeList)
+        {
+            slot = (char*)page->freeList;
+            page->freeList = *(void**)slot;
+        }
+        else
+        {
+            slot = page->start + (size_t)page->bumpIndex * page->slotSize;
+            page->bumpIndex++;
+        }
+
+        // page is full now, drop it from free pages
+        if (page->liveCount + 1 == page->slotCount)
+        {
+            heap->freePages[cls] = page->nextFree;
+            page->nextFree = NULL;
+            page->inFreePages = false;
+        }
+    }
+
+    uint32_t index = (uint32_t)((slot - page->start) / page->slotSize);
+    page->allocBits[index >> 6] |= (uint64_t)1 << (index & 63);
+    page->liveCount++;
+
+    heap->usedBytes += page->slotSize;
+
+    return slot;
+}
+
+size_t cheap_release(Heap* heap, void* p)
+{
+    HeapPage* page = cheap_findPage(heap, p);
+    if (page == NULL)
+    {
+        RLOG_ERROR("HeapError: release unknown pointer %p", p);
+        return 0;
+    }
+
+    size_t slotSize = page->slotSize;
+    heap->usedBytes -= slotSize;
+
+    uint32_t index = cheap_slotIndex(page, p);
+    page->allocBits[index >> 6] &= ~((uint64_t)1 << (index & 63));
+    page->liveCount--;
+
+    // empty large pages are destroyed by cheap_releaseEmptyPages, so pages
+    // never disappear while cheap_sweep walks them. arena slots wait for
+    // cheap_freeArena.
+    if (page->sizeClass < 0 || page->arena)
+        return slotSize;
+
+    *(void**)p = page->freeList;
+    page->freeList = p;
+
+    if (!page->inFreePages)
+        pushFreePage(heap, page);
+
+    return slotSize;
+}
+
+void cheap_releaseEmptyPages(Heap* heap)
+{
+    for (size_t i = 0; i < heap->pageCapacity;)
+    {
+        HeapPage* page = heap->pages[i];
+        if (page && page->sizeClass < 0 && page->liveCount == 0 && !page->arena)
+        {
+            // removal shifts a later page into this index, look at it again
+            destroyPage(heap, page);
+            continue;
+        }
+
+        i++;
+    }
+
+    for (int cls = 0; cls < HEAP_SIZE_CLASS_COUNT; cls++)
+    {
+        // keep one empty page per size class to avoid thrashing
+        bool keptEmpty = false;
+        HeapPage* prev = NULL;
+        HeapPage* page = heap->freePages[cls];
+
+        while (page)
+        {
+            HeapPage* next = page->nextFree;
+
+            if (page->liveCount == 0 && keptEmpty)
+            {
+                if (prev)
+                    prev->nextFree = next;
+                else
+                    heap->freePages[cls] = next;
+
+                destroyPage(heap, page);
+            }
+            else
+            {
+                if (page->liveCount == 0)
+                    keptEmpty = true;
+                prev = page;
+            }
+
+            page = next;
+        }
+    }
+}
+
+HeapPage* cheap_findPage(Heap* heap, const void* p)
+{
+    if ((uintptr_t)p < heap->lowest || (uintptr_t)p >= heap->highest)
+        return NULL;
+
+    const char* block = (const char*)((uintptr_t)p & ~(HEAP_PAGE_SIZE - 1));
+
+    size_t mask = heap->pageCapacity - 1;
+    size_t i = pageHome(heap, block);
+    while (heap->pages[i])
+    {
+        if (heap->pages[i]->block == block)
+            return heap->pages[i];
+        i = (i + 1) & mask;
+    }
+
+    // past the first HEAP_PAGE_SIZE of a large page, only its range tells
+    ptrdiff_t index = largePageFloor(heap, (const char*)p);
+    if (index >= 0)
+    {
+        HeapPage* page = heap->largePages.data[index];
+        if ((const char*)p < page->block + page->size)
+            return page;
+    }
+
+    return NULL;
+}
+
+Obj* cheap_findObj(Heap* heap, const void* p)
+{
+    HeapPage* page = cheap_findPage(heap, p);
+    if (page == NULL)
+        return NULL;
+
+    if ((const char*)p < page->start)
+        return NULL;
+
+    // interior pointers resolve to the slot which contains them
+    uint32_t index = cheap_slotIndex(page, p);
+    if (index >= page->bumpIndex)
+        return NULL;
+
+    if ((page->allocBits[index >> 6] & ((uint64_t)1 << (index & 63))) == 0)
+        return NULL;
+
+    return (Obj*)(page->start + (size_t)index * page->slotSize);
+}
+
+void cheap_sweep(Heap* heap, HeapSweepFunc freeFunc, void* ctx)
+{
+    for (size_t i = 0; i < heap->pageCapacity; i++)
+    {
+        HeapPage* page = heap->pages[i];
+        if (page == NULL)
+            continue;
+
+        size_t words = HEAP_BITMAP_WORDS(page->slotCount);
+        for (size_t w = 0; w < words; w++)
+        {
+            // a word at a time: allocated but not marked slots are dead
+            uint64_t dead = page->allocBits[w] & ~page->markBits[w];
+            while (dead)
+            {
+                size_t index = (w << 6) + ctz64(dead);
+                dead &= dead - 1;
+                freeFunc(ctx, (Obj*)(page->start + index * page->slotSize));
+            }
+
+            page->markBits[w] = 0;
+        }
+    }
+}
+
+void cheap_forEachObj(Heap* heap, HeapObjFunc func, void* ctx)
+{
+    for (size_t i = 0; i < heap->pageCapacity; i++)
+    {
+        HeapPage* page = heap->pages[i];
+        if (page == NULL || page->forward)
+            continue;
+
+        size_t words = HEAP_BITMAP_WORDS(page->slotCount);
+        for (size_t w = 0; w < words; w++)
+        {
+            uint64_t live = page->allocBits[w];
+            while (live)
+            {
+                size_t index = (w << 6) + ctz64(live);
+                live &= live - 1;
+                func(ctx, (Obj*)(page->start + index * page->slotSize));
+            }
+        }
+    }
+}
+
+float cheap_fragmentation(Heap* heap)
+{
+    size_t capacity = 0;
+    size_t used = 0;
+
+    for (size_t i = 0; i < heap->pageCapacity; i++)
+    {
+        HeapPage* page = heap->pages[i];
+        if (page == NULL || page->sizeClass < 0 || page->arena)
+            continue;
+
+        capacity += (size_t)page->slotCount * page->slotSize;
+        used += (size_t)page->liveCount * page->slotSize;
+    }
+
+    if (capacity == 0)
+        return 0.0f;
+
+    return 1.0f - (float)used / (float)capacity;
+}
+
+static int comparePageLive(const void* a, const void* b)
+{
+    uint32_t la = (*(HeapPage**)a)->liveCount;
+    uint32_t lb = (*(HeapPage**)b)->liveCount;
+    return la < lb ? 1 : (la > lb ? -1 : 0);
+}
+
+/**
+ * Move the objects of the sparsest pages of every size class into the free
+ * slots of the densest ones. The old slots keep their contents until
+ * cheap_finishEvacuate, page->forward maps them to the new slots.
+ */
+size_t cheap_evacuate(Heap* heap)
+{
+    size_t moved = 0;
+
+    for (int cls = 0; cls < HEAP_SIZE_CLASS_COUNT; cls++)
+    {
+        // evacuating a class may add pages, size the scratch array per class
+        size_t capacity = heap->pageCount;
+        HeapPage** classPages = ALLOCATE(HeapPage*, capacity);
+        size_t count = 0;
+        size_t live = 0;
+
+        for (size_t i = 0; i < heap->pageCapacity; i++)
+        {
+            HeapPage* page = heap->pages[i];
+            if (page == NULL || page->sizeClass != cls || page->liveCount == 0 || page->arena)
+                continue;
+
+            classPages[count++] = page;
+            live += page->liveCount;
+        }
+
+        if (count < 2)
+        {
+            FREE_ARRAY(HeapPage*, classPages, capacity);
+            continue;
+        }
+
+        // the densest pages have room for everything that lives in the rest
+        qsort(classPages, count, sizeof(HeapPage*), comparePageLive);
+        uint32_t slotCount = classPages[0]->slotCount;
+        size_t keep = (live + slotCount - 1) / slotCount;
+        if (keep >= count)
+        {
+            FREE_ARRAY(HeapPage*, classPages, capacity);
+            continue;
+        }
+
+        for (size_t i = keep; i < count; i++)
+        {
+            HeapPage* page = classPages[i];
+            page->forward = ALLOCATE(void*, page->slotCount);
+            memset(page->forward, 0, sizeof(void*) * page->slotCount);
+        }
+
+        // evacuated pages must not hand out slots any more
+        HeapPage* prev = NULL;
+        HeapPage* page = heap->freePages[cls];
+        while (page)
+        {
+            HeapPage* next = page->nextFree;
+            if (page->forward)
+            {
+                if (prev)
+                    prev->nextFree = next;
+                else
+                    heap->freePages[cls] = next;
+
+                page->nextFree = NULL;
+                page->inFreePages = false;
+            }
+            else
+            {
+                prev = page;
+            }
+            page = next;
+        }
+
+        for (size_t i = keep; i < count; i++)
+        {
+            HeapPage* from = classPages[i];
+            size_t words = HEAP_BITMAP_WORDS(from->slotCount);
+            for (size_t w = 0; w < words; w++)
+            {
+                uint64_t bits = from->allocBits[w];
+                while (bits)
+                {
+                    size_t index = (w << 6) + ctz64(bits);
+                    bits &= bits - 1;
+
+                    char* oldSlot = from->start + index * from->slotSize;
+                    void* newSlot = cheap_alloc(heap, from->slotSize);
+                    memcpy(newSlot, oldSlot, from->slotSize);
+                    from->forward[index] = newSlot;
+                    moved++;
+                }
+            }
+        }
+
+        FREE_ARRAY(HeapPage*, classPages, capacity);
+    }
+
+    return moved;
+}
+
+void cheap_finishEvacuate(Heap* heap)
+{
+    for (size_t i = 0; i < heap->pageCapacity;)
+    {
+        HeapPage* page = heap->pages[i];
+        if (page && page->forward)
+        {
+            heap->usedBytes -= (size_t)page->liveCount * page->slotSize;
+
+            // removal shifts a later page into this index, look at it again
+            destroyPage(heap, page);
+            continue;
+        }
+
+        i++;
+    }
+}
+
+/* ----- arena ----- */
+
+void cheap_initArena(HeapArena* arena)
+{
+    arena->pages = NULL;
+
+    for (int i = 0; i < HEAP_SIZE_CLASS_COUNT; i++)
+        arena->current[i] = NULL;
+}
+
+static HeapPage* newArenaPage(Heap* heap, HeapArena* arena, int sizeClass, size_t size)
+{
+    HeapPage* page = newPage(heap, sizeClass, size);
+    if (page == NULL)
+        return NULL;
+
+    page->arena = true;
+    page->nextArena = arena->pages;
+    arena->pages = page;
+
+    return page;
+}
+
+void* cheap_arenaAlloc(Heap* heap, HeapArena* arena, size_t size)
+{
+    HeapPage* page;
+
+    if (size > HEAP_MAX_SMALL_SIZE)
+    {
+        page = newArenaPage(heap, arena, -1, size);
+    }
+    else
+    {
+        int cls = s_classIndex[(size + HEAP_SLOT_ALIGN - 1) / HEAP_SLOT_ALIGN];
+
+        page = arena->current[cls];
+        if (page == NULL || page->bumpIndex == page->slotCount)
+        {
+            page = newArenaPage(heap, arena, cls, size);
+            arena->current[cls] = page;
+        }
+    }
+
+    if (page == NULL)
+        return NULL;
+
+    uint32_t index = page->bumpIndex++;
+    page->allocBits[index >> 6] |= (uint64_t)1 << (index & 63);
+    page->liveCount++;
+
+    heap->usedBytes += page->slotSize;
+
+    return page->start + (size_t)index * page->slotSize;
+}
+
+/**
+ * Copy every marked object of the arena into ordinary pages, page->forward
+ * maps the old slots to the copies. The copies are pushed to moved (Obj*).
+ */
+size_t cheap_evacuateArena(Heap* heap, HeapArena* arena, ObjPtrVec* moved)
+{
+    size_t count = 0;
+
+    for (HeapPage* page = arena->pages; page; page = page->nextArena)
+    {
+        size_t words = HEAP_BITMAP_WORDS(page->slotCount);
+        for (size_t w = 0; w < words; w++)
+        {
+            uint64_t bits = page->allocBits[w] & page->markBits[w];
+            if (bits == 0)
+                continue;
+
+            if (page->forward == NULL)
+            {
+                page->forward = ALLOCATE(void*, page->slotCount);
+                memset(page->forward, 0, sizeof(void*) * page->slotCount);
+            }
+
+            while (bits)
+            {
+                size_t index = (w << 6) + ctz64(bits);
+                bits &= bits - 1;
+
+                char* oldSlot = page->start + index * page->slotSize;
+                void* newSlot = cheap_alloc(heap, page->slotSize);
+                memcpy(newSlot, oldSlot, page->slotSize);
+                page->forward[index] = newSlot;
+                objvec_push(moved, (Obj*)newSlot);
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+/* hand the unmarked objects to deadFunc if not NULL, then drop every page of the arena */
+void cheap_freeArena(Heap* heap, HeapArena* arena, HeapSweepFunc deadFunc, void* ctx)
+{
+    HeapPage* page = arena->pages;
+    while (page)
+    {
+        HeapPage* next = page->nextArena;
+
+        size_t words = deadFunc ? HEAP_BITMAP_WORDS(page->slotCount) : 0;
+        for (size_t w = 0; w < words; w++)
+        {
+            uint64_t dead = page->allocBits[w] & ~page->markBits[w];
+            while (dead)
+            {
+                size_t index = (w << 6) + ctz64(dead);
+                dead &= dead - 1;
+                deadFunc(ctx, (Obj*)(page->start + index * page->slotSize));
+            }
+        }
+
+        heap->usedBytes -= (size_t)page->liveCount * page->slotSize;
+        destroyPage(heap, page);
+
+        page = next;
+    }
+
+    cheap_initArena(arena);
+}
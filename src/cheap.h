@@ -0,0 +1,147 @@
+#ifndef __C_HEAP_H_
+#define __C_HEAP_H_
+
+#include "ccommon.h"
+#include "cvec.h"
+
+#define HEAP_PAGE_SHIFT       16
+#define HEAP_PAGE_SIZE        ((size_t)1 << HEAP_PAGE_SHIFT)
+#define HEAP_SLOT_ALIGN       16
+#define HEAP_SIZE_CLASS_COUNT 32
+#define HEAP_MAX_SMALL_SIZE   8192
+#define HEAP_SPARE_BLOCKS     128 // empty page blocks (8 MB) kept for reuse instead of going back to libc
+
+#define HEAP_PAGE_HEADER_SIZE HEAP_SLOT_ALIGN
+
+/**
+ * A page is a HEAP_PAGE_SIZE aligned block carved into slots of one size class.
+ * Objects bigger than HEAP_MAX_SMALL_SIZE get a page of their own (sizeClass -1).
+ * The first HEAP_PAGE_HEADER_SIZE bytes of the block point back to the page
+ * descriptor and are never written after the page is created. Everything the
+ * collector writes (mark bits, alloc bits) lives in the descriptor, so marking
+ * doesn't dirty object pages; forked processes keep sharing them.
+ */
+typedef struct sHeapPage
+{
+    char*             block;     // HEAP_PAGE_SIZE aligned block
+    char*             start;     // first slot
+    size_t            size;      // block size in bytes
+    int               sizeClass; // -1 for large object page
+    uint32_t          slotSize;
+    uint32_t          slotCount;
+    uint32_t          liveCount;
+    uint32_t          bumpIndex; // slots before this index have been handed out once
+    void*             freeList;  // chain of freed slots
+    uint64_t*         allocBits; // slot in use
+    uint64_t*         markBits;  // slot reached by the current gc
+    bool              inFreePages;
+    bool              arena;     // owned by a HeapArena, bump allocated and freed with it
+    void**            forward;   // new slot of each moved object while the page is evacuated
+    struct sHeapPage* nextFree;  // next page of the same size class which has free slots
+    struct sHeapPage* nextArena; // next page of the same arena
+} HeapPage;
+
+DEFINE_VEC(HeapPageVec, HeapPage*, pagevec)
+
+typedef struct sHeap
+{
+    HeapPage** pages;        // open addressing set keyed by page start
+    HeapPageVec largePages;  // large object pages sorted by block, they span more than one page start
+    size_t     pageCapacity;
+    size_t     pageCount;
+    size_t     usedBytes;    // bytes handed out as slots
+    uintptr_t  lowest;       // address range covered by pages, quick reject for lookups
+    uintptr_t  highest;
+    HeapPage*  freePages[HEAP_SIZE_CLASS_COUNT];
+    void*      spareBlocks[HEAP_SPARE_BLOCKS];
+    int        spareCount;
+} Heap;
+
+/**
+ * Pages of an arena are bump allocated and never reuse freed slots. They are
+ * dropped all at once by cheap_freeArena, after cheap_evacuateArena copied the
+ * marked (escaping) objects into ordinary pages.
+ */
+typedef struct sHeapArena
+{
+    HeapPage* pages;                          // chained by nextArena
+    HeapPage* current[HEAP_SIZE_CLASS_COUNT]; // page of each size class bump allocated from
+} HeapArena;
+
+void   cheap_init(Heap* heap);
+void   cheap_free(Heap* heap);
+
+void*  cheap_alloc(Heap* heap, size_t size);
+size_t cheap_release(Heap* heap, void* p);
+size_t cheap_slotSize(size_t size);
+
+void   cheap_releaseEmptyPages(Heap* heap);
+
+HeapPage* cheap_findPage(Heap* heap, const void* p);
+Obj*      cheap_findObj(Heap* heap, const void* p);
+
+typedef void (*HeapSweepFunc)(void* ctx, Obj* obj);
+void      cheap_sweep(Heap* heap, HeapSweepFunc freeFunc, void* ctx);
+
+typedef void (*HeapObjFunc)(void* ctx, Obj* obj);
+void      cheap_forEachObj(Heap* heap, HeapObjFunc func, void* ctx);
+
+float     cheap_fragmentation(Heap* heap);
+size_t    cheap_evacuate(Heap* heap);
+void      cheap_finishEvacuate(Heap* heap);
+
+void      cheap_initArena(HeapArena* arena);
+void*     cheap_arenaAlloc(Heap* heap, HeapArena* arena, size_t size);
+size_t    cheap_evacuateArena(Heap* heap, HeapArena* arena, ObjPtrVec* moved);
+void      cheap_freeArena(Heap* heap, HeapArena* arena, HeapSweepFunc deadFunc, void* ctx);
+
+#define HEAP_BITMAP_WORDS(slotCount) (((slotCount) + 63) / 64)
+
+/* only valid for pointers to allocated slots */
+static inline HeapPage* cheap_pageOf(const void* p)
+{
+    return *(HeapPage**)((uintptr_t)p & ~(uintptr_t)(HEAP_PAGE_SIZE - 1));
+}
+
+static inline uint32_t cheap_slotIndex(HeapPage* page, const void* p)
+{
+    return (uint32_t)(((const char*)p - page->start) / page->slotSize);
+}
+
+static inline bool cheap_isMarked(const void* p)
+{
+    HeapPage* page = cheap_pageOf(p);
+    uint32_t index = cheap_slotIndex(page, p);
+    return (page->markBits[index >> 6] >> (index & 63)) & 1;
+}
+
+static inline bool cheap_inArena(const void* p)
+{
+    return cheap_pageOf(p)->arena;
+}
+
+/* new address of an object moved by cheap_evacuate, p itself otherwise */
+static inline void* cheap_forward(void* p)
+{
+    HeapPage* page = cheap_pageOf(p);
+    if (page->forward == NULL)
+        return p;
+    return page->forward[cheap_slotIndex(page, p)];
+}
+
+/* set the mark bit, returns whether it was already set */
+static inline bool cheap_testAndMark(const void* p)
+{
+    HeapPage* page = cheap_pageOf(p);
+    uint32_t index = cheap_slotIndex(page, p);
+    uint64_t bit = (uint64_t)1 << (index & 63);
+    uint64_t* word = &page->markBits[index >> 6];
+
+    if (*word & bit)
+        return true;
+
+    *word |= bit;
+    return false;
+}
+
+#endif // __C_HEAP_H_
@@ -0,0 +1,128 @@
+#include "cintern.h"
+
+#include <memory.h>
+
+#define INTERN_INIT_CAPACITY 256
+
+void cintern_init(InternTable* table)
+{
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+void cintern_free(InternTable* table)
+{
+    if (table->entries)
+        FREE_ARRAY(InternEntry, table->entries, table->capacity);
+
+    cintern_init(table);
+}
+
+StrObj* cintern_find(InternTable* table, const char* chars, int length, uint32_t hash)
+{
+    if (table->count == 0)
+        return NULL;
+
+    size_t mask = table->capacity - 1;
+    for (size_t i = hash & mask; table->entries[i].str; i = (i + 1) & mask)
+    {
+        InternEntry* entry = &table->entries[i];
+        if (entry->hash == hash
+            && entry->str->length == length
+            && (length == 0 || memcmp(entry->str->chars, chars, length) == 0))
+            return entry->str;
+    }
+
+    return NULL;
+}
+
+static void insertEntry(InternEntry* entries, size_t capacity, uint32_t hash, StrObj* str)
+{
+    size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    while (entries[i].str)
+        i = (i + 1) & mask;
+
+    entries[i].hash = hash;
+    entries[i].str = str;
+}
+
+static void grow(InternTable* table)
+{
+    size_t capacity = table->capacity == 0 ? INTERN_INIT_CAPACITY : table->capacity * 2;
+    InternEntry* entries = ALLOCATE(InternEntry, capacity);
+    memset(entries, 0, sizeof(InternEntry) * capacity);
+
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        InternEntry* entry = &table->entries[i];
+        if (entry->str)
+            insertEntry(entries, capacity, entry->hash, entry->str);
+    }
+
+    if (table->entries)
+        FREE_ARRAY(InternEntry, table->entries, table->capacity);
+
+    table->entries = entries;
+    table->capacity = capacity;
+}
+
+/* str must not be in the table yet, see cintern_find */
+void cintern_add(InternTable* table, StrObj* str)
+{
+    if ((table->count + 1) * 4 > table->capacity * 3)
+        grow(table);
+
+    insertEntry(table->entries, table->capacity, str->base.hash, str);
+    table->count++;
+}
+
+/* backward shift deletion, keeps probe chains intact without tombstones */
+static void removeAt(InternTable* table, size_t i)
+{
+    size_t mask = table->capacity - 1;
+    size_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (table->entries[j].str == NULL)
+            break;
+
+        size_t k = table->entries[j].hash & mask;
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+        {
+            table->entries[i] = table->entries[j];
+            i = j;
+        }
+    }
+
+    table->entries[i].str = NULL;
+    table->count--;
+}
+
+void cintern_sweep(InternTable* table, InternDeadFunc isDead)
+{
+    for (size_t i = 0; i < table->capacity;)
+    {
+        StrObj* str = table->entries[i].str;
+        if (str && isDead(str))
+        {
+            // removal shifts a later entry into this index, look at it again
+            removeAt(table, i);
+            continue;
+        }
+
+        i++;
+    }
+}
+
+/* func may replace the string by one with the same contents (moved objs) */
+void cintern_forEach(InternTable* table, InternEntryFunc func)
+{
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        if (table->entries[i].str)
+            func(&table->entries[i].str);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef __C_INTERN_H_
+#define __C_INTERN_H_
+
+#include "ccommon.h"
+#include "cobj.h"
+
+/**
+ * Set of interned strings, looked up by hash, length and bytes. Open
+ * addressing with linear probing; entries keep their hash so probing and
+ * growing never touch the strings. Removal shifts later entries back, so
+ * there are no tombstones and the gc can sweep the set in place.
+ */
+typedef struct sInternEntry
+{
+    uint32_t hash;
+    StrObj*  str;   // NULL for an empty entry
+} InternEntry;
+
+typedef struct sInternTable
+{
+    InternEntry* entries;
+    size_t       capacity; // power of two
+    size_t       count;
+} InternTable;
+
+typedef bool (*InternDeadFunc)(StrObj* str);
+typedef void (*InternEntryFunc)(StrObj** str);
+
+void    cintern_init(InternTable* table);
+void    cintern_free(InternTable* table);
+StrObj* cintern_find(InternTable* table, const char* chars, int length, uint32_t hash);
+void    cintern_add(InternTable* table, StrObj* str);
+void    cintern_sweep(InternTable* table, InternDeadFunc isDead);
+void    cintern_forEach(InternTable* table, InternEntryFunc func);
+
+#endif // __C_INTERN_H_
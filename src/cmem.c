@@ -1,18 +1,66 @@
 #include "cmem.h"
 
+#include <setjmp.h>
+
 #include "cprinter.h"
 #include "cvm.h"
 
-#define GC_HEAP_GROW_FACTOR 2
+#if defined(__GNUC__) || defined(__clang__)
+#define NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE
+#endif
+
+#ifdef GC_SCAN_STACK
+/**
+ * Conservatively mark every word on the C stack which points into a heap slot.
+ * Only the part of the stack below vm->stackBottom (set by the outermost
+ * vm_rep/vm_eval) belongs to the vm.
+ */
+static NOINLINE void markStack(VM* vm)
+{
+    if (vm->stackBottom == NULL)
+        return;
+
+    // spill callee saved registers into this frame, so they get scanned too
+    jmp_buf regs;
+    setjmp(regs);
+
+    uintptr_t lo = (uintptr_t)&regs;
+    uintptr_t hi = (uintptr_t)vm->stackBottom;
+    if (lo > hi)
+    {
+        uintptr_t t = lo;
+        lo = hi;
+        hi = t;
+    }
+
+    lo = (lo + sizeof(void*) - 1) & ~(uintptr_t)(sizeof(void*) - 1);
+
+    for (uintptr_t p = lo; p + sizeof(void*) <= hi; p += sizeof(void*))
+    {
+        Obj* obj = cheap_findObj(&vm->heap, *(void**)p);
+        if (obj)
+        {
+#ifdef DEBUG_GC_DETAIL
+            RLOG_DEBUG("-----B Stack -- %p", obj);
+            obj_print(obj);
+#endif
+            markObj(vm, obj);
+        }
+    }
+}
+#endif
 
 static void markRoots(VM* vm)
 {
     MARK_OBJ(vm, vm->currentEnv);
 
-    Obj* obj;
     for (size_t i = 0; i < vm->cmBlockArray.count; i++)
     {
-        array_get(&vm->cmBlockArray, i, &obj);
+        Obj* obj = objvec_get(&vm->cmBlockArray, i);
 
 #ifdef DEBUG_GC_DETAIL
         RLOG_DEBUG("-----B CompileBlock -- %p", obj);
@@ -24,7 +72,7 @@ static void markRoots(VM* vm)
 
     for (size_t i = 0; i < vm->rtblockArray.count; i++)
     {
-        array_get(&vm->rtblockArray, i, &obj);
+        Obj* obj = objvec_get(&vm->rtblockArray, i);
 
 #ifdef DEBUG_GC_DETAIL
         RLOG_DEBUG("-----B RuntimeBlock -- %p", obj);
@@ -33,6 +81,10 @@ static void markRoots(VM* vm)
 
         markObj(vm, obj);
     }
+
+#ifdef GC_SCAN_STACK
+    markStack(vm);
+#endif
 }
 
 static void blackenObj(VM* vm, Obj* obj)
@@ -48,14 +100,26 @@ static void blackenObj(VM* vm, Obj* obj)
     {
         ListObj* lobj = obj_asList(obj);
         markValue(vm, lobj->meta);
-
-        Value temp;
-        for (size_t i = 0; i < lobj->items.count; i++)
+        MARK_OBJ(vm, lobj->more);
+        if (listobj_ownsItems(lobj))
         {
-            array_get(&lobj->items, i, &temp);
-            markValue(vm, temp);
+            for (int i = 0; i < lobj->length; i++)
+                markValue(vm, lobj->items[i]);
         }
+        else
+        {
+            MARK_OBJ(vm, lobj->chunk);
+        }
+        break;
+    }
 
+    case LLO_LAZY_SEQ:
+    {
+        LazySeqObj* ls = obj_asLazySeq(obj);
+        markValue(vm, ls->fn);
+        markValue(vm, ls->src);
+        MARK_OBJ(vm, ls->chunk);
+        MARK_OBJ(vm, ls->more);
         break;
     }
 
@@ -68,6 +132,9 @@ static void blackenObj(VM* vm, Obj* obj)
 
     case LLO_STRING:
     {
+        StrObj* sobj = obj_asStr(obj);
+        MARK_OBJ(vm, sobj->left);
+        MARK_OBJ(vm, sobj->right);
         break;
     }
 
@@ -82,6 +149,7 @@ static void blackenObj(VM* vm, Obj* obj)
     {
         KeywordObj* kobj = obj_asKeyword(obj);
         MARK_OBJ(vm, kobj->keyword);
+        MARK_OBJ(vm, kobj->cacheShape);
         break;
     }
 
@@ -89,36 +157,43 @@ static void blackenObj(VM* vm, Obj* obj)
     {
         VectorObj* vobj = obj_asVector(obj);
         markValue(vm, vobj->meta);
+        MARK_OBJ(vm, vobj->root);
+        MARK_OBJ(vm, vobj->tail);
+        break;
+    }
 
-        Value temp;
-        for (size_t i = 0; i < vobj->items.count; i++)
-        {
-            array_get(&vobj->items, i, &temp);
-            markValue(vm, temp);
-        }
+    case LLO_VEC_NODE:
+    {
+        VecNode* node = obj_asVecNode(obj);
+        for (int i = 0; i < node->count; i++)
+            markValue(vm, node->slots[i]);
 
         break;
     }
 
+    case LLO_SLICE:
+    {
+        SliceObj* sobj = obj_asSlice(obj);
+        markValue(vm, sobj->meta);
+        MARK_OBJ(vm, sobj->vec);
+        break;
+    }
+
     case LLO_MAP:
     {
         MapObj* mobj = obj_asMap(obj);
         markValue(vm, mobj->meta);
 
-        int len = mobj->table.count;
-        uint32_t* keys = ALLOCATE(uint32_t, len); // use raw allocate function
-
-        table_keys(&mobj->table, keys);
-
-        MapObjEntry entry;
-        for (size_t i = 0; i < len; i++)
-        {
-            table_get(&mobj->table, keys[i], &entry);
-            markValue(vm, entry.key);
-            markValue(vm, entry.value);
-        }
+        MARK_OBJ(vm, mobj->root);
+        break;
+    }
 
-        FREE_ARRAY(uint32_t, keys, len);
+    case LLO_MAP_NODE:
+    {
+        MapNode* node = obj_asMapNode(obj);
+        int used = mapnode_slotCount(node);
+        for (int i = 0; i < used; i++)
+            markValue(vm, node->slots[i]);
 
         break;
     }
@@ -130,6 +205,74 @@ static void blackenObj(VM* vm, Obj* obj)
         break;
     }
 
+    case LLO_TRANSIENT:
+    {
+        MARK_OBJ(vm, obj_asTransient(obj)->coll);
+        break;
+    }
+
+    case LLO_REDUCED:
+    {
+        markValue(vm, obj_asReduced(obj)->val);
+        break;
+    }
+
+    case LLO_XFORM:
+    {
+        XformObj* xf = obj_asXform(obj);
+        for (int i = 0; i < xf->count; i++)
+            markValue(vm, xf->stages[i].fn);
+
+        break;
+    }
+
+    case LLO_SHAPE:
+    {
+        ShapeObj* shape = obj_asShape(obj);
+        MARK_OBJ(vm, shape->name);
+        for (int i = 0; i < shape->count; i++)
+            markValue(vm, shape->fields[i]);
+
+        break;
+    }
+
+    case LLO_SET:
+    {
+        SetObj* sobj = obj_asSet(obj);
+        markValue(vm, sobj->meta);
+        MARK_OBJ(vm, sobj->map);
+        break;
+    }
+
+    case LLO_SORTED:
+    {
+        SortedObj* sobj = obj_asSorted(obj);
+        markValue(vm, sobj->meta);
+        markValue(vm, sobj->cmp);
+        MARK_OBJ(vm, sobj->root);
+        break;
+    }
+
+    case LLO_SORTED_NODE:
+    {
+        SortedNode* node = obj_asSortedNode(obj);
+        int used = sortednode_slotCount(node);
+        for (int i = 0; i < used; i++)
+            markValue(vm, node->slots[i]);
+
+        break;
+    }
+
+    case LLO_RECORD:
+    {
+        RecordObj* r = obj_asRecord(obj);
+        MARK_OBJ(vm, r->shape);
+        for (int i = 0; i < r->shape->count; i++)
+            markValue(vm, r->slots[i]);
+
+        break;
+    }
+
     case LLO_EXCEPTION:
     {
         ExceptionObj* eobj = obj_asException(obj);
@@ -179,67 +322,72 @@ static void blackenObj(VM* vm, Obj* obj)
 
 static void traceReferences(VM* vm)
 {
-    Obj* obj;
     while (vm->grayObjArray.count > 0)
-    {
-        array_pop(&vm->grayObjArray, &obj);
-        blackenObj(vm, obj);
-    }
+        blackenObj(vm, objvec_pop(&vm->grayObjArray));
 }
 
-static void globalStringRemoveWhite(VM* vm)
+static bool isWhiteString(StrObj* str)
 {
-    int len = vm->strings.count;
-
-    if (len == 0)
-        return;
+    return !cheap_isMarked(str);
+}
 
-    uint32_t* keys = ALLOCATE(uint32_t, len);
+static void globalStringRemoveWhite(VM* vm)
+{
+    cintern_sweep(&vm->strings, isWhiteString);
+}
 
-    table_keys(&vm->strings, keys);
+static void freeWhite(void* ctx, Obj* obj)
+{
+    VM* vm = (VM*)ctx;
 
-    StrObj* temp;
-    for (size_t i = 0; i < len; i++)
-    {
-        table_get(&vm->strings, keys[i], &temp);
-        if (!temp->base.isMarked)
-            table_del(&vm->strings, keys[i]);
-    }
+#ifdef DEBUG_GC_DETAIL
+    RLOG_DEBUG("-----X free %p", obj);
+    obj_print(obj);
+#endif
 
-    FREE_ARRAY(uint32_t, keys, len);
+    obj_free(vm, obj);
 }
 
 static void sweep(VM* vm)
 {
-    Obj* prev = NULL;
-    Obj* obj = vm->objs;
+    // mark bits live in the page descriptors, the sweep clears them
+    cheap_sweep(&vm->heap, freeWhite, vm);
+}
 
-    while (obj)
-    {
-        if (obj->isMarked)
-        {
-            obj->isMarked = false;
-            prev = obj;
-            obj = obj->next;
-        }
-        else
-        {
-            Obj* temp = obj;
+static bool overHeapLimit(VM* vm)
+{
+    return vm->config.heapLimit > 0 && vm->bytesAllocated > vm->config.heapLimit;
+}
+
+static bool overBudget(VM* vm)
+{
+    return vm->budgetCeiling > 0 && vm->bytesAllocatedTotal > vm->budgetCeiling;
+}
 
-            obj = obj->next;
-            if (prev)
-                prev->next = obj;
-            else
-                vm->objs = obj;
+/*
+ * Allocations can't fail, callers don't check for NULL. Going over a limit
+ * only records the error; EVAL raises it at its next step and native loops
+ * poll it (vm_checkMemory). Until then allocations go on without collecting
+ * on each one (see cpaceGC), the overshoot is what the running builtin
+ * allocates before it returns or polls.
+ */
+static void checkLimits(VM* vm)
+{
+    if (vm->memoryError != VM_MEM_OK)
+        return;
 
-#ifdef DEBUG_GC_DETAIL
-            RLOG_DEBUG("-----X free %p", temp);
-            obj_print(temp);
-#endif
+    if (overHeapLimit(vm))
+    {
+        // last chance
+        ccollectGarbage(vm);
 
-            obj_free(vm, temp);
-        }
+        if (overHeapLimit(vm))
+            vm->memoryError = VM_MEM_HEAP_LIMIT;
     }
+
+    // a budget counts what was allocated, a gc can't give any of it back
+    if (vm->memoryError == VM_MEM_OK && overBudget(vm))
+        vm->memoryError = VM_MEM_BUDGET;
 }
 
 void* creallocate(VM* vm, void* previous, size_t oldSize, size_t newSize)
@@ -248,19 +396,127 @@ void* creallocate(VM* vm, void* previous, size_t oldSize, size_t newSize)
 
     if (newSize > oldSize)
     {
+        vm->bytesAllocatedTotal += newSize - oldSize;
+
 #if DEBUG_PRESS_GC
         ccollectGarbage(vm);
 #endif
 
         if (vm->bytesAllocated > vm->nextGC)
             ccollectGarbage(vm);
+
+        checkLimits(vm);
     }
 
     return reallocate(previous, oldSize, newSize);
 }
 
+void* callocateObj(VM* vm, size_t size)
+{
+    size_t slotSize = cheap_slotSize(size);
+    vm->bytesAllocated += slotSize;
+    vm->bytesAllocatedTotal += slotSize;
+
+#if DEBUG_PRESS_GC
+    ccollectGarbage(vm);
+#endif
+
+    if (vm->bytesAllocated > vm->nextGC)
+        ccollectGarbage(vm);
+
+    checkLimits(vm);
+
+    if (vm->arenaDepth > 0)
+        return cheap_arenaAlloc(&vm->heap, &vm->arena, size);
+
+    return cheap_alloc(&vm->heap, size);
+}
+
+void cfreeObj(VM* vm, void* p)
+{
+    vm->bytesAllocated -= cheap_release(&vm->heap, p);
+}
+
+/*
+ * For payloads allocated outside creallocate (rlib arrays). Call before the
+ * owning obj is allocated, the gc this may run must not see it half built.
+ */
+void caccountBytes(VM* vm, size_t size)
+{
+    vm->bytesAllocated += size;
+    vm->bytesAllocatedTotal += size;
+
+    if (vm->bytesAllocated > vm->nextGC)
+        ccollectGarbage(vm);
+
+    checkLimits(vm);
+}
+
+void cunaccountBytes(VM* vm, size_t size)
+{
+    vm->bytesAllocated -= size;
+}
+
+/* sets the next gc trigger from the live size, the current growth and the heap bounds */
+void cpaceGC(VM* vm)
+{
+    size_t live = vm->bytesAllocated;
+    size_t next = live + (size_t)(live * vm->gcGrowth);
+
+    if (vm->config.gcMaxHeap > 0 && next > vm->config.gcMaxHeap)
+    {
+        // the cap is soft, keep some headroom or every allocation would collect
+        size_t minNext = live + (size_t)(live * GC_MIN_GROWTH);
+        next = vm->config.gcMaxHeap > minNext ? vm->config.gcMaxHeap : minNext;
+    }
+
+    if (next < vm->config.gcMinHeap)
+        next = vm->config.gcMinHeap;
+
+    // collect before hitting the hard cap rather than in checkLimits. if the
+    // live data is over it already the MemoryError is pending, collecting at
+    // every allocation until it's raised would only go quadratic.
+    if (vm->config.heapLimit > 0 && next > vm->config.heapLimit && live < vm->config.heapLimit)
+        next = vm->config.heapLimit;
+
+    vm->nextGC = next;
+}
+
+/*
+ * Adapts the growth so the gc takes about gcTargetPercent of the cpu time:
+ * a cycle which costs more than its share of the time since the last one
+ * grows the headroom, a cheaper one shrinks it. The change per cycle is
+ * bounded so one noisy measurement can't swing the heap size.
+ */
+static void adaptGrowth(VM* vm, clock_t gcStart, clock_t gcEnd)
+{
+    double gcTime = (double)(gcEnd - gcStart);
+    double totalTime = (double)(gcEnd - vm->lastGCEnd);
+
+    if (totalTime > 0 && vm->config.gcTargetPercent > 0)
+    {
+        double ratio = (gcTime * 100.0 / totalTime) / vm->config.gcTargetPercent;
+        if (ratio < 0.5)
+            ratio = 0.5;
+        else if (ratio > 2.0)
+            ratio = 2.0;
+
+        float growth = (float)(vm->gcGrowth * ratio);
+        if (growth < GC_MIN_GROWTH)
+            growth = GC_MIN_GROWTH;
+        else if (growth > GC_MAX_GROWTH)
+            growth = GC_MAX_GROWTH;
+
+        vm->gcGrowth = growth;
+    }
+
+    vm->lastGCEnd = gcEnd;
+}
+
 void ccollectGarbage(VM* vm)
 {
+    clock_t gcStart = clock();
+
 #if DEBUG_GC
     RLOG_DEBUG("--- cmal gc begin\n");
     size_t before = vm->bytesAllocated;
@@ -272,16 +528,290 @@ void ccollectGarbage(VM* vm)
 
     globalStringRemoveWhite(vm);
     sweep(vm);
+    cheap_releaseEmptyPages(&vm->heap);
+
+    adaptGrowth(vm, gcStart, clock());
+    cpaceGC(vm);
 
-    vm->nextGC = vm->bytesAllocated * GC_HEAP_GROW_FACTOR;
+    if (vm->heap.pageCount >= GC_COMPACT_MIN_PAGES
+        && cheap_fragmentation(&vm->heap) > GC_COMPACT_FRAGMENTATION)
+        vm->compactRequested = true;
 
 #ifdef DEBUG_GC
     RLOG_DEBUG("--- cmal gc end\n");
-    RLOG_DEBUG("   collected %ld bytes (from %ld to %ld) next at %ld\n",
+    RLOG_DEBUG("   collected %ld bytes (from %ld to %ld) next at %ld, growth %.2f\n",
            before - vm->bytesAllocated,
            before,
            vm->bytesAllocated,
-           vm->nextGC);
+           vm->nextGC,
+           vm->gcGrowth);
+#endif
+}
+
+/* ----- compaction ----- */
+
+static void fixupPtr(void** ref)
+{
+    if (*ref)
+        *ref = cheap_forward(*ref);
+}
+
+static void fixupValue(Value* value)
+{
+    if (value_isObj(*value))
+        value->as.obj = (Obj*)cheap_forward(value->as.obj);
+}
+
+static void fixupObjPtrArray(ObjPtrVec* arr)
+{
+    for (size_t i = 0; i < arr->count; i++)
+        fixupPtr((void**)&arr->data[i]);
+}
+
+static void fixupStrEntry(StrObj** entry)
+{
+    fixupPtr((void**)entry);
+}
+
+static void fixupObj(void* ctx, Obj* obj)
+{
+    switch (obj->type)
+    {
+    case LLO_LIST:
+    {
+        ListObj* lobj = obj_asList(obj);
+        fixupValue(&lobj->meta);
+        fixupPtr((void**)&lobj->chunk);
+        fixupPtr((void**)&lobj->more);
+        if (listobj_ownsItems(lobj))
+        {
+            for (int i = 0; i < lobj->length; i++)
+                fixupValue(&lobj->items[i]);
+        }
+        break;
+    }
+
+    case LLO_LAZY_SEQ:
+    {
+        LazySeqObj* ls = obj_asLazySeq(obj);
+        fixupValue(&ls->fn);
+        fixupValue(&ls->src);
+        fixupPtr((void**)&ls->chunk);
+        fixupPtr((void**)&ls->more);
+        break;
+    }
+
+    case LLO_STRING:
+    {
+        fixupPtr((void**)&obj_asStr(obj)->left);
+        fixupPtr((void**)&obj_asStr(obj)->right);
+        break;
+    }
+
+    case LLO_SYMBOL:
+    {
+        fixupPtr((void**)&obj_asSymbol(obj)->symbol);
+        break;
+    }
+
+    case LLO_KEYWORD:
+    {
+        fixupPtr((void**)&obj_asKeyword(obj)->keyword);
+        fixupPtr((void**)&obj_asKeyword(obj)->cacheShape);
+        break;
+    }
+
+    case LLO_VECTOR:
+    {
+        VectorObj* vobj = obj_asVector(obj);
+        fixupValue(&vobj->meta);
+        fixupPtr((void**)&vobj->root);
+        fixupPtr((void**)&vobj->tail);
+        break;
+    }
+
+    case LLO_VEC_NODE:
+    {
+        VecNode* node = obj_asVecNode(obj);
+        for (int i = 0; i < node->count; i++)
+            fixupValue(&node->slots[i]);
+
+        break;
+    }
+
+    case LLO_SLICE:
+    {
+        SliceObj* sobj = obj_asSlice(obj);
+        fixupValue(&sobj->meta);
+        fixupPtr((void**)&sobj->vec);
+        break;
+    }
+
+    case LLO_MAP:
+    {
+        MapObj* mobj = obj_asMap(obj);
+        fixupValue(&mobj->meta);
+        fixupPtr((void**)&mobj->root);
+        break;
+    }
+
+    case LLO_MAP_NODE:
+    {
+        MapNode* node = obj_asMapNode(obj);
+        int used = mapnode_slotCount(node);
+        for (int i = 0; i < used; i++)
+            fixupValue(&node->slots[i]);
+
+        break;
+    }
+
+    case LLO_FUNCTION:
+    {
+        fixupValue(&obj_asFunc(obj)->meta);
+        break;
+    }
+
+    case LLO_ENV:
+    {
+        EnvObj* eobj = obj_asEnv(obj);
+        fixupPtr((void**)&eobj->outer);
+        fixupPtr((void**)&eobj->data);
+        break;
+    }
+
+    case LLO_CLOSURE:
+    {
+        ClosureObj* cobj = obj_asClosure(obj);
+        fixupValue(&cobj->meta);
+        fixupPtr((void**)&cobj->env);
+        fixupValue(&cobj->params);
+        fixupValue(&cobj->body);
+        break;
+    }
+
+    case LLO_ATOM:
+    {
+        fixupValue(&obj_asAtom(obj)->ref);
+        break;
+    }
+
+    case LLO_TRANSIENT:
+    {
+        fixupPtr((void**)&obj_asTransient(obj)->coll);
+        break;
+    }
+
+    case LLO_REDUCED:
+    {
+        fixupValue(&obj_asReduced(obj)->val);
+        break;
+    }
+
+    case LLO_XFORM:
+    {
+        XformObj* xf = obj_asXform(obj);
+        for (int i = 0; i < xf->count; i++)
+            fixupValue(&xf->stages[i].fn);
+
+        break;
+    }
+
+    case LLO_SHAPE:
+    {
+        ShapeObj* shape = obj_asShape(obj);
+        fixupPtr((void**)&shape->name);
+        for (int i = 0; i < shape->count; i++)
+            fixupValue(&shape->fields[i]);
+
+        break;
+    }
+
+    case LLO_SET:
+    {
+        SetObj* sobj = obj_asSet(obj);
+        fixupValue(&sobj->meta);
+        fixupPtr((void**)&sobj->map);
+        break;
+    }
+
+    case LLO_SORTED:
+    {
+        SortedObj* sobj = obj_asSorted(obj);
+        fixupValue(&sobj->meta);
+        fixupValue(&sobj->cmp);
+        fixupPtr((void**)&sobj->root);
+        break;
+    }
+
+    case LLO_SORTED_NODE:
+    {
+        SortedNode* node = obj_asSortedNode(obj);
+        int used = sortednode_slotCount(node);
+        for (int i = 0; i < used; i++)
+            fixupValue(&node->slots[i]);
+
+        break;
+    }
+
+    case LLO_RECORD:
+    {
+        RecordObj* r = obj_asRecord(obj);
+        fixupPtr((void**)&r->shape);
+        for (int i = 0; i < r->shape->count; i++)
+            fixupValue(&r->slots[i]);
+
+        break;
+    }
+
+    case LLO_EXCEPTION:
+    {
+        fixupPtr((void**)&obj_asException(obj)->info);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Moving objects is only safe when no c frame holds an obj pointer, so
+ * compaction runs between top level forms, from vm_rep before anything is
+ * read and from vm_dofile between the forms of the file (see
+ * vm->compactRequested). Host code must not keep obj pointers across it.
+ */
+void ccompactHeap(VM* vm)
+{
+    vm->compactRequested = false;
+
+    ccollectGarbage(vm);
+
+#ifdef DEBUG_GC
+    RLOG_DEBUG("--- cmal compact begin\n");
+    size_t pagesBefore = vm->heap.pageCount;
+#endif
+
+    size_t moved = cheap_evacuate(&vm->heap);
+    if (moved > 0)
+    {
+        fixupPtr((void**)&vm->env);
+        fixupPtr((void**)&vm->currentEnv);
+        fixupObjPtrArray(&vm->cmBlockArray);
+        fixupObjPtrArray(&vm->rtblockArray);
+        fixupObjPtrArray(&vm->closureStack);
+        cintern_forEach(&vm->strings, fixupStrEntry);
+
+        cheap_forEachObj(&vm->heap, fixupObj, vm);
+    }
+
+    cheap_finishEvacuate(&vm->heap);
+
+#ifdef DEBUG_GC
+    RLOG_DEBUG("--- cmal compact end\n");
+    RLOG_DEBUG("   moved %ld objs, pages from %ld to %ld\n",
+           moved,
+           pagesBefore,
+           vm->heap.pageCount);
 #endif
 }
 
@@ -294,13 +824,168 @@ void markValue(VM* vm, Value value)
 void markObj(VM* vm, Obj* obj)
 {
     if (obj == NULL) return;
-    if (obj->isMarked) return;
+    if (vm->arenaTracing && !cheap_inArena(obj)) return;
+    if (cheap_testAndMark(obj)) return;
 
 #ifdef DEBUG_GC_DETAIL
     RLOG_DEBUG("-----* mark %p", obj);
     obj_print(obj);
 #endif
 
-    obj->isMarked = true;
-    array_push(&vm->grayObjArray, &obj);
+    objvec_push(&vm->grayObjArray, obj);
+}
+
+/* ----- arena ----- */
+
+/* write barrier, holder got a ref which may point into the arena */
+void crememberWrite(VM* vm, Obj* holder)
+{
+    if (cheap_inArena(holder))
+        return;
+
+    ObjPtrVec* arr = &vm->arenaRemembered;
+    if (arr->count > 0 && objvec_top(arr) == holder)
+        return;
+
+    objvec_push(arr, holder);
+}
+
+static void markObjPtrArray(VM* vm, ObjPtrVec* arr)
+{
+    for (size_t i = 0; i < arr->count; i++)
+        markObj(vm, arr->data[i]);
+}
+
+/**
+ * Env maps change their nodes in place, so arena refs may sit in any node of a
+ * remembered map, not just in the MapObj. Walk the nodes outside the arena,
+ * the ones inside are traced or copied as usual.
+ */
+static void blackenMapNodes(VM* vm, MapNode* node)
+{
+    int used = mapnode_slotCount(node);
+    int firstChild = 2 * mapnode_pairCount(node);
+
+    for (int i = 0; i < used; i++)
+    {
+        Value v = node->slots[i];
+        if (i >= firstChild && !cheap_inArena(value_asObj(v)))
+            blackenMapNodes(vm, (MapNode*)value_asObj(v));
+        else
+            markValue(vm, v);
+    }
+}
+
+static void blackenRemembered(VM* vm, Obj* holder)
+{
+    blackenObj(vm, holder);
+
+    if (obj_isMap(holder) && obj_asMap(holder)->root && !cheap_inArena(obj_asMap(holder)->root))
+        blackenMapNodes(vm, obj_asMap(holder)->root);
+}
+
+static void fixupMapNodes(MapNode* node)
+{
+    int used = mapnode_slotCount(node);
+    int firstChild = 2 * mapnode_pairCount(node);
+
+    for (int i = 0; i < used; i++)
+    {
+        Value* v = &node->slots[i];
+        if (i >= firstChild && !cheap_inArena(value_asObj(*v)))
+            fixupMapNodes((MapNode*)value_asObj(*v));
+        else
+            fixupValue(v);
+    }
+}
+
+static void fixupRemembered(VM* vm, Obj* holder)
+{
+    fixupObj(vm, holder);
+
+    if (obj_isMap(holder) && obj_asMap(holder)->root && !cheap_inArena(obj_asMap(holder)->root))
+        fixupMapNodes(obj_asMap(holder)->root);
+}
+
+static bool isDeadArenaString(StrObj* str)
+{
+    return cheap_inArena(str) && !cheap_isMarked(str);
+}
+
+static void arenaStringRemoveDead(VM* vm)
+{
+    cintern_sweep(&vm->strings, isDeadArenaString);
+}
+
+/**
+ * Ends the outermost arena. Arena objs reachable from ret, *exception, the
+ * vm roots or an obj written through CWRITE_BARRIER escape and are copied
+ * into ordinary pages; everything else goes with the arena pages. Like
+ * compaction this moves objs, so no c frame may keep an arena obj pointer
+ * across it except through ret.
+ */
+void cleaveArena(VM* vm, Value* ret, ExceptionObj** exception)
+{
+#ifdef DEBUG_GC
+    RLOG_DEBUG("--- cmal arena end\n");
+#endif
+
+    size_t usedBefore = vm->heap.usedBytes;
+
+    // mark what escapes, the trace stops at objs outside the arena
+    vm->arenaTracing = true;
+
+    markValue(vm, *ret);
+    if (exception)
+        MARK_OBJ(vm, *exception);
+    MARK_OBJ(vm, vm->env);
+    MARK_OBJ(vm, vm->currentEnv);
+    markObjPtrArray(vm, &vm->cmBlockArray);
+    markObjPtrArray(vm, &vm->rtblockArray);
+    markObjPtrArray(vm, &vm->closureStack);
+
+    Obj** remembered = vm->arenaRemembered.data;
+    for (size_t i = 0; i < vm->arenaRemembered.count; i++)
+        blackenRemembered(vm, remembered[i]);
+
+    traceReferences(vm);
+
+    vm->arenaTracing = false;
+
+    arenaStringRemoveDead(vm);
+
+    ObjPtrVec moved;
+    objvec_init(&moved);
+
+    if (cheap_evacuateArena(&vm->heap, &vm->arena, &moved) > 0)
+    {
+        fixupValue(ret);
+        if (exception)
+            fixupPtr((void**)exception);
+        fixupPtr((void**)&vm->env);
+        fixupPtr((void**)&vm->currentEnv);
+        fixupObjPtrArray(&vm->cmBlockArray);
+        fixupObjPtrArray(&vm->rtblockArray);
+        fixupObjPtrArray(&vm->closureStack);
+        cintern_forEach(&vm->strings, fixupStrEntry);
+
+        for (size_t i = 0; i < vm->arenaRemembered.count; i++)
+            fixupRemembered(vm, remembered[i]);
+
+        for (size_t i = 0; i < moved.count; i++)
+            fixupObj(vm, moved.data[i]);
+    }
+
+#ifdef DEBUG_GC
+    RLOG_DEBUG("   %ld objs escaped\n", moved.count);
+#endif
+
+    objvec_free(&moved);
+    objvec_clear(&vm->arenaRemembered);
+
+    // objs own nothing outside their slots, the dead ones need no visit
+    cheap_freeArena(&vm->heap, &vm->arena, NULL, NULL);
+
+    // slots of the arena pages out, slots of the copies in
+    vm->bytesAllocated += vm->heap.usedBytes - usedBefore;
 }
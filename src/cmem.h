@@ -11,10 +11,31 @@
     (type*)creallocate(vm, prev, sizeof(type) * (oldCnt), sizeof(type) * (newCnt))
 #define CFREE_ARRAY(vm, type, p, oldCnt) \
     creallocate(vm, p, sizeof(type) * (oldCnt), 0)
+#define CFREE_OBJ(vm, p) \
+    cfreeObj(vm, p)
+#define CWRITE_BARRIER(vm, holder) \
+    do { \
+        if ((vm)->arenaDepth > 0) crememberWrite((vm), (Obj*)(holder)); \
+    } while (false)
 #define MARK_OBJ(vm, obj) markObj((vm), (Obj*)(obj))
 
+#if defined(__GNUC__) || defined(__clang__)
+#define CSTACK_FRAME_ADDR() __builtin_frame_address(0)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define CSTACK_FRAME_ADDR() _AddressOfReturnAddress()
+#endif
+
 void* creallocate(VM* vm, void* previous, size_t oldSize, size_t newSize);
+void* callocateObj(VM* vm, size_t size);
+void  cfreeObj(VM* vm, void* p);
+void  caccountBytes(VM* vm, size_t size);
+void  cunaccountBytes(VM* vm, size_t size);
 void  ccollectGarbage(VM* vm);
+void  ccompactHeap(VM* vm);
+void  cpaceGC(VM* vm);
+void  crememberWrite(VM* vm, Obj* holder);
+void  cleaveArena(VM* vm, Value* ret, ExceptionObj** exception);
 void  markValue(VM* vm, Value value);
 void  markObj(VM* vm, Obj* obj);
 
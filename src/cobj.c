@@ -1,5 +1,6 @@
 #include "cobj.h"
 
+#include <limits.h>
 #include <memory.h>
 
 #include "cutils.h"
@@ -9,31 +10,145 @@
 #define CALLOCATE_OBJ(vm, type, objectType) \
     (type*)allocateObject(vm, sizeof(type), objectType)
 
+// lists and vectors never compare equal, keep their hashes apart too
+#define SEQ_HASH_SEED    HASH_INIT
+#define VECTOR_HASH_SEED (HASH_INIT ^ 0x9e3779b9u)
+// low bit of a coll's hash, set when nothing in it (deep) is hashed by identity
+// e.g. a lazy seq, so its hash really stands for its value
+#define HASH_PURE 1u
+
 static Obj* allocateObject(VM* vm, size_t size, ObjType type)
 {
-    Obj* object = (Obj*)creallocate(vm, NULL, 0, size);
+    Obj* object = (Obj*)callocateObj(vm, size);
     object->type = type;
-    object->isMarked = false;
     object->hash = 0;
 
-    // record objects to global object linked list
-    object->next = vm->objs;
-    vm->objs = object;
-
     return object;
 }
 
-static StrObj* allocateString(VM* vm, char* chars, int length, uint32_t hash)
+/* spreads the bits of h, so sums of entry hashes don't cancel out */
+static uint32_t mixHash(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static bool hashedByValue(Obj* o);
+
+/* whether v's hash, already computed, stands for its value */
+static bool hashIsPure(Value v)
+{
+    if (!value_isObj(v))
+        return true;
+
+    Obj* o = value_asObj(v);
+    switch (o->type)
+    {
+    case LLO_STRING:
+    case LLO_SYMBOL:
+    case LLO_KEYWORD:
+        return true;
+
+    default:
+        return hashedByValue(o) && (o->hash & HASH_PURE);
+    }
+}
+
+static uint32_t withPurity(uint32_t h, bool pure)
+{
+    return pure ? h | HASH_PURE : h & ~HASH_PURE;
+}
+
+/* items in order; equal seqs hash alike whatever they're made of */
+static uint32_t orderedHash(Obj* o, uint32_t seed)
+{
+    uint32_t h = seed;
+    bool pure = true;
+    SeqIter iter;
+    value_iterInit(value_obj(o), &iter);
+
+    Value item;
+    while (seqiter_next(&iter, &item))
+    {
+        h = h * 31 + value_hash(item);
+        pure = pure && hashIsPure(item);
+    }
+
+    return withPurity(mixHash(h), pure);
+}
+
+static uint32_t entryHash(Value key, Value value, bool* pure)
+{
+    uint32_t h = mixHash(value_hash(key) * 31 + mixHash(value_hash(value)));
+    *pure = *pure && hashIsPure(key) && hashIsPure(value);
+    return h;
+}
+
+static uint32_t keyHash(Value key, bool* pure)
+{
+    uint32_t h = mixHash(value_hash(key));
+    *pure = *pure && hashIsPure(key);
+    return h;
+}
+
+/* entries in any order, so a map, a record and a sorted map with the same ones agree */
+static uint32_t mapLikeHash(Obj* o)
+{
+    uint32_t h = HASH_INIT;
+    bool pure = true;
+    Value key, value;
+
+    if (obj_isRecord(o))
+    {
+        RecordObj* r = obj_asRecord(o);
+        for (int i = 0; i < r->shape->count; i++)
+            h += entryHash(r->shape->fields[i], r->slots[i], &pure);
+    }
+    else if (obj_isSorted(o))
+    {
+        SortedObj* so = obj_asSorted(o);
+        SortedIter iter;
+        sortediter_init(so, &iter, false);
+        while (sortediter_next(&iter, &key, &value))
+            h += so->isSet ? keyHash(key, &pure) : entryHash(key, value, &pure);
+    }
+    else
+    {
+        bool isSet = obj_isSet(o);
+        MapIter iter;
+        mapobj_iterInit(isSet ? obj_asSet(o)->map : obj_asMap(o), &iter);
+        while (mapobj_iterNext(&iter, &key, &value))
+            h += isSet ? keyHash(key, &pure) : entryHash(key, value, &pure);
+    }
+
+    return withPurity(h, pure);
+}
+
+/* colls hashed by their contents, consistent with obj_eq */
+static bool hashedByValue(Obj* o)
 {
-    StrObj* string = CALLOCATE_OBJ(vm, StrObj, LLO_STRING);
-    string->length = length;
-    string->chars = chars;
-    string->base.hash = hash;
+    switch (o->type)
+    {
+    case LLO_LIST:
+    case LLO_VECTOR:
+    case LLO_SLICE:
+    case LLO_LAZY_SEQ:
+    case LLO_MAP:
+    case LLO_SET:
+    case LLO_RECORD:
+        return true;
 
-    // insert string to global string table
-    table_set(&vm->strings, hash, &string);
+    case LLO_SORTED:
+        // a comparator may call keys equal which obj_eq doesn't
+        return value_isNil(obj_asSorted(o)->cmp);
 
-    return string;
+    default:
+        return false;
+    }
 }
 
 uint32_t obj_hash(Obj* o)
@@ -52,7 +167,7 @@ uint32_t obj_hash(Obj* o)
 
         case LLO_LIST:
         {
-            h = HASH((char*)o, sizeof(ListObj));
+            h = orderedHash(o, SEQ_HASH_SEED);
             break;
         }
 
@@ -65,19 +180,41 @@ uint32_t obj_hash(Obj* o)
 
         case LLO_KEYWORD:
         {
-            h = HASH((char*)(obj_asKeyword(o)->keyword), sizeof(StrObj));
+            // apart from the symbol of the same name
+            h = mixHash(strobj_hash(obj_asKeyword(o)->keyword));
             break;
         }
 
         case LLO_VECTOR:
         {
-            h = HASH((char*)o, sizeof(VectorObj));
+            h = orderedHash(o, VECTOR_HASH_SEED);
+            break;
+        }
+
+        case LLO_SLICE:
+        {
+            h = orderedHash(o, obj_asSlice(o)->isVector ? VECTOR_HASH_SEED : SEQ_HASH_SEED);
+            break;
+        }
+
+        case LLO_LAZY_SEQ:
+        {
+            // hashing can't realize it, the builtins hashing keys do (value_realize).
+            // till then it's by identity and not kept, so a list of the same items
+            // finds it once it's realized
+            if (!lazyseqobj_isRealized(obj_asLazySeq(o)))
+                return withPurity(HASH((char*)&o, sizeof(Obj*)), false);
+
+            h = orderedHash(o, SEQ_HASH_SEED);
             break;
         }
 
         case LLO_MAP:
+        case LLO_SET:
+        case LLO_RECORD:
+        case LLO_SORTED:
         {
-            h = HASH((char*)o, sizeof(MapObj));
+            h = mapLikeHash(o);
             break;
         }
 
@@ -99,6 +236,15 @@ uint32_t obj_hash(Obj* o)
             break;
         }
 
+        case LLO_TRANSIENT:
+        case LLO_REDUCED:
+        case LLO_XFORM:
+        case LLO_SHAPE:
+        {
+            h = HASH((char*)&o, sizeof(Obj*));
+            break;
+        }
+
         case LLO_EXCEPTION:
         {
             h = HASH((char*)o, sizeof(ExceptionObj));
@@ -114,7 +260,10 @@ uint32_t obj_hash(Obj* o)
         }
     }
 
-    o->hash = h;
+    // an impure one may change yet, as lazy seqs inside get realized
+    if (!hashedByValue(o) || (h & HASH_PURE))
+        o->hash = h;
+
     return h;
 }
 
@@ -136,7 +285,7 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
 {
 #define SET_CURRENT_CHAR(char) *currentChar = (char); currentChar++
 #define SET_CURRENT_STR(strObj) \
-    memcpy(currentChar, (strObj)->chars, (strObj)->length); \
+    memcpy(currentChar, strobj_chars(vm, (strObj)), (strObj)->length); \
     currentChar += (strObj)->length
 
     // TODO bugfix if to string length is greater than TO_STR_BUFF_COUNT
@@ -153,6 +302,7 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
         else // convert escape char to readably
         {
             StrObj* strObj = obj_asStr(o);
+            const char* chars = strobj_chars(vm, strObj);
             char* current = s_objStrBuff;
             char* start = s_objStrBuff;
 
@@ -169,7 +319,7 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
             for (size_t i = 0; i < strObj->length; i++)
             {
                 bool isEscape = false;
-                char c = strObj->chars[i];
+                char c = chars[i];
                 for (size_t j = 0; j < ESCAPE_DATA_LEN; j++)
                 {
                     if (c == escapeCharDatas[j].originChar)
@@ -208,18 +358,21 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
         KeywordObj* keywordObj = obj_asKeyword(o);
         ret = keywordObj->keyword;
     }
-    else if (obj_isList(o))
+    else if (obj_isList(o) || obj_isLazySeq(o) || (obj_isSlice(o) && !obj_asSlice(o)->isVector))
     {
-        ListObj* listObj = obj_asList(o);
-        const int len = listObj->items.count;
+        // a lazy seq prints what is realized of it
+        const int len = value_listLikeCount(value_obj(o));
         if (len == 0)
             return strobj_copy(vm, "()", 2);
 
         StrObj** child = CALLOCATE(vm, StrObj*, len);
-        for (int i = 0; i < len; i++)
+
+        SeqIter iter;
+        value_iterInit(value_obj(o), &iter);
+
+        Value v;
+        for (int i = 0; seqiter_next(&iter, &v); i++)
         {
-            Value v;
-            array_get(&listObj->items, i, &v);
             child[i] = value_toStr(vm, v, readably);
             VM_PUSH(child[i]);
         }
@@ -242,18 +395,20 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
 
         ret = strobj_copy(vm, s_objStrBuff, (int)(currentChar - s_objStrBuff));
     }
-    else if (obj_isVector(o))
+    else if (obj_isVector(o) || obj_isSlice(o))
     {
-        VectorObj* vectorObj = obj_asVector(o);
-        const int len = vectorObj->items.count;
+        const int len = value_listLikeCount(value_obj(o));
         if (len == 0)
             return strobj_copy(vm, "[]", 2);
 
         StrObj** child = CALLOCATE(vm, StrObj*, len);
-        for (int i = 0; i < len; i++)
+
+        SeqIter iter;
+        value_iterInit(value_obj(o), &iter);
+
+        Value v;
+        for (int i = 0; seqiter_next(&iter, &v); i++)
         {
-            Value v;
-            array_get(&vectorObj->items, i, &v);
             child[i] = value_toStr(vm, v, readably);
             VM_PUSH(child[i]);
         }
@@ -277,28 +432,37 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
 
         ret = strobj_copy(vm, s_objStrBuff, (int)(currentChar - s_objStrBuff));
     }
-    else if (obj_isMap(o))
+    else if (obj_isMap(o) || obj_isRecord(o))
     {
-        MapObj* mapObj = obj_asMap(o);
-        const int len = mapObj->table.count;
+        // a record prints as the map of its fields
+        RecordObj* record = obj_isRecord(o) ? obj_asRecord(o) : NULL;
+        const int len = record ? record->shape->count : obj_asMap(o)->count;
         if (len == 0)
             return strobj_copy(vm, "{}", 2);
 
         StrObj** child = CALLOCATE(vm, StrObj*, len * 2);
-        uint32_t* keys = CALLOCATE(vm, uint32_t, len);
 
-        Table* t = &mapObj->table;
-
-        table_keys(t, keys);
+        MapIter iter;
+        if (!record)
+            mapobj_iterInit(obj_asMap(o), &iter);
 
+        Value key, value;
         for (int i = 0; i < len; i++)
         {
-            MapObjEntry entry;
-            table_get(t, keys[i], &entry);
-            child[2 * i] = value_toStr(vm, entry.key, readably);
+            if (record)
+            {
+                key = record->shape->fields[i];
+                value = record->slots[i];
+            }
+            else
+            {
+                mapobj_iterNext(&iter, &key, &value);
+            }
+
+            child[2 * i] = value_toStr(vm, key, readably);
             VM_PUSH(child[2 * i]);
 
-            child[2 * i + 1] = value_toStr(vm, entry.value, readably);
+            child[2 * i + 1] = value_toStr(vm, value, readably);
             VM_PUSH(child[2 * i + 1]);
         }
 
@@ -325,11 +489,111 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
             VM_POP(child[2 * i]); // child
         }
 
-        CFREE_ARRAY(vm, uint32_t, keys, len);
         CFREE_ARRAY(vm, StrObj*, child, len * 2);
 
         ret = strobj_copy(vm, s_objStrBuff, (int)(currentChar - s_objStrBuff));
     }
+    else if (obj_isSet(o))
+    {
+        MapObj* mapObj = obj_asSet(o)->map;
+        const int len = mapObj->count;
+        if (len == 0)
+            return strobj_copy(vm, "#{}", 3);
+
+        StrObj** child = CALLOCATE(vm, StrObj*, len);
+
+        MapIter iter;
+        mapobj_iterInit(mapObj, &iter);
+
+        Value item;
+        for (int i = 0; mapobj_iterNext(&iter, &item, NULL); i++)
+        {
+            child[i] = value_toStr(vm, item, readably);
+            VM_PUSH(child[i]);
+        }
+
+        char* currentChar = s_objStrBuff;
+        SET_CURRENT_CHAR('#');
+        SET_CURRENT_CHAR('{');
+        for (int i = 0; i < len - 1; i++)
+        {
+            SET_CURRENT_STR(child[i]);
+            SET_CURRENT_CHAR(',');
+            SET_CURRENT_CHAR(' ');
+        }
+
+        SET_CURRENT_STR(child[len - 1]);
+        SET_CURRENT_CHAR('}');
+
+        for (int i = len - 1; i >= 0; i--)
+            VM_POP(child[i]); // children
+
+        CFREE_ARRAY(vm, StrObj*, child, len);
+
+        ret = strobj_copy(vm, s_objStrBuff, (int)(currentChar - s_objStrBuff));
+    }
+    else if (obj_isSorted(o))
+    {
+        // prints as the map or set of its keys, in order
+        SortedObj* sortedObj = obj_asSorted(o);
+        const int len = sortedObj->count;
+        const int per = sortedObj->isSet ? 1 : 2;
+        if (len == 0)
+            return sortedObj->isSet ? strobj_copy(vm, "#{}", 3) : strobj_copy(vm, "{}", 2);
+
+        StrObj** child = CALLOCATE(vm, StrObj*, len * per);
+
+        SortedIter iter;
+        sortediter_init(sortedObj, &iter, false);
+
+        Value key, value;
+        for (int i = 0; sortediter_next(&iter, &key, &value); i++)
+        {
+            child[per * i] = value_toStr(vm, key, readably);
+            VM_PUSH(child[per * i]);
+
+            if (per == 2)
+            {
+                child[per * i + 1] = value_toStr(vm, value, readably);
+                VM_PUSH(child[per * i + 1]);
+            }
+        }
+
+        char* currentChar = s_objStrBuff;
+        if (sortedObj->isSet)
+        {
+            SET_CURRENT_CHAR('#');
+        }
+        SET_CURRENT_CHAR('{');
+        for (int i = 0; i < len; i++)
+        {
+            SET_CURRENT_STR(child[per * i]);
+            if (per == 2)
+            {
+                SET_CURRENT_CHAR(' ');
+                SET_CURRENT_STR(child[per * i + 1]);
+            }
+
+            if (i < len - 1)
+            {
+                SET_CURRENT_CHAR(',');
+                SET_CURRENT_CHAR(' ');
+            }
+        }
+        SET_CURRENT_CHAR('}');
+
+        for (int i = len * per - 1; i >= 0; i--)
+            VM_POP(child[i]); // children
+
+        CFREE_ARRAY(vm, StrObj*, child, len * per);
+
+        ret = strobj_copy(vm, s_objStrBuff, (int)(currentChar - s_objStrBuff));
+    }
+    else if (obj_isSortedNode(o))
+    {
+        size_t len = snprintf(s_objStrBuff, TO_STR_BUFF_COUNT, "<sorted node %p>", o);
+        ret = strobj_copy(vm, s_objStrBuff, len);
+    }
     else if (obj_isFunc(o))
     {
         FuncObj* funcObj = obj_asFunc(o);
@@ -378,6 +642,37 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
         }
         ret = strobj_copy(vm, s_objStrBuff, len);
     }
+    else if (obj_isMapNode(o))
+    {
+        size_t len = snprintf(s_objStrBuff, TO_STR_BUFF_COUNT, "<map node %p>", o);
+        ret = strobj_copy(vm, s_objStrBuff, len);
+    }
+    else if (obj_isVecNode(o))
+    {
+        size_t len = snprintf(s_objStrBuff, TO_STR_BUFF_COUNT, "<vector node %p>", o);
+        ret = strobj_copy(vm, s_objStrBuff, len);
+    }
+    else if (obj_isTransient(o))
+    {
+        size_t len = snprintf(s_objStrBuff, TO_STR_BUFF_COUNT, "<transient %p>", o);
+        ret = strobj_copy(vm, s_objStrBuff, len);
+    }
+    else if (obj_isReduced(o))
+    {
+        size_t len = snprintf(s_objStrBuff, TO_STR_BUFF_COUNT, "<reduced %p>", o);
+        ret = strobj_copy(vm, s_objStrBuff, len);
+    }
+    else if (obj_isXform(o))
+    {
+        size_t len = snprintf(s_objStrBuff, TO_STR_BUFF_COUNT, "<transducer %p>", o);
+        ret = strobj_copy(vm, s_objStrBuff, len);
+    }
+    else if (obj_isShape(o))
+    {
+        size_t len = snprintf(s_objStrBuff, TO_STR_BUFF_COUNT, "<record type %s>",
+                              obj_asShape(o)->name->symbol->chars);
+        ret = strobj_copy(vm, s_objStrBuff, len);
+    }
     else
     {
         RLOG_ERROR("obj toStr: type not supported now! %d", o->type);
@@ -391,89 +686,132 @@ StrObj* obj_toStr(VM* vm, Obj* o, bool readably)
 
 void obj_free(VM* vm, Obj* o)
 {
-    switch (o->type)
-    {
-    case LLO_LIST:
-    {
-        ListObj* lobj = obj_asList(o);
-        array_free(&lobj->items);
-        CFREE(vm, ListObj, lobj);
-        break;
-    }
+    CFREE_OBJ(vm, o);
+}
 
-    case LLO_SYMBOL:
-    {
-        SymbolObj* sobj = obj_asSymbol(o);
-        CFREE(vm, SymbolObj, sobj);
-        break;
-    }
+static bool mapLikeGet(VM* vm, Obj* o, Value key, Value* value)
+{
+    if (obj_isRecord(o))
+        return recordobj_get(vm, obj_asRecord(o), key, value);
 
-    case LLO_STRING:
-    {
-        StrObj* sobj = obj_asStr(o);
-        CFREE_ARRAY(vm, char, sobj->chars, sobj->length + 1);
-        CFREE(vm, StrObj, sobj);
-        break;
-    }
+    return mapobj_get(vm, obj_asMap(o), key, value);
+}
 
-    case LLO_FUNCTION:
+/* a is a record, or b is; the other one a record or a map */
+static bool mapLikeEq(VM* vm, Obj* a, Obj* b)
+{
+    if (obj_isRecord(b))
     {
-        FuncObj* fobj = obj_asFunc(o);
-        CFREE(vm, FuncObj, fobj);
-        break;
+        Obj* t = a;
+        a = b;
+        b = t;
     }
 
-    case LLO_KEYWORD:
-    {
-        KeywordObj* kobj = obj_asKeyword(o);
-        CFREE(vm, KeywordObj, kobj);
-        break;
-    }
+    if (!obj_isRecord(b) && !obj_isMap(b))
+        return false;
 
-    case LLO_VECTOR:
-    {
-        VectorObj* vobj = obj_asVector(o);
-        array_free(&vobj->items);
-        CFREE(vm, VectorObj, vobj);
-        break;
-    }
+    RecordObj* ra = obj_asRecord(a);
+    int bcount = obj_isRecord(b) ? obj_asRecord(b)->shape->count : obj_asMap(b)->count;
+    if (ra->shape->count != bcount)
+        return false;
 
-    case LLO_MAP:
+    for (int i = 0; i < ra->shape->count; i++)
     {
-        MapObj* mobj = obj_asMap(o);
-        table_free(&mobj->table);
-        CFREE(vm, MapObj, mobj);
-        break;
+        Value bvalue;
+        if (!mapLikeGet(vm, b, ra->shape->fields[i], &bvalue) || !value_eq(vm, ra->slots[i], bvalue))
+            return false;
     }
 
-    case LLO_ATOM:
+    return true;
+}
+
+/* a is sorted, or b is; equal to a sorted or hash coll of the same kind with the same entries */
+static bool sortedEq(VM* vm, Obj* a, Obj* b)
+{
+    if (!obj_isSorted(a))
     {
-        CFREE(vm, AtomObj, o);
-        break;
+        Obj* t = a;
+        a = b;
+        b = t;
     }
 
-    case LLO_EXCEPTION:
+    SortedObj* sa = obj_asSorted(a);
+    SortedIter iter;
+    sortediter_init(sa, &iter, false);
+    Value key, avalue, bvalue;
+
+    if (obj_isSorted(b))
     {
-        CFREE(vm, ExceptionObj, o);
-        break;
+        SortedObj* sb = obj_asSorted(b);
+        if (sa->isSet != sb->isSet || sa->count != sb->count)
+            return false;
+
+        // one order, the entries line up
+        bool sameOrder = value_isNil(sa->cmp) ? value_isNil(sb->cmp)
+                                              : value_isObj(sb->cmp) && value_asObj(sa->cmp) == value_asObj(sb->cmp);
+        if (sameOrder)
+        {
+            SortedIter biter;
+            sortediter_init(sb, &biter, false);
+
+            Value bkey;
+            while (sortediter_next(&iter, &key, &avalue) && sortediter_next(&biter, &bkey, &bvalue))
+            {
+                if (!value_eq(vm, key, bkey) || (!sa->isSet && !value_eq(vm, avalue, bvalue)))
+                    return false;
+            }
+
+            return true;
+        }
+
+        ExceptionObj* exc = NULL;
+        ExceptionObj** exception = &exc;
+        while (sortediter_next(&iter, &key, &avalue))
+        {
+            if (!sortedobj_get(vm, sb, key, &bvalue, exception) || !value_eq(vm, avalue, bvalue))
+                return false;
+        }
+
+        return true;
     }
 
-    case LLO_ENV:
+    MapObj* bmap;
+    if (obj_isMap(b) && !sa->isSet)
+        bmap = obj_asMap(b);
+    else if (obj_isSet(b) && sa->isSet)
+        bmap = obj_asSet(b)->map;
+    else
+        return false;
+
+    if (sa->count != bmap->count)
+        return false;
+
+    while (sortediter_next(&iter, &key, &avalue))
     {
-        EnvObj* eobj = obj_asEnv(o);
-        CFREE(vm, EnvObj, eobj);
-        break;
+        if (!mapobj_get(vm, bmap, key, &bvalue) || !value_eq(vm, avalue, bvalue))
+            return false;
     }
 
-    case LLO_CLOSURE:
+    return true;
+}
+
+static bool seqEq(VM* vm, Obj* a, Obj* b)
+{
+    if (value_listLikeCount(value_obj(a)) != value_listLikeCount(value_obj(b)))
+        return false;
+
+    SeqIter aiter, biter;
+    value_iterInit(value_obj(a), &aiter);
+    value_iterInit(value_obj(b), &biter);
+
+    Value avalue, bvalue;
+    while (seqiter_next(&aiter, &avalue) && seqiter_next(&biter, &bvalue))
     {
-        CFREE(vm, ClosureObj, o);
-        break;
+        if (!value_eq(vm, avalue, bvalue))
+            return false;
     }
 
-    default:
-        break;
-    }
+    return true;
 }
 
 bool obj_eq(VM* vm, Obj* a, Obj* b)
@@ -484,30 +822,41 @@ bool obj_eq(VM* vm, Obj* a, Obj* b)
     if (a == b)
         return true;
 
-    if (a->type != b->type)
+    // equal colls hash alike, once both pure hashes are cached a mismatch settles it
+    if ((a->hash & b->hash & HASH_PURE) && a->hash != b->hash && hashedByValue(a) && hashedByValue(b))
         return false;
 
-    switch (a->type)
-    {
-    case LLO_LIST:
-    case LLO_VECTOR:
+    // lists and lazy seqs are both seqs, compare the realized items
+    bool aSeq = obj_isList(a) || obj_isLazySeq(a);
+    bool bSeq = obj_isList(b) || obj_isLazySeq(b);
+
+    // a slice is a vector or a seq, equal to those of its kind
+    if (obj_isSlice(a) || obj_isSlice(b))
     {
-        ValueArray* aarr = obj_listLikeGetArr(a);
-        ValueArray* barr = obj_listLikeGetArr(b);
+        bool aVector = obj_isVector(a) || (obj_isSlice(a) && obj_asSlice(a)->isVector);
+        bool bVector = obj_isVector(b) || (obj_isSlice(b) && obj_asSlice(b)->isVector);
+        aSeq = aSeq || (obj_isSlice(a) && !aVector);
+        bSeq = bSeq || (obj_isSlice(b) && !bVector);
+        return ((aSeq && bSeq) || (aVector && bVector)) && seqEq(vm, a, b);
+    }
 
-        if (aarr->count != barr->count)
-            return false;
+    // records compare as the maps of their fields
+    if (obj_isRecord(a) || obj_isRecord(b))
+        return mapLikeEq(vm, a, b);
 
-        for (size_t i = 0; i < aarr->count; i++)
-        {
-            VALUE_ARR_GET_CHILD(aarr, i, avalue);
-            VALUE_ARR_GET_CHILD(barr, i, bvalue);
+    if (obj_isSorted(a) || obj_isSorted(b))
+        return sortedEq(vm, a, b);
 
-            if (!value_eq(vm, avalue, bvalue))
-                return false;
-        }
+    if (a->type != b->type && !(aSeq && bSeq))
+        return false;
 
-        return true;
+    switch (a->type)
+    {
+    case LLO_LIST:
+    case LLO_VECTOR:
+    case LLO_LAZY_SEQ:
+    {
+        return seqEq(vm, a, b);
     }
 
     case LLO_SYMBOL:
@@ -517,7 +866,12 @@ bool obj_eq(VM* vm, Obj* a, Obj* b)
 
     case LLO_STRING:
     {
-        return a == b;
+        StrObj* sa = obj_asStr(a);
+        StrObj* sb = obj_asStr(b);
+        if (sa->length != sb->length || strobj_hash(sa) != strobj_hash(sb))
+            return false;
+
+        return strobj_compare(sa, sb) == 0;
     }
 
     case LLO_FUNCTION:
@@ -535,39 +889,51 @@ bool obj_eq(VM* vm, Obj* a, Obj* b)
         MapObj* aobj = obj_asMap(a);
         MapObj* bobj = obj_asMap(b);
 
-        int len = aobj->table.count;
-
-        if (len != bobj->table.count)
+        if (aobj->count != bobj->count)
             return false;
 
-        uint32_t* keys = CALLOCATE(vm, uint32_t, len);
-        table_keys(&aobj->table, keys);
+        MapIter iter;
+        mapobj_iterInit(aobj, &iter);
 
-        MapObjEntry aentry;
-        MapObjEntry bentry;
-        for (size_t i = 0; i < len; i++)
+        Value key, avalue, bvalue;
+        while (mapobj_iterNext(&iter, &key, &avalue))
         {
-            if (!table_get(&bobj->table, keys[i], &bentry))
-                goto MAP_FALSE;
+            if (!mapobj_get(vm, bobj, key, &bvalue))
+                return false;
 
-            table_get(&aobj->table, keys[i], &aentry);
+            if (!value_eq(vm, avalue, bvalue))
+                return false;
+        }
+
+        return true;
+    }
+
+    case LLO_SET:
+    {
+        MapObj* aobj = obj_asSet(a)->map;
+        MapObj* bobj = obj_asSet(b)->map;
 
-            if (!value_eq(vm, aentry.key, bentry.key))
-                goto MAP_FALSE;
+        if (aobj->count != bobj->count)
+            return false;
+
+        MapIter iter;
+        mapobj_iterInit(aobj, &iter);
 
-            if (!value_eq(vm, aentry.value, bentry.value))
-                goto MAP_FALSE;
+        Value item;
+        while (mapobj_iterNext(&iter, &item, NULL))
+        {
+            if (!mapobj_get(vm, bobj, item, NULL))
+                return false;
         }
 
-        CFREE_ARRAY(vm, uint32_t, keys, len);
         return true;
-
-        MAP_FALSE:
-        CFREE_ARRAY(vm, uint32_t, keys, len);
-        return false;
     }
 
     case LLO_ATOM:
+    case LLO_TRANSIENT:
+    case LLO_REDUCED:
+    case LLO_XFORM:
+    case LLO_SHAPE:
     {
         return a == b;
     }
@@ -614,6 +980,12 @@ void obj_print(Obj* o)
         break;
     }
 
+    case LLO_LAZY_SEQ:
+    {
+        RLOG_DEBUG("<value lazy seq %p>", o);
+        break;
+    }
+
     case LLO_SYMBOL:
     {
         SymbolObj* sobj = obj_asSymbol(o);
@@ -628,7 +1000,10 @@ void obj_print(Obj* o)
     case LLO_STRING:
     {
         StrObj* sobj = obj_asStr(o);
-        RLOG_DEBUG("<value string \"%s\">", sobj->chars);
+        if (strobj_isRope(sobj))
+            RLOG_DEBUG("<value string rope of %d chars>", sobj->length);
+        else
+            RLOG_DEBUG("<value string \"%.*s\">", sobj->length, strobj_leafChars(sobj));
         break;
     }
 
@@ -655,18 +1030,84 @@ void obj_print(Obj* o)
         break;
     }
 
+    case LLO_SLICE:
+    {
+        RLOG_DEBUG("<value slice %p>", o);
+        break;
+    }
+
     case LLO_MAP:
     {
         RLOG_DEBUG("<value map %p>", o);
         break;
     }
 
+    case LLO_SET:
+    {
+        RLOG_DEBUG("<value set %p>", o);
+        break;
+    }
+
+    case LLO_SORTED:
+    {
+        RLOG_DEBUG("<value sorted %p>", o);
+        break;
+    }
+
+    case LLO_SORTED_NODE:
+    {
+        RLOG_DEBUG("<value sorted node %p>", o);
+        break;
+    }
+
+    case LLO_MAP_NODE:
+    {
+        RLOG_DEBUG("<value map node %p>", o);
+        break;
+    }
+
+    case LLO_VEC_NODE:
+    {
+        RLOG_DEBUG("<value vector node %p>", o);
+        break;
+    }
+
     case LLO_ATOM:
     {
         RLOG_DEBUG("<value atom %p>", o);
         break;
     }
 
+    case LLO_TRANSIENT:
+    {
+        RLOG_DEBUG("<value transient %p>", o);
+        break;
+    }
+
+    case LLO_REDUCED:
+    {
+        RLOG_DEBUG("<value reduced %p>", o);
+        break;
+    }
+
+    case LLO_XFORM:
+    {
+        RLOG_DEBUG("<value transducer %p>", o);
+        break;
+    }
+
+    case LLO_SHAPE:
+    {
+        RLOG_DEBUG("<value record type %p>", o);
+        break;
+    }
+
+    case LLO_RECORD:
+    {
+        RLOG_DEBUG("<value record %p>", o);
+        break;
+    }
+
     case LLO_EXCEPTION:
     {
         ExceptionObj* eobj = obj_asException(o);
@@ -699,292 +1140,2903 @@ void obj_print(Obj* o)
     }
 }
 
-StrObj* strobj_new(VM* vm, const char *chars, int length)
+StrObj* strobj_new(VM* vm, int length)
+{
+    StrObj* s = (StrObj*)allocateObject(vm, sizeof(StrObj) + length + 1, LLO_STRING);
+    s->length = length;
+    s->depth = 0;
+    s->offset = 0;
+    s->left = NULL;
+    s->right = NULL;
+    s->chars[length] = '\0';
+    return s;
+}
+
+StrObj* strobj_copy(VM* vm, const char* chars, int length)
+{
+    StrObj* s = strobj_new(vm, length);
+    if (length > 0) // chars of an empty string may be NULL
+        memcpy(s->chars, chars, length);
+    return s;
+}
+
+/* for symbols, keywords and literals, which compare and hash often */
+StrObj* strobj_intern(VM* vm, const char* chars, int length)
 {
     uint32_t h = HASH(chars, length);
-    StrObj* s;
 
     // try to get string from global string table
-    if (table_get(&vm->strings, h, &s))
-    {
-        CFREE_ARRAY(vm, char, (void*)chars, length + 1);
+    StrObj* s = cintern_find(&vm->strings, chars, length, h);
+    if (s)
         return s;
-    }
 
-    return allocateString(vm, (char*)chars, length, h);
+    s = strobj_copy(vm, chars, length);
+    s->base.hash = h;
+    cintern_add(&vm->strings, s);
+    return s;
 }
 
-uint32_t strobj_hash(StrObj* o)
+/* o must be reachable by the gc */
+StrObj* strobj_internStr(VM* vm, StrObj* o)
 {
-    return o->base.hash;
+    return strobj_intern(vm, strobj_chars(vm, o), o->length);
 }
 
-bool strobj_eq(StrObj* o, const char* chars, int length)
+/* walks the leaves of a string left to right, flat strings and views */
+typedef struct sStrIter
 {
-    if (o->length != length)
-        return false;
+    StrObj* stack[ROPE_MAX_DEPTH + 1];
+    int     top;
+} StrIter;
 
-    return strcmp(o->chars, chars) == 0;
+static void striter_init(StrIter* iter, StrObj* s)
+{
+    iter->stack[0] = s;
+    iter->top = 1;
 }
 
-StrObj* strobj_copy(VM* vm, const char* chars, int length)
+static StrObj* striter_next(StrIter* iter)
 {
-    uint32_t h = HASH(chars, length);
-    StrObj* s;
+    if (iter->top == 0)
+        return NULL;
 
-    // try to get string from global string table
-    if (table_get(&vm->strings, h, &s))
+    StrObj* s = iter->stack[--iter->top];
+    while (strobj_isRope(s))
     {
-        return s;
+        iter->stack[iter->top++] = s->right;
+        s = s->left;
     }
 
-    char* heapChars = CALLOCATE(vm, char, length + 1);
-    memcpy(heapChars, chars, length);
-    heapChars[length] = '\0';
-
-    return allocateString(vm, heapChars, length, h);
+    return s;
 }
 
-ListObj* listobj_new(VM* vm, int len, ...)
+uint32_t strobj_hash(StrObj* o)
 {
-    ListObj* listObj = CALLOCATE_OBJ(vm, ListObj, LLO_LIST);
-    listObj->meta = value_nil();
-    array_init(&listObj->items, len, sizeof(Value));
+    // only interned strings hash up front
+    if (o->base.hash == 0)
+    {
+        uint32_t h = HASH_INIT;
 
-    va_list args;
-    va_start(args, len);
+        StrIter iter;
+        striter_init(&iter, o);
+        for (StrObj* leaf = striter_next(&iter); leaf; leaf = striter_next(&iter))
+            h = hashContinue(h, strobj_leafChars(leaf), leaf->length);
 
-    for (size_t i = 0; i < len; i++)
-    {
-        Value v = va_arg(args, Value);
-        array_push(&listObj->items, &v);
+        o->base.hash = h;
     }
 
-    va_end(args);
-    return listObj;
+    return o->base.hash;
 }
 
-ListObj* listobj_newWithNil(VM* vm, int len)
+bool strobj_eq(StrObj* o, const char* chars, int length)
 {
-    ListObj* listObj = CALLOCATE_OBJ(vm, ListObj, LLO_LIST);
-    listObj->meta = value_nil();
-    array_init(&listObj->items, len, sizeof(Value));
-
-    for (size_t i = 0; i < len; i++)
-        array_push(&listObj->items, (void*)&value_nil());
+    if (o->length != length)
+        return false;
 
-    return listObj;
+    return memcmp(o->chars, chars, length) == 0;
 }
 
-ListObj* listobj_newWithArr(VM* vm, int len, Value* arr)
+/* compares the bytes of a and b leaf by leaf, ropes need not be flat */
+int strobj_compare(StrObj* a, StrObj* b)
 {
-    ListObj* listObj = CALLOCATE_OBJ(vm, ListObj, LLO_LIST);
-    listObj->meta = value_nil();
-    array_init(&listObj->items, len, sizeof(Value));
+    if (a == b)
+        return 0;
 
-    // TODO OPT direct to copy memory
+    StrIter ia, ib;
+    striter_init(&ia, a);
+    striter_init(&ib, b);
 
-    for (size_t i = 0; i < len; i++)
-        array_push(&listObj->items, (void*)&(arr[i]));
+    StrObj* la = striter_next(&ia);
+    StrObj* lb = striter_next(&ib);
+    int oa = 0, ob = 0;
+    while (la && lb)
+    {
+        int na = la->length - oa;
+        int nb = lb->length - ob;
+        int n = na < nb ? na : nb;
 
-    return listObj;
+        int c = memcmp(strobj_leafChars(la) + oa, strobj_leafChars(lb) + ob, n);
+        if (c != 0)
+            return c < 0 ? -1 : 1;
+
+        oa += n;
+        ob += n;
+        if (oa == la->length)
+        {
+            la = striter_next(&ia);
+            oa = 0;
+        }
+        if (ob == lb->length)
+        {
+            lb = striter_next(&ib);
+            ob = 0;
+        }
+    }
+
+    return a->length < b->length ? -1 : (a->length > b->length ? 1 : 0);
 }
 
-bool listobj_set(ListObj* l, int index, Value v)
+static StrObj* newRope(VM* vm, StrObj* left, StrObj* right)
 {
-    return array_set(&l->items, index, &v);
+    StrObj* rope = CALLOCATE_OBJ(vm, StrObj, LLO_STRING);
+    rope->length = left->length + right->length;
+    rope->depth = (left->depth > right->depth ? left->depth : right->depth) + 1;
+    rope->offset = 0;
+    rope->left = left;
+    rope->right = right;
+    return rope;
 }
 
-bool listobj_get(ListObj* l, int index, Value* v)
+static StrObj* concatFlat(VM* vm, StrObj* a, StrObj* b)
 {
-    return array_get(&l->items, index, v);
+    StrObj* s = strobj_new(vm, a->length + b->length);
+    memcpy(s->chars, strobj_leafChars(a), a->length);
+    memcpy(s->chars + a->length, strobj_leafChars(b), b->length);
+    return s;
 }
 
-SymbolObj* symbolobj_new(VM* vm, const char* chars, int length)
+/**
+ * Short results are copied flat. A flat piece joining a rope sinks into
+ * the rope's near side while that side is shallower than the other one or
+ * the leaf there still has room, so strings built up a piece at a time
+ * stay balanced like a binary counter.
+ */
+static StrObj* concat(VM* vm, StrObj* a, StrObj* b)
 {
-    SymbolObj* sobj = CALLOCATE_OBJ(vm, SymbolObj, LLO_SYMBOL);
-    sobj->symbol = NULL;
+    if (a->length + b->length <= ROPE_LEAF_MAX)
+        return concatFlat(vm, a, b);
 
-    VM_PUSH(sobj);
-    sobj->symbol = strobj_copy(vm, chars, length);
-    VM_POP(sobj);
-    return sobj;
+    StrObj* ret = NULL;
+    if (strobj_isRope(a) && !strobj_isRope(b)
+        && (a->right->depth < a->left->depth
+            || a->right->length + b->length <= ROPE_LEAF_MAX))
+    {
+        StrObj* right = concat(vm, a->right, b);
+        VM_PUSH(right);
+        ret = newRope(vm, a->left, right);
+        VM_POP(right);
+    }
+    else if (strobj_isRope(b) && !strobj_isRope(a)
+             && (b->left->depth < b->right->depth
+                 || b->left->length + a->length <= ROPE_LEAF_MAX))
+    {
+        StrObj* left = concat(vm, a, b->left);
+        VM_PUSH(left);
+        ret = newRope(vm, left, b->right);
+        VM_POP(left);
+    }
+    else
+    {
+        ret = newRope(vm, a, b);
+    }
+
+    return ret;
 }
 
-SymbolObj* symbolobj_newWithStr(VM* vm, StrObj* strObj)
+/* a and b must be reachable by the gc */
+StrObj* strobj_concat(VM* vm, StrObj* a, StrObj* b)
 {
-    SymbolObj* sobj = CALLOCATE_OBJ(vm, SymbolObj, LLO_SYMBOL);
-    sobj->symbol = strObj;
-    return sobj;
+    if (a->length == 0)
+        return b;
+    if (b->length == 0)
+        return a;
+
+    StrObj* ret = concat(vm, a, b);
+    if (ret->depth > ROPE_MAX_DEPTH)
+    {
+        VM_PUSH(ret);
+        strobj_chars(vm, ret);
+        VM_POP(ret);
+    }
+
+    return ret;
 }
 
-KeywordObj* keywordobj_new(VM* vm, const char* chars, int length)
+/**
+ * Copies o's chars into a new flat string and makes o a view of all of it,
+ * o keeps its identity and hash. A rope lets go of its pieces.
+ */
+static void flatten(VM* vm, StrObj* o)
 {
-    KeywordObj* kobj = CALLOCATE_OBJ(vm, KeywordObj, LLO_KEYWORD);
-    kobj->keyword = NULL;
+    StrObj* flat = strobj_new(vm, o->length);
+    char* current = flat->chars;
 
-    VM_PUSH(kobj);
-    kobj->keyword = strobj_copy(vm, chars, length);
-    VM_POP(kobj);
-    return kobj;
+    StrIter iter;
+    striter_init(&iter, o);
+    for (StrObj* leaf = striter_next(&iter); leaf; leaf = striter_next(&iter))
+    {
+        memcpy(current, strobj_leafChars(leaf), leaf->length);
+        current += leaf->length;
+    }
+
+    o->depth = 0;
+    o->offset = 0;
+    o->left = flat;
+    o->right = NULL;
+    CWRITE_BARRIER(vm, o);
 }
 
-KeywordObj* keywordobj_newWithStr(VM* vm, StrObj* strObj)
+/* o must be reachable by the gc */
+char* strobj_chars(VM* vm, StrObj* o)
 {
-    KeywordObj* kobj = CALLOCATE_OBJ(vm, KeywordObj, LLO_KEYWORD);
-    kobj->keyword = strObj;
-    return kobj;
+    if (strobj_isRope(o))
+        flatten(vm, o);
+
+    return strobj_leafChars(o);
 }
 
-VectorObj* vectorobj_new(VM* vm, int len, ...)
+/* views that stop short of their base's end get a copy of their own */
+char* strobj_cstr(VM* vm, StrObj* o)
 {
-    VectorObj* vectorObj = CALLOCATE_OBJ(vm, VectorObj, LLO_VECTOR);
-    vectorObj->meta = value_nil();
-    array_init(&vectorObj->items, len, sizeof(Value));
+    if (strobj_isRope(o) || (strobj_isView(o) && o->offset + o->length < o->left->length))
+        flatten(vm, o);
 
-    va_list args;
-    va_start(args, len);
+    return strobj_leafChars(o);
+}
 
-    for (size_t i = 0; i < len; i++)
+/* o must be reachable by the gc */
+StrObj* strobj_sub(VM* vm, StrObj* o, int start, int length)
+{
+    if (start == 0 && length == o->length)
+        return o;
+
+    char* chars = strobj_chars(vm, o);
+    if (length < STR_VIEW_MIN)
+        return strobj_copy(vm, chars + start, length);
+
+    StrObj* view = CALLOCATE_OBJ(vm, StrObj, LLO_STRING);
+    view->length = length;
+    view->depth = 0;
+    view->offset = (strobj_isView(o) ? o->offset : 0) + start;
+    view->left = strobj_isView(o) ? o->left : o;
+    view->right = NULL;
+    return view;
+}
+
+/* memchr for the first byte, memcmp for the rest */
+static int findBytes(const char* chars, int length, const char* part, int partLength, int from)
+{
+    if (partLength == 0)
+        return from;
+
+    int last = length - partLength;
+    while (from <= last)
     {
-        Value v = va_arg(args, Value);
-        array_push(&vectorObj->items, &v);
+        const char* p = memchr(chars + from, part[0], last - from + 1);
+        if (!p)
+            break;
+
+        if (memcmp(p + 1, part + 1, partLength - 1) == 0)
+            return (int)(p - chars);
+        from = (int)(p - chars) + 1;
     }
 
-    va_end(args);
-    return vectorObj;
+    return -1;
 }
 
-VectorObj* vectorobj_newWithNil(VM* vm, int len)
+/* o and part must be reachable by the gc */
+int strobj_indexOf(VM* vm, StrObj* o, StrObj* part, int from)
 {
-    VectorObj* vectorObj = CALLOCATE_OBJ(vm, VectorObj, LLO_VECTOR);
-    vectorObj->meta = value_nil();
-    array_init(&vectorObj->items, len, sizeof(Value));
+    if (from < 0)
+        from = 0;
+    if (from > o->length)
+        return -1;
 
-    for (size_t i = 0; i < len; i++)
-        array_push(&vectorObj->items, (void*)&value_nil());
+    return findBytes(strobj_chars(vm, o), o->length, strobj_chars(vm, part), part->length, from);
+}
 
-    return vectorObj;
+/* a list of len nil items which is its own chunk, () for 0 */
+static ListObj* allocateList(VM* vm, int len)
+{
+    ListObj* listObj = (ListObj*)allocateObject(vm, sizeof(ListObj) + sizeof(Value) * len, LLO_LIST);
+    listObj->meta = value_nil();
+    listObj->count = len;
+    listObj->length = len;
+    listObj->offset = 0;
+    listObj->chunk = len > 0 ? listObj : NULL;
+    listObj->more = NULL;
+
+    for (int i = 0; i < len; i++)
+        listObj->items[i] = value_nil();
+
+    return listObj;
 }
 
-VectorObj* vectorobj_newWithArr(VM* vm, int len, Value* arr)
+ListObj* listobj_new(VM* vm, int len, ...)
 {
-    VectorObj* vectorObj = CALLOCATE_OBJ(vm, VectorObj, LLO_VECTOR);
-    vectorObj->meta = value_nil();
-    array_init(&vectorObj->items, len, sizeof(Value));
+    ListObj* listObj = allocateList(vm, len);
+
+    va_list args;
+    va_start(args, len);
 
     for (size_t i = 0; i < len; i++)
-        array_push(&vectorObj->items, (void*)&(arr[i]));
+        listObj->items[i] = va_arg(args, Value);
 
-    return vectorObj;
+    va_end(args);
+    return listObj;
 }
 
-bool vectorobj_set(VectorObj* vo, int index, Value v)
+ListObj* listobj_newWithNil(VM* vm, int len)
 {
-    return array_set(&vo->items, index, &v);
+    return allocateList(vm, len);
 }
 
-bool vectorobj_get(VectorObj* vo, int index, Value* v)
+ListObj* listobj_newWithArr(VM* vm, int len, Value* arr)
 {
-    return array_get(&vo->items, index, v);
+    ListObj* listObj = allocateList(vm, len);
+    if (len > 0)
+        memcpy(listObj->items, arr, sizeof(Value) * len);
+
+    return listObj;
 }
 
-MapObj* mapobj_new(VM* vm, int len, ...)
+/* the items of a list or vector from start on */
+ListObj* listobj_newWithListLike(VM* vm, Value v, int start)
 {
-    MapObj* mapObj = CALLOCATE_OBJ(vm, MapObj, LLO_MAP);
-    mapObj->meta = value_nil();
-    TABLE_INIT(&mapObj->table, MapObjEntry);
+    int count = value_listLikeCount(v);
+    VM_SPUSHV(v);
+    ListObj* listObj = listobj_newWithNil(vm, start < count ? count - start : 0);
+    VM_SPOPV(v);
 
-    va_list args;
-    va_start(args, len);
+    SeqIter iter;
+    value_iterInit(v, &iter);
 
-    for (size_t i = 0; i < len; i = i + 2)
+    Value item;
+    for (int i = 0; seqiter_next(&iter, &item); i++)
     {
-        Value key = va_arg(args, Value);
-        MapObjEntry entry = {key, va_arg(args, Value)};
-        table_set(&mapObj->table, value_hash(key), &entry);
+        if (i >= start)
+            listObj->items[i - start] = item;
     }
 
-    va_end(args);
-    return mapObj;
+    return listObj;
 }
 
-MapObj* mapobj_newWithArr(VM* vm, int len, Value* arr)
+/* O(1), the new list shares rest */
+ListObj* listobj_cons(VM* vm, Value head, ListObj* rest)
 {
-    MapObj* mapObj = CALLOCATE_OBJ(vm, MapObj, LLO_MAP);
-    mapObj->meta = value_nil();
-    TABLE_INIT(&mapObj->table, MapObjEntry);
-
-    for (size_t i = 0; i < len; i = i + 2)
+    VM_SPUSHV(head);
+    VM_SPUSH(rest);
+    ListObj* listObj = allocateList(vm, 1);
+    VM_SPOP(rest);
+    VM_SPOPV(head);
+
+    listObj->items[0] = head;
+    if (rest->count > 0)
     {
-        Value key = arr[i];
-        Value value = arr[i + 1];
-        MapObjEntry entry = {key, value};
-        table_set(&mapObj->table, value_hash(key), &entry);
+        listObj->more = rest;
+        listObj->count += rest->count;
     }
 
-    return mapObj;
+    return listObj;
 }
 
-MapObj* mapobj_clone(VM* vm, MapObj* other)
+/* O(1), shares the items of l */
+ListObj* listobj_rest(VM* vm, ListObj* l)
 {
-    MapObj* newMap = mapobj_new(vm, 0);
-    newMap->meta = other->meta;
-
-    VM_PUSH(newMap);
-
-    int oldMapLen = other->table.count;
-
-    uint32_t* keys = CALLOCATE(vm, uint32_t, oldMapLen);
-
-    table_keys(&other->table, keys);
-
-    MapObjEntry entry;
-    for (size_t i = 0; i < oldMapLen; i++)
+    if (l->length > 1)
     {
-        table_get(&other->table, keys[i], &entry);
-        mapobj_set(newMap, entry.key, entry.value);
+        VM_SPUSH(l);
+        ListObj* listObj = allocateList(vm, 0);
+        VM_SPOP(l);
+
+        listObj->count = l->count - 1;
+        listObj->length = l->length - 1;
+        listObj->offset = l->offset + 1;
+        listObj->chunk = l->chunk;
+        listObj->more = l->more;
+        return listObj;
     }
 
-    CFREE_ARRAY(vm, uint32_t, keys, oldMapLen);
+    if (l->more != NULL)
+        return l->more;
 
-    VM_POP(newMap); // newMap
-
-    return newMap;
+    return allocateList(vm, 0);
 }
 
-bool mapobj_set(MapObj* m, Value key, Value value)
+/* l itself when its items are contiguous, a flat copy otherwise */
+ListObj* listobj_contiguous(VM* vm, ListObj* l)
 {
-    if (m == NULL)
-        return false;
+    if (l->more == NULL)
+        return l;
 
-    MapObjEntry entry = {key, value};
-    return table_set(&m->table, value_hash(key), &entry);
+    return listobj_newWithListLike(vm, value_obj(l), 0);
 }
 
-bool mapobj_get(MapObj* m, Value key, Value* value)
+/* only for contiguous lists (see listobj_contiguous) */
+Value* listobj_items(ListObj* l)
 {
-    if (m == NULL)
+    return l->chunk ? l->chunk->items + l->offset : NULL;
+}
+
+bool listobj_set(ListObj* l, int index, Value v)
+{
+    if (index < 0 || index >= l->count)
         return false;
 
-    MapObjEntry entry;
-    if (table_get(&m->table, value_hash(key), &entry))
+    l->base.hash = 0;
+
+    while (index >= l->length)
     {
-        if (value)
-            *value = entry.value;
-        return true;
+        index -= l->length;
+        l = l->more;
     }
 
-    return false;
+    l->chunk->items[l->offset + index] = v;
+    return true;
 }
 
-bool mapobj_del(MapObj* m, Value key)
+bool listobj_get(ListObj* l, int index, Value* v)
 {
-    if (m == NULL)
+    if (index < 0 || index >= l->count)
         return false;
 
-    return table_del(&m->table, value_hash(key));
-}
+    while (index >= l->length)
+    {
+        index -= l->length;
+        l = l->more;
+    }
+
+    *v = l->chunk->items[l->offset + index];
+    return true;
+}
+
+SymbolObj* symbolobj_new(VM* vm, const char* chars, int length)
+{
+    SymbolObj* sobj = CALLOCATE_OBJ(vm, SymbolObj, LLO_SYMBOL);
+    sobj->symbol = NULL;
+
+    VM_PUSH(sobj);
+    sobj->symbol = strobj_intern(vm, chars, length);
+    VM_POP(sobj);
+    return sobj;
+}
+
+SymbolObj* symbolobj_newWithStr(VM* vm, StrObj* strObj)
+{
+    SymbolObj* sobj = CALLOCATE_OBJ(vm, SymbolObj, LLO_SYMBOL);
+    sobj->symbol = strObj;
+    return sobj;
+}
+
+KeywordObj* keywordobj_new(VM* vm, const char* chars, int length)
+{
+    KeywordObj* kobj = CALLOCATE_OBJ(vm, KeywordObj, LLO_KEYWORD);
+    kobj->keyword = NULL;
+    kobj->cacheShape = NULL;
+    kobj->cacheSlot = 0;
+
+    VM_PUSH(kobj);
+    kobj->keyword = strobj_intern(vm, chars, length);
+    VM_POP(kobj);
+    return kobj;
+}
+
+KeywordObj* keywordobj_newWithStr(VM* vm, StrObj* strObj)
+{
+    KeywordObj* kobj = CALLOCATE_OBJ(vm, KeywordObj, LLO_KEYWORD);
+    kobj->keyword = strObj;
+    kobj->cacheShape = NULL;
+    kobj->cacheSlot = 0;
+    return kobj;
+}
+
+#define VEC_TAIL_OFFSET(count) \
+    ((count) < VEC_NODE_WIDTH ? 0 : (((count) - 1) >> VEC_NODE_BITS) << VEC_NODE_BITS)
+#define VEC_CHILD(n, i) ((VecNode*)value_asObj((n)->slots[(i)]))
+
+/* edit tokens of maps and transient vectors, 0 is never handed out */
+static uint64_t s_edit = 0;
+
+static VecNode* newVecNode(VM* vm, int capacity)
+{
+    VecNode* node = (VecNode*)allocateObject(vm, sizeof(VecNode) + sizeof(Value) * capacity, LLO_VEC_NODE);
+    node->count = 0;
+    node->edit = 0;
+    return node;
+}
+
+/* node itself if the transient vector owning edit made it, else a copy it owns */
+static VecNode* editableVecNode(VM* vm, VecNode* node, uint64_t edit)
+{
+    if (node->edit == edit)
+        return node;
+
+    VecNode* copy = newVecNode(vm, VEC_NODE_WIDTH);
+    memcpy(copy->slots, node->slots, sizeof(Value) * node->count);
+    copy->count = node->count;
+    copy->edit = edit;
+    return copy;
+}
+
+/* copy of node with count slots, the extra ones nil */
+static VecNode* copyVecNode(VM* vm, VecNode* node, int count)
+{
+    VecNode* copy = newVecNode(vm, count);
+    memcpy(copy->slots, node->slots, sizeof(Value) * node->count);
+    for (int i = node->count; i < count; i++)
+        copy->slots[i] = value_nil();
+
+    copy->count = count;
+    return copy;
+}
+
+static VecNode* newPath(VM* vm, int level, VecNode* leaf)
+{
+    VecNode* node = leaf;
+    for (; level > 0; level -= VEC_NODE_BITS)
+    {
+        VM_SPUSH(node);
+        VecNode* parent = newVecNode(vm, 1);
+        VM_SPOP(node);
+
+        parent->slots[0] = value_obj(node);
+        parent->count = 1;
+        node = parent;
+    }
+
+    return node;
+}
+
+static VecNode* pushTail(VM* vm, int count, int level, VecNode* parent, VecNode* tail)
+{
+    int sub = ((count - 1) >> level) & VEC_NODE_MASK;
+    VecNode* node = copyVecNode(vm, parent, sub < parent->count ? parent->count : sub + 1);
+
+    VM_SPUSH(node);
+    VecNode* child;
+    if (level == VEC_NODE_BITS)
+        child = tail;
+    else if (sub < parent->count)
+        child = pushTail(vm, count, level - VEC_NODE_BITS, VEC_CHILD(parent, sub), tail);
+    else
+        child = newPath(vm, level - VEC_NODE_BITS, tail);
+    VM_SPOP(node);
+
+    node->slots[sub] = value_obj(child);
+    return node;
+}
+
+/* moves the full tail into the trie, vo->tail is NULL afterwards */
+static void moveTailToTrie(VM* vm, VectorObj* vo)
+{
+    VecNode* tail = vo->tail;
+
+    if (vo->root == NULL)
+    {
+        vo->root = newPath(vm, vo->shift, tail);
+    }
+    else if ((vo->count >> VEC_NODE_BITS) > (1 << vo->shift))
+    {
+        // root is full, grow a level
+        VecNode* path = newPath(vm, vo->shift, tail);
+        VM_SPUSH(path);
+        VecNode* root = newVecNode(vm, 2);
+        VM_SPOP(path);
+
+        root->slots[0] = value_obj(vo->root);
+        root->slots[1] = value_obj(path);
+        root->count = 2;
+        vo->root = root;
+        vo->shift += VEC_NODE_BITS;
+    }
+    else
+    {
+        vo->root = pushTail(vm, vo->count, vo->shift, vo->root, tail);
+    }
+
+    vo->tail = NULL;
+}
+
+static VecNode* leafFor(VectorObj* vo, int index)
+{
+    if (index >= VEC_TAIL_OFFSET(vo->count))
+        return vo->tail;
+
+    VecNode* node = vo->root;
+    for (int level = vo->shift; level > 0; level -= VEC_NODE_BITS)
+        node = VEC_CHILD(node, (index >> level) & VEC_NODE_MASK);
+
+    return node;
+}
+
+/* path copy, nodes owned by edit (0 for none) are changed in place */
+static VecNode* assocNode(VM* vm, uint64_t edit, int level, VecNode* node, int index, Value v)
+{
+    VecNode* copy = edit ? editableVecNode(vm, node, edit) : copyVecNode(vm, node, node->count);
+    if (level == 0)
+    {
+        copy->slots[index & VEC_NODE_MASK] = v;
+        if (copy == node)
+            CWRITE_BARRIER(vm, copy);
+        return copy;
+    }
+
+    int sub = (index >> level) & VEC_NODE_MASK;
+
+    VM_SPUSH(copy);
+    VecNode* child = assocNode(vm, edit, level - VEC_NODE_BITS, VEC_CHILD(copy, sub), index, v);
+    VM_SPOP(copy);
+
+    if (child != VEC_CHILD(copy, sub))
+    {
+        copy->slots[sub] = value_obj(child);
+        if (copy == node)
+            CWRITE_BARRIER(vm, copy);
+    }
+
+    return copy;
+}
+
+static VectorObj* allocateVector(VM* vm)
+{
+    VectorObj* vectorObj = CALLOCATE_OBJ(vm, VectorObj, LLO_VECTOR);
+    vectorObj->meta = value_nil();
+    vectorObj->count = 0;
+    vectorObj->shift = VEC_NODE_BITS;
+    vectorObj->edit = 0;
+    vectorObj->root = NULL;
+    vectorObj->tail = NULL;
+    return vectorObj;
+}
+
+/* fills whole leaves, arr NULL for nils */
+static VectorObj* vectorFromArr(VM* vm, int len, Value* arr)
+{
+    VectorObj* vectorObj = allocateVector(vm);
+    VM_PUSH(vectorObj);
+
+    for (int start = 0; start < len; start += VEC_NODE_WIDTH)
+    {
+        int n = len - start < VEC_NODE_WIDTH ? len - start : VEC_NODE_WIDTH;
+
+        if (vectorObj->tail != NULL)
+            moveTailToTrie(vm, vectorObj);
+
+        VecNode* leaf = newVecNode(vm, n);
+        for (int i = 0; i < n; i++)
+            leaf->slots[i] = arr ? arr[start + i] : value_nil();
+        leaf->count = n;
+
+        vectorObj->tail = leaf;
+        vectorObj->count += n;
+    }
+
+    VM_POP(vectorObj);
+    return vectorObj;
+}
+
+VectorObj* vectorobj_new(VM* vm, int len, ...)
+{
+    Value* arr = CALLOCATE(vm, Value, len);
+
+    va_list args;
+    va_start(args, len);
+
+    for (size_t i = 0; i < len; i++)
+        arr[i] = va_arg(args, Value);
+
+    va_end(args);
+
+    VectorObj* vectorObj = vectorFromArr(vm, len, arr);
+    CFREE_ARRAY(vm, Value, arr, len);
+
+    return vectorObj;
+}
+
+VectorObj* vectorobj_newWithNil(VM* vm, int len)
+{
+    return vectorFromArr(vm, len, NULL);
+}
+
+VectorObj* vectorobj_newWithArr(VM* vm, int len, Value* arr)
+{
+    return vectorFromArr(vm, len, arr);
+}
+
+bool vectorobj_set(VectorObj* vo, int index, Value v)
+{
+    if (index < 0 || index >= vo->count)
+        return false;
+
+    vo->base.hash = 0;
+    leafFor(vo, index)->slots[index & VEC_NODE_MASK] = v;
+    return true;
+}
+
+bool vectorobj_get(VectorObj* vo, int index, Value* v)
+{
+    if (index < 0 || index >= vo->count)
+        return false;
+
+    *v = leafFor(vo, index)->slots[index & VEC_NODE_MASK];
+    return true;
+}
+
+/* shares all but the tail (and the new trie path once the tail is full) */
+VectorObj* vectorobj_conj(VM* vm, VectorObj* vo, Value v)
+{
+    VM_SPUSHV(v);
+    VectorObj* ret = allocateVector(vm);
+    ret->count = vo->count;
+    ret->shift = vo->shift;
+    ret->root = vo->root;
+    ret->tail = vo->tail;
+
+    VM_SPUSH(ret);
+
+    int inTail = ret->count - VEC_TAIL_OFFSET(ret->count);
+    if (ret->tail != NULL && inTail == VEC_NODE_WIDTH)
+    {
+        moveTailToTrie(vm, ret);
+        inTail = 0;
+    }
+
+    VecNode* tail;
+    if (ret->tail != NULL)
+    {
+        tail = copyVecNode(vm, ret->tail, inTail + 1);
+    }
+    else
+    {
+        tail = newVecNode(vm, 1);
+        tail->count = 1;
+    }
+
+    tail->slots[inTail] = v;
+    ret->tail = tail;
+    ret->count++;
+
+    VM_SPOP(ret);
+    VM_SPOPV(v);
+
+    return ret;
+}
+
+VectorObj* vectorobj_assoc(VM* vm, VectorObj* vo, int index, Value v)
+{
+    if (index == vo->count)
+        return vectorobj_conj(vm, vo, v);
+
+    VM_SPUSHV(v);
+    VectorObj* ret = allocateVector(vm);
+    ret->meta = vo->meta;
+    ret->count = vo->count;
+    ret->shift = vo->shift;
+    ret->root = vo->root;
+    ret->tail = vo->tail;
+
+    VM_SPUSH(ret);
+
+    if (index >= VEC_TAIL_OFFSET(ret->count))
+    {
+        VecNode* tail = copyVecNode(vm, ret->tail, ret->tail->count);
+        tail->slots[index & VEC_NODE_MASK] = v;
+        ret->tail = tail;
+    }
+    else
+    {
+        ret->root = assocNode(vm, 0, ret->shift, ret->root, index, v);
+    }
+
+    VM_SPOP(ret);
+    VM_SPOPV(v);
+
+    return ret;
+}
+
+/* O(1), shares the nodes of vo, changes only the ones it copies from now on */
+VectorObj* vectorobj_transient(VM* vm, VectorObj* vo)
+{
+    VM_SPUSH(vo);
+    VectorObj* ret = allocateVector(vm);
+    VM_SPOP(vo);
+
+    ret->count = vo->count;
+    ret->shift = vo->shift;
+    ret->root = vo->root;
+    ret->tail = vo->tail;
+    ret->edit = ++s_edit;
+
+    return ret;
+}
+
+/* O(1), the nodes keep their token but no vector owns it any more */
+void vectorobj_persistent(VectorObj* vo)
+{
+    vo->edit = 0;
+}
+
+void vectorobj_conjInPlace(VM* vm, VectorObj* vo, Value v)
+{
+    vo->base.hash = 0;
+    VM_SPUSHV(v);
+
+    int inTail = vo->count - VEC_TAIL_OFFSET(vo->count);
+    if (vo->tail != NULL && inTail == VEC_NODE_WIDTH)
+    {
+        moveTailToTrie(vm, vo);
+        inTail = 0;
+    }
+
+    VecNode* tail;
+    if (vo->tail != NULL)
+    {
+        tail = editableVecNode(vm, vo->tail, vo->edit);
+    }
+    else
+    {
+        tail = newVecNode(vm, VEC_NODE_WIDTH);
+        tail->edit = vo->edit;
+    }
+
+    VM_SPOPV(v);
+
+    tail->slots[inTail] = v;
+    tail->count = inTail + 1;
+    CWRITE_BARRIER(vm, tail);
+
+    if (vo->tail != tail)
+    {
+        vo->tail = tail;
+        CWRITE_BARRIER(vm, vo);
+    }
+
+    vo->count++;
+}
+
+void vectorobj_assocInPlace(VM* vm, VectorObj* vo, int index, Value v)
+{
+    vo->base.hash = 0;
+    if (index == vo->count)
+    {
+        vectorobj_conjInPlace(vm, vo, v);
+        return;
+    }
+
+    VM_SPUSHV(v);
+
+    if (index >= VEC_TAIL_OFFSET(vo->count))
+    {
+        VecNode* tail = editableVecNode(vm, vo->tail, vo->edit);
+        tail->slots[index & VEC_NODE_MASK] = v;
+        CWRITE_BARRIER(vm, tail);
+
+        if (vo->tail != tail)
+        {
+            vo->tail = tail;
+            CWRITE_BARRIER(vm, vo);
+        }
+    }
+    else
+    {
+        VecNode* root = assocNode(vm, vo->edit, vo->shift, vo->root, index, v);
+        if (vo->root != root)
+        {
+            vo->root = root;
+            CWRITE_BARRIER(vm, vo);
+        }
+    }
+
+    VM_SPOPV(v);
+}
+
+/* ----- slice ----- */
+
+/* O(1), a slice of a slice views the same vector */
+SliceObj* sliceobj_new(VM* vm, Value coll, int start, int count, bool isVector)
+{
+    VM_SPUSHV(coll);
+    SliceObj* sliceObj = CALLOCATE_OBJ(vm, SliceObj, LLO_SLICE);
+    VM_SPOPV(coll);
+
+    sliceObj->meta = value_nil();
+    sliceObj->count = count;
+    sliceObj->isVector = isVector;
+
+    if (value_isSlice(coll))
+    {
+        sliceObj->vec = value_asSlice(coll)->vec;
+        sliceObj->start = value_asSlice(coll)->start + start;
+    }
+    else
+    {
+        sliceObj->vec = value_asVector(coll);
+        sliceObj->start = start;
+    }
+
+    return sliceObj;
+}
+
+/* sets index of the vector it views, past the end of s that conjs onto s */
+SliceObj* sliceobj_assoc(VM* vm, SliceObj* s, int index, Value v)
+{
+    VM_SPUSH(s);
+    VectorObj* vec = vectorobj_assoc(vm, s->vec, s->start + index, v);
+    VM_SPUSH(vec);
+    SliceObj* ret = sliceobj_new(vm, value_obj(vec), s->start, index == s->count ? s->count + 1 : s->count,
+                                 s->isVector);
+    VM_SPOP(vec);
+    VM_SPOP(s);
+
+    ret->meta = s->meta;
+    return ret;
+}
+
+/* copy of the items of s */
+VectorObj* sliceobj_toVector(VM* vm, SliceObj* s)
+{
+    VM_SPUSH(s);
+    VectorObj* vo = vectorobj_newWithNil(vm, s->count);
+    VM_SPOP(s);
+
+    SeqIter iter;
+    value_iterInit(value_obj(s), &iter);
+
+    Value item;
+    for (int i = 0; seqiter_next(&iter, &item); i++)
+        vectorobj_set(vo, i, item);
+
+    vo->meta = s->meta;
+    return vo;
+}
+
+/* ----- map ----- */
+
+#define NODE_FRAG(hash, shift) (((hash) >> (shift)) & (MAP_NODE_WIDTH - 1))
+#define NODE_BIT(hash, shift)  ((uint32_t)1 << NODE_FRAG(hash, shift))
+#define NODE_CHILD(n, slot)    ((MapNode*)value_asObj((n)->slots[(slot)]))
+#define NODE_MAX_SLOTS         (2 * MAP_NODE_WIDTH)
+
+static int popcount32(uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    return (int)((((x + (x >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+#endif
+}
+
+int mapnode_pairCount(MapNode* n)
+{
+    return n->collision ? n->collisionCount : popcount32(n->dataMap);
+}
+
+int mapnode_slotCount(MapNode* n)
+{
+    return 2 * mapnode_pairCount(n) + popcount32(n->nodeMap);
+}
+
+static int pairSlot(MapNode* n, uint32_t bit)
+{
+    return 2 * popcount32(n->dataMap & (bit - 1));
+}
+
+static int childSlot(MapNode* n, uint32_t bit)
+{
+    return 2 * popcount32(n->dataMap) + popcount32(n->nodeMap & (bit - 1));
+}
+
+static bool keyEq(VM* vm, Value stored, uint32_t hash, Value key)
+{
+    return value_hash(stored) == hash && value_eq(vm, stored, key);
+}
+
+/* keys of collision nodes and flat roots, symbols and keywords match by their interned string */
+static bool flatKeyEq(VM* vm, Value stored, Value key)
+{
+    if (value_isObj(stored) && value_isObj(key))
+    {
+        Obj* a = value_asObj(stored);
+        Obj* b = value_asObj(key);
+
+        if (a == b)
+            return true;
+
+        if (obj_isSymbol(a))
+            return obj_isSymbol(b) && obj_asSymbol(a)->symbol == obj_asSymbol(b)->symbol;
+
+        if (obj_isKeyword(a))
+            return obj_isKeyword(b) && obj_asKeyword(a)->keyword == obj_asKeyword(b)->keyword;
+    }
+
+    return value_eq(vm, stored, key);
+}
+
+static MapNode* newMapNode(VM* vm, uint64_t edit, int capacity)
+{
+    MapNode* node = (MapNode*)allocateObject(vm, sizeof(MapNode) + sizeof(Value) * capacity, LLO_MAP_NODE);
+    node->dataMap = 0;
+    node->nodeMap = 0;
+    node->edit = edit;
+    node->capacity = (uint16_t)capacity;
+    node->collisionCount = 0;
+    node->collision = false;
+    return node;
+}
+
+/**
+ * node itself when the map owning edit may change it and it has room for extra
+ * slots, a copy owned by edit otherwise. Nodes the map already owns grow by
+ * doubling, first copies are exact.
+ */
+static MapNode* writableNode(VM* vm, MapNode* node, uint64_t edit, int extra)
+{
+    int used = mapnode_slotCount(node);
+    bool owned = node->edit == edit;
+
+    if (owned && node->capacity >= used + extra)
+        return node;
+
+    int capacity = used + extra;
+    if (owned && capacity * 2 <= NODE_MAX_SLOTS)
+        capacity *= 2;
+    else if (owned && capacity < NODE_MAX_SLOTS)
+        capacity = NODE_MAX_SLOTS;
+
+    MapNode* copy = newMapNode(vm, edit, capacity);
+    copy->dataMap = node->dataMap;
+    copy->nodeMap = node->nodeMap;
+    copy->collision = node->collision;
+    copy->collisionCount = node->collisionCount;
+    memcpy(copy->slots, node->slots, sizeof(Value) * used);
+
+    return copy;
+}
+
+static void openSlots(MapNode* n, int at, int count, int used)
+{
+    memmove(&n->slots[at + count], &n->slots[at], sizeof(Value) * (used - at));
+}
+
+static void closeSlots(MapNode* n, int at, int count, int used)
+{
+    memmove(&n->slots[at], &n->slots[at + count], sizeof(Value) * (used - at - count));
+}
+
+static MapNode* mergePairs(VM* vm, uint64_t edit, int shift,
+                           uint32_t hash1, Value key1, Value value1,
+                           uint32_t hash2, Value key2, Value value2)
+{
+    if (shift >= 32)
+    {
+        MapNode* n = newMapNode(vm, edit, 4);
+        n->collision = true;
+        n->collisionCount = 2;
+        n->slots[0] = key1;
+        n->slots[1] = value1;
+        n->slots[2] = key2;
+        n->slots[3] = value2;
+        return n;
+    }
+
+    uint32_t bit1 = NODE_BIT(hash1, shift);
+    uint32_t bit2 = NODE_BIT(hash2, shift);
+
+    if (bit1 != bit2)
+    {
+        MapNode* n = newMapNode(vm, edit, 4);
+        n->dataMap = bit1 | bit2;
+        int first = bit1 < bit2 ? 0 : 2;
+        n->slots[first] = key1;
+        n->slots[first + 1] = value1;
+        n->slots[2 - first] = key2;
+        n->slots[3 - first] = value2;
+        return n;
+    }
+
+    MapNode* n = newMapNode(vm, edit, 1);
+    n->nodeMap = bit1;
+    n->slots[0] = value_nil();
+
+    VM_SPUSH(n);
+    MapNode* child = mergePairs(vm, edit, shift + MAP_NODE_BITS,
+                                hash1, key1, value1, hash2, key2, value2);
+    VM_SPOP(n);
+
+    n->slots[0] = value_obj(child);
+    return n;
+}
+
+static MapNode* nodeAssoc(VM* vm, MapNode* node, uint64_t edit, int shift,
+                          uint32_t hash, Value key, Value value, bool* added)
+{
+    if (node->collision)
+    {
+        for (int i = 0; i < node->collisionCount; i++)
+        {
+            if (flatKeyEq(vm, node->slots[2 * i], key))
+            {
+                MapNode* n = writableNode(vm, node, edit, 0);
+                n->slots[2 * i + 1] = value;
+                return n;
+            }
+        }
+
+        int used = mapnode_slotCount(node);
+        MapNode* n = writableNode(vm, node, edit, 2);
+        n->slots[used] = key;
+        n->slots[used + 1] = value;
+        n->collisionCount++;
+        *added = true;
+        return n;
+    }
+
+    uint32_t bit = NODE_BIT(hash, shift);
+
+    if (node->dataMap & bit)
+    {
+        int at = pairSlot(node, bit);
+        if (keyEq(vm, node->slots[at], hash, key))
+        {
+            MapNode* n = writableNode(vm, node, edit, 0);
+            n->slots[at + 1] = value;
+            return n;
+        }
+
+        // both keys share this fragment, push them down a level
+        MapNode* n = writableNode(vm, node, edit, 0);
+        Value curKey = n->slots[at];
+
+        VM_SPUSH(n);
+        MapNode* child = mergePairs(vm, edit, shift + MAP_NODE_BITS,
+                                    value_hash(curKey), curKey, n->slots[at + 1],
+                                    hash, key, value);
+        VM_SPOP(n);
+
+        int used = mapnode_slotCount(n);
+        closeSlots(n, at, 2, used);
+        n->dataMap &= ~bit;
+
+        int childAt = childSlot(n, bit);
+        openSlots(n, childAt, 1, used - 2);
+        n->slots[childAt] = value_obj(child);
+        n->nodeMap |= bit;
+
+        *added = true;
+        return n;
+    }
+
+    if (node->nodeMap & bit)
+    {
+        MapNode* n = writableNode(vm, node, edit, 0);
+        int at = childSlot(n, bit);
+
+        VM_SPUSH(n);
+        MapNode* child = nodeAssoc(vm, NODE_CHILD(n, at), edit, shift + MAP_NODE_BITS,
+                                   hash, key, value, added);
+        VM_SPOP(n);
+
+        n->slots[at] = value_obj(child);
+        return n;
+    }
+
+    MapNode* n = writableNode(vm, node, edit, 2);
+    int used = mapnode_slotCount(n);
+    int at = pairSlot(n, bit);
+    openSlots(n, at, 2, used);
+    n->slots[at] = key;
+    n->slots[at + 1] = value;
+    n->dataMap |= bit;
+
+    *added = true;
+    return n;
+}
+
+/* a node holding a single pair is inlined into its parent */
+static bool isSinglePair(MapNode* n)
+{
+    return n->nodeMap == 0 && mapnode_pairCount(n) == 1;
+}
+
+/* node without key, NULL when nothing is left */
+static MapNode* nodeDissoc(VM* vm, MapNode* node, uint64_t edit, int shift,
+                           uint32_t hash, Value key, bool* removed)
+{
+    if (node->collision)
+    {
+        for (int i = 0; i < node->collisionCount; i++)
+        {
+            if (!flatKeyEq(vm, node->slots[2 * i], key))
+                continue;
+
+            *removed = true;
+            if (node->collisionCount == 1)
+                return NULL;
+
+            MapNode* n = writableNode(vm, node, edit, 0);
+            closeSlots(n, 2 * i, 2, mapnode_slotCount(n));
+            n->collisionCount--;
+            return n;
+        }
+
+        return node;
+    }
+
+    uint32_t bit = NODE_BIT(hash, shift);
+
+    if (node->dataMap & bit)
+    {
+        int at = pairSlot(node, bit);
+        if (!keyEq(vm, node->slots[at], hash, key))
+            return node;
+
+        *removed = true;
+        if (mapnode_slotCount(node) == 2)
+            return NULL;
+
+        MapNode* n = writableNode(vm, node, edit, 0);
+        closeSlots(n, at, 2, mapnode_slotCount(n));
+        n->dataMap &= ~bit;
+        return n;
+    }
+
+    if (!(node->nodeMap & bit))
+        return node;
+
+    int at = childSlot(node, bit);
+    MapNode* child = NODE_CHILD(node, at);
+    MapNode* newChild = nodeDissoc(vm, child, edit, shift + MAP_NODE_BITS, hash, key, removed);
+
+    if (!*removed)
+        return node;
+
+    if (newChild == NULL)
+    {
+        if (mapnode_slotCount(node) == 1)
+            return NULL;
+
+        MapNode* n = writableNode(vm, node, edit, 0);
+        closeSlots(n, at, 1, mapnode_slotCount(n));
+        n->nodeMap &= ~bit;
+        return n;
+    }
+
+    if (isSinglePair(newChild))
+    {
+        VM_SPUSH(newChild);
+        MapNode* n = writableNode(vm, node, edit, 1);
+        VM_SPOP(newChild);
+
+        int used = mapnode_slotCount(n);
+        closeSlots(n, at, 1, used);
+        n->nodeMap &= ~bit;
+
+        int pairAt = pairSlot(n, bit);
+        openSlots(n, pairAt, 2, used - 1);
+        n->slots[pairAt] = newChild->slots[0];
+        n->slots[pairAt + 1] = newChild->slots[1];
+        n->dataMap |= bit;
+        return n;
+    }
+
+    if (newChild == child)
+        return node;
+
+    VM_SPUSH(newChild);
+    MapNode* n = writableNode(vm, node, edit, 0);
+    VM_SPOP(newChild);
+
+    n->slots[at] = value_obj(newChild);
+    return n;
+}
+
+/* trie of the pairs of a flat root which outgrew MAP_FLAT_MAX */
+static MapNode* unflatten(VM* vm, MapNode* flat, uint64_t edit)
+{
+    VM_SPUSH(flat);
+
+    MapNode* root = newMapNode(vm, edit, 2);
+    root->dataMap = NODE_BIT(value_hash(flat->slots[0]), 0);
+    root->slots[0] = flat->slots[0];
+    root->slots[1] = flat->slots[1];
+
+    for (int i = 1; i < flat->collisionCount; i++)
+    {
+        Value key = flat->slots[2 * i];
+        bool added = false;
+
+        VM_SPUSH(root);
+        MapNode* next = nodeAssoc(vm, root, edit, 0, value_hash(key), key, flat->slots[2 * i + 1], &added);
+        VM_SPOP(root);
+        root = next;
+    }
+
+    VM_SPOP(flat);
+    return root;
+}
+
+static MapObj* allocateMap(VM* vm)
+{
+    MapObj* mapObj = CALLOCATE_OBJ(vm, MapObj, LLO_MAP);
+    mapObj->meta = value_nil();
+    mapObj->count = 0;
+    mapObj->edit = ++s_edit;
+    mapObj->root = NULL;
+    return mapObj;
+}
+
+MapObj* mapobj_new(VM* vm, int len, ...)
+{
+    MapObj* mapObj = allocateMap(vm);
+    VM_PUSH(mapObj);
+
+    va_list args;
+    va_start(args, len);
+
+    for (size_t i = 0; i < len; i = i + 2)
+    {
+        Value key = va_arg(args, Value);
+        Value value = va_arg(args, Value);
+        mapobj_set(vm, mapObj, key, value);
+    }
+
+    va_end(args);
+
+    VM_POP(mapObj);
+    return mapObj;
+}
+
+MapObj* mapobj_newWithArr(VM* vm, int len, Value* arr)
+{
+    MapObj* mapObj = allocateMap(vm);
+    VM_PUSH(mapObj);
+
+    // a small map gets its flat root at full size up front
+    if (len > 0 && len / 2 <= MAP_FLAT_MAX)
+    {
+        mapObj->root = newMapNode(vm, mapObj->edit, len);
+        mapObj->root->collision = true;
+    }
+
+    for (size_t i = 0; i < len; i = i + 2)
+        mapobj_set(vm, mapObj, arr[i], arr[i + 1]);
+
+    VM_POP(mapObj);
+    return mapObj;
+}
+
+/* O(1), both maps share the nodes from now on */
+MapObj* mapobj_clone(VM* vm, MapObj* other)
+{
+    MapObj* newMap = allocateMap(vm);
+    newMap->meta = other->meta;
+    newMap->count = other->count;
+    newMap->root = other->root;
+
+    // other may no longer change the shared nodes in place
+    other->edit = ++s_edit;
+
+    return newMap;
+}
+
+MapObj* mapobj_assoc(VM* vm, MapObj* m, Value key, Value value)
+{
+    MapObj* newMap = mapobj_clone(vm, m);
+
+    VM_SPUSH(newMap);
+    mapobj_set(vm, newMap, key, value);
+    VM_SPOP(newMap);
+
+    return newMap;
+}
+
+MapObj* mapobj_dissoc(VM* vm, MapObj* m, Value key)
+{
+    if (!mapobj_get(vm, m, key, NULL))
+        return m;
+
+    MapObj* newMap = mapobj_clone(vm, m);
+
+    VM_SPUSH(newMap);
+    mapobj_del(vm, newMap, key);
+    VM_SPOP(newMap);
+
+    return newMap;
+}
+
+bool mapobj_set(VM* vm, MapObj* m, Value key, Value value)
+{
+    if (m == NULL)
+        return false;
+
+    m->base.hash = 0; // a cached hash is stale now
+    bool added = false;
+
+    VM_SPUSHV(key);
+    VM_SPUSHV(value);
+
+    if (m->root == NULL)
+    {
+        MapNode* n = newMapNode(vm, m->edit, 2);
+        n->collision = true;
+        n->collisionCount = 1;
+        n->slots[0] = key;
+        n->slots[1] = value;
+        m->root = n;
+        added = true;
+    }
+    else if (m->root->collision)
+    {
+        // small maps stay flat, keys get hashed once the map becomes a trie
+        m->root = nodeAssoc(vm, m->root, m->edit, 0, 0, key, value, &added);
+        if (m->root->collisionCount > MAP_FLAT_MAX)
+            m->root = unflatten(vm, m->root, m->edit);
+    }
+    else
+    {
+        m->root = nodeAssoc(vm, m->root, m->edit, 0, value_hash(key), key, value, &added);
+    }
+
+    VM_SPOPV(value);
+    VM_SPOPV(key);
+
+    if (added)
+        m->count++;
+
+    return added;
+}
+
+bool mapobj_getWithHash(VM* vm, MapObj* m, Value key, uint32_t hash, Value* value)
+{
+    if (m == NULL)
+        return false;
+
+    MapNode* node = m->root;
+    int shift = 0;
+
+    while (node != NULL)
+    {
+        if (node->collision)
+        {
+            for (int i = 0; i < node->collisionCount; i++)
+            {
+                if (flatKeyEq(vm, node->slots[2 * i], key))
+                {
+                    if (value)
+                        *value = node->slots[2 * i + 1];
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        uint32_t bit = NODE_BIT(hash, shift);
+
+        if (node->dataMap & bit)
+        {
+            int at = pairSlot(node, bit);
+            if (!keyEq(vm, node->slots[at], hash, key))
+                return false;
+
+            if (value)
+                *value = node->slots[at + 1];
+            return true;
+        }
+
+        if (!(node->nodeMap & bit))
+            return false;
+
+        node = NODE_CHILD(node, childSlot(node, bit));
+        shift += MAP_NODE_BITS;
+    }
+
+    return false;
+}
+
+bool mapobj_get(VM* vm, MapObj* m, Value key, Value* value)
+{
+    // a flat root doesn't look at the hash
+    uint32_t hash = m != NULL && m->root != NULL && !m->root->collision ? value_hash(key) : 0;
+    return mapobj_getWithHash(vm, m, key, hash, value);
+}
+
+bool mapobj_del(VM* vm, MapObj* m, Value key)
+{
+    if (m == NULL || m->root == NULL)
+        return false;
+
+    m->base.hash = 0;
+    bool removed = false;
+
+    uint32_t hash = m->root->collision ? 0 : value_hash(key);
+
+    VM_SPUSHV(key);
+    m->root = nodeDissoc(vm, m->root, m->edit, 0, hash, key, &removed);
+    VM_SPOPV(key);
+
+    if (removed)
+        m->count--;
+
+    return removed;
+}
+
+/* the iterator holds no gc roots, the map must stay alive and unchanged while iterating */
+void mapobj_iterInit(MapObj* m, MapIter* iter)
+{
+    iter->depth = m->root ? 0 : -1;
+    iter->nodes[0] = m->root;
+    iter->index[0] = 0;
+}
+
+bool mapobj_iterNext(MapIter* iter, Value* key, Value* value)
+{
+    while (iter->depth >= 0)
+    {
+        MapNode* node = iter->nodes[iter->depth];
+        int pairs = mapnode_pairCount(node);
+        int index = iter->index[iter->depth]++;
+
+        if (index < pairs)
+        {
+            if (key)
+                *key = node->slots[2 * index];
+            if (value)
+                *value = node->slots[2 * index + 1];
+            return true;
+        }
+
+        if (index - pairs < popcount32(node->nodeMap))
+        {
+            iter->depth++;
+            iter->nodes[iter->depth] = NODE_CHILD(node, pairs + index);
+            iter->index[iter->depth] = 0;
+            continue;
+        }
+
+        iter->depth--;
+    }
+
+    return false;
+}
+
+/* ----- set ----- */
+
+SetObj* setobj_new(VM* vm, MapObj* map)
+{
+    VM_SPUSH(map);
+    SetObj* setObj = CALLOCATE_OBJ(vm, SetObj, LLO_SET);
+    VM_SPOP(map);
+
+    setObj->meta = value_nil();
+    setObj->map = map;
+    return setObj;
+}
+
+SetObj* setobj_newWithArr(VM* vm, int len, Value* arr)
+{
+    MapObj* map = mapobj_new(vm, 0);
+    VM_PUSH(map);
+
+    for (int i = 0; i < len; i++)
+        mapobj_set(vm, map, arr[i], arr[i]);
+
+    SetObj* setObj = setobj_new(vm, map);
+    VM_POP(map);
+    return setObj;
+}
+
+SetObj* setobj_conj(VM* vm, SetObj* s, Value v)
+{
+    if (mapobj_get(vm, s->map, v, NULL))
+        return s;
+
+    VM_SPUSH(s);
+    MapObj* map = mapobj_assoc(vm, s->map, v, v);
+    SetObj* newSet = setobj_new(vm, map);
+    VM_SPOP(s);
+
+    newSet->meta = s->meta;
+    return newSet;
+}
+
+SetObj* setobj_disj(VM* vm, SetObj* s, Value v)
+{
+    if (!mapobj_get(vm, s->map, v, NULL))
+        return s;
+
+    VM_SPUSH(s);
+    MapObj* map = mapobj_dissoc(vm, s->map, v);
+    SetObj* newSet = setobj_new(vm, map);
+    VM_SPOP(s);
+
+    newSet->meta = s->meta;
+    return newSet;
+}
+
+/* the item of s equal to v */
+bool setobj_get(VM* vm, SetObj* s, Value v, Value* item)
+{
+    return mapobj_get(vm, s->map, v, item);
+}
+
+/* ----- sorted ----- */
+
+#define SNODE_KEY(n, i)   ((n)->slots[(i)])
+#define SNODE_VAL(n, i)   ((n)->slots[(n)->count + (i)])
+#define SNODE_CHILD(n, i) \
+    ((SortedNode*)value_asObj((n)->slots[((n)->hasVals ? 2 : 1) * (n)->count + (i)]))
+
+int sortednode_slotCount(SortedNode* n)
+{
+    return (n->hasVals ? 2 : 1) * n->count + (n->leaf ? 0 : n->count + 1);
+}
+
+static SortedNode* newSortedNode(VM* vm, int count, bool leaf, bool hasVals)
+{
+    int slots = (hasVals ? 2 : 1) * count + (leaf ? 0 : count + 1);
+    SortedNode* n = (SortedNode*)allocateObject(vm, sizeof(SortedNode) + sizeof(Value) * slots, LLO_SORTED_NODE);
+    n->count = count;
+    n->leaf = leaf;
+    n->hasVals = hasVals;
+    for (int i = 0; i < slots; i++)
+        n->slots[i] = value_nil();
+
+    return n;
+}
+
+SortedObj* sortedobj_new(VM* vm, bool isSet, Value cmp)
+{
+    VM_SPUSHV(cmp);
+    SortedObj* sortedObj = CALLOCATE_OBJ(vm, SortedObj, LLO_SORTED);
+    VM_SPOPV(cmp);
+
+    sortedObj->meta = value_nil();
+    sortedObj->count = 0;
+    sortedObj->isSet = isSet;
+    sortedObj->cmp = cmp;
+    sortedObj->root = NULL;
+    return sortedObj;
+}
+
+static SortedObj* sortedWithRoot(VM* vm, SortedObj* s, SortedNode* root, int count)
+{
+    VM_SPUSH(s);
+    SortedObj* newSorted = sortedobj_new(vm, s->isSet, s->cmp);
+    VM_SPOP(s);
+
+    newSorted->meta = s->meta;
+    newSorted->count = count;
+    newSorted->root = root;
+    return newSorted;
+}
+
+/**
+ * Order of a and b in s. A cmp giving a number is a comparator, any other
+ * result makes it a predicate like <, asked the other way round for ties.
+ * cb is s->cmp, initialized once by the caller.
+ */
+bool sortedobj_compare(VM* vm, SortedObj* s, Callback* cb, Value a, Value b, int* out,
+                       ExceptionObj** exception)
+{
+    if (value_isNil(s->cmp))
+    {
+        if (value_compare(a, b, out))
+            return true;
+
+        THROW("RuntimeError: sorted coll keys have no order");
+        return false;
+    }
+
+    Value args[2] = { a, b };
+    Value ret = callback_call(vm, cb, 2, args, exception);
+    if (HAS_EXCEPTION())
+        return false;
+
+    if (value_isNum(ret))
+    {
+        *out = value_asNum(ret) < 0 ? -1 : (value_asNum(ret) > 0 ? 1 : 0);
+        return true;
+    }
+
+    if (value_true(ret))
+    {
+        *out = -1;
+        return true;
+    }
+
+    args[0] = b;
+    args[1] = a;
+    ret = callback_call(vm, cb, 2, args, exception);
+    if (HAS_EXCEPTION())
+        return false;
+
+    *out = value_true(ret) ? 1 : 0;
+    return true;
+}
+
+/* index of the first key of n not below key, found if that key is key */
+static bool sortedNodeSearch(VM* vm, SortedObj* s, Callback* cb, SortedNode* n, Value key,
+                             int* index, bool* found, ExceptionObj** exception)
+{
+    int lo = 0;
+    int hi = n->count;
+    *found = false;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        int c;
+        if (!sortedobj_compare(vm, s, cb, SNODE_KEY(n, mid), key, &c, exception))
+            return false;
+
+        if (c < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+            *found = *found || c == 0;
+        }
+    }
+
+    *index = lo;
+    return true;
+}
+
+/* nodes from the root down to key, or to the leaf it would go in */
+typedef struct
+{
+    SortedNode* nodes[SORTED_MAX_DEPTH];
+    int         index[SORTED_MAX_DEPTH]; // key or child taken at each level
+    int         depth;
+    int         foundAt;                 // level of key, -1 if s doesn't have it
+} SortedPath;
+
+/* all compares of an edit happen here, before any node is built */
+static bool sortedSearch(VM* vm, SortedObj* s, Value key, SortedPath* path, ExceptionObj** exception)
+{
+    Callback cb;
+    callback_init(&cb, s->cmp);
+
+    path->depth = 0;
+    path->foundAt = -1;
+
+    SortedNode* n = s->root;
+    while (n)
+    {
+        int i;
+        bool found;
+        if (!sortedNodeSearch(vm, s, &cb, n, key, &i, &found, exception))
+            return false;
+
+        path->nodes[path->depth] = n;
+        path->index[path->depth] = i;
+        path->depth++;
+
+        if (found)
+        {
+            path->foundAt = path->depth - 1;
+            return true;
+        }
+
+        n = n->leaf ? NULL : SNODE_CHILD(n, i);
+    }
+
+    return true;
+}
+
+/* value of key in a map, the key kept in a set */
+bool sortedobj_get(VM* vm, SortedObj* s, Value key, Value* value, ExceptionObj** exception)
+{
+    SortedPath path;
+    if (!sortedSearch(vm, s, key, &path, exception) || path.foundAt < 0)
+        return false;
+
+    if (value)
+    {
+        SortedNode* n = path.nodes[path.foundAt];
+        int i = path.index[path.foundAt];
+        *value = n->hasVals ? SNODE_VAL(n, i) : SNODE_KEY(n, i);
+    }
+
+    return true;
+}
+
+/* a node being put together, one key over full until it is split */
+typedef struct
+{
+    int   count;
+    bool  leaf;
+    Value keys[SORTED_NODE_MAX + 1];
+    Value vals[SORTED_NODE_MAX + 1];
+    Value children[SORTED_NODE_MAX + 2];
+} SortedScratch;
+
+/* nodes built by one edit, rooted until the new SortedObj holds them */
+typedef struct
+{
+    SortedNode* made[3 * SORTED_MAX_DEPTH + 2];
+    int         count;
+} SortedBuild;
+
+static void scratchLoad(SortedScratch* sc, SortedNode* n)
+{
+    sc->count = n->count;
+    sc->leaf = n->leaf;
+    for (int i = 0; i < n->count; i++)
+    {
+        sc->keys[i] = SNODE_KEY(n, i);
+        sc->vals[i] = n->hasVals ? SNODE_VAL(n, i) : value_nil();
+    }
+
+    if (!n->leaf)
+    {
+        Value* children = n->slots + (n->hasVals ? 2 : 1) * n->count;
+        memcpy(sc->children, children, sizeof(Value) * (n->count + 1));
+    }
+}
+
+static SortedScratch* scratchOfChild(SortedScratch* sc, SortedScratch* parent, int i)
+{
+    scratchLoad(sc, (SortedNode*)value_asObj(parent->children[i]));
+    return sc;
+}
+
+/* key at i, right as the child after it */
+static void scratchInsert(SortedScratch* sc, int i, Value key, Value val, Value right)
+{
+    memmove(sc->keys + i + 1, sc->keys + i, sizeof(Value) * (sc->count - i));
+    memmove(sc->vals + i + 1, sc->vals + i, sizeof(Value) * (sc->count - i));
+    sc->keys[i] = key;
+    sc->vals[i] = val;
+
+    if (!sc->leaf)
+    {
+        memmove(sc->children + i + 2, sc->children + i + 1, sizeof(Value) * (sc->count - i));
+        sc->children[i + 1] = right;
+    }
+
+    sc->count++;
+}
+
+/* key i and the child child (i or i + 1) */
+static void scratchRemove(SortedScratch* sc, int i, int child)
+{
+    memmove(sc->keys + i, sc->keys + i + 1, sizeof(Value) * (sc->count - i - 1));
+    memmove(sc->vals + i, sc->vals + i + 1, sizeof(Value) * (sc->count - i - 1));
+
+    if (!sc->leaf)
+        memmove(sc->children + child, sc->children + child + 1, sizeof(Value) * (sc->count - child));
+
+    sc->count--;
+}
+
+static SortedNode* buildNode(VM* vm, SortedBuild* b, SortedScratch* sc, int from, int count, bool hasVals)
+{
+    SortedNode* n = newSortedNode(vm, count, sc->leaf, hasVals);
+    memcpy(n->slots, sc->keys + from, sizeof(Value) * count);
+    if (hasVals)
+        memcpy(n->slots + count, sc->vals + from, sizeof(Value) * count);
+    if (!sc->leaf)
+        memcpy(n->slots + (hasVals ? 2 : 1) * count, sc->children + from, sizeof(Value) * (count + 1));
+
+    VM_PUSH(n);
+    b->made[b->count++] = n;
+    return n;
+}
+
+/* builds sc, split around its middle key into it and right when it is over full */
+static SortedNode* buildSplit(VM* vm, SortedBuild* b, SortedScratch* sc, bool hasVals,
+                              Value* midKey, Value* midVal, SortedNode** right)
+{
+    if (sc->count <= SORTED_NODE_MAX)
+    {
+        *right = NULL;
+        return buildNode(vm, b, sc, 0, sc->count, hasVals);
+    }
+
+    int mid = sc->count / 2;
+    *midKey = sc->keys[mid];
+    *midVal = sc->vals[mid];
+
+    SortedNode* left = buildNode(vm, b, sc, 0, mid, hasVals);
+    *right = buildNode(vm, b, sc, mid + 1, sc->count - mid - 1, hasVals);
+    return left;
+}
+
+static void buildEnd(VM* vm, SortedBuild* b)
+{
+    while (b->count > 0)
+    {
+        b->count--;
+        VM_POP(b->made[b->count]);
+    }
+}
+
+SortedObj* sortedobj_assoc(VM* vm, SortedObj* s, Value key, Value value, ExceptionObj** exception)
+{
+    SortedPath path;
+    if (!sortedSearch(vm, s, key, &path, exception))
+        return NULL;
+
+    if (s->isSet && path.foundAt >= 0)
+        return s;
+
+    bool hasVals = !s->isSet;
+    SortedBuild b;
+    b.count = 0;
+
+    SortedScratch sc;
+    Value upKey = value_nil();
+    Value upVal = value_nil();
+    SortedNode* right = NULL;
+    SortedNode* child;
+    int level;
+
+    if (path.foundAt >= 0)
+    {
+        level = path.foundAt;
+        scratchLoad(&sc, path.nodes[level]);
+        sc.vals[path.index[level]] = value;
+        child = buildNode(vm, &b, &sc, 0, sc.count, hasVals);
+    }
+    else
+    {
+        level = path.depth - 1;
+        if (level >= 0)
+        {
+            scratchLoad(&sc, path.nodes[level]);
+        }
+        else
+        {
+            sc.count = 0;
+            sc.leaf = true;
+        }
+
+        scratchInsert(&sc, level >= 0 ? path.index[level] : 0, key, value, value_nil());
+        child = buildSplit(vm, &b, &sc, hasVals, &upKey, &upVal, &right);
+    }
+
+    // copy the path up, taking in the middle key of each split
+    for (level--; level >= 0; level--)
+    {
+        int ci = path.index[level];
+        scratchLoad(&sc, path.nodes[level]);
+        sc.children[ci] = value_obj(child);
+
+        if (right)
+        {
+            scratchInsert(&sc, ci, upKey, upVal, value_obj(right));
+            child = buildSplit(vm, &b, &sc, hasVals, &upKey, &upVal, &right);
+        }
+        else
+        {
+            child = buildNode(vm, &b, &sc, 0, sc.count, hasVals);
+        }
+    }
+
+    if (right)
+    {
+        sc.count = 1;
+        sc.leaf = false;
+        sc.keys[0] = upKey;
+        sc.vals[0] = upVal;
+        sc.children[0] = value_obj(child);
+        sc.children[1] = value_obj(right);
+        child = buildNode(vm, &b, &sc, 0, 1, hasVals);
+    }
+
+    SortedObj* newSorted = sortedWithRoot(vm, s, child, s->count + (path.foundAt >= 0 ? 0 : 1));
+    buildEnd(vm, &b);
+    return newSorted;
+}
+
+/**
+ * Child ci of parent is one key short: it takes a key through the parent from
+ * a sibling which can spare one, or is merged with a sibling and the key
+ * between them.
+ */
+static void sortedRebalance(VM* vm, SortedBuild* b, SortedScratch* parent, int ci, bool hasVals)
+{
+    SortedScratch child, sib;
+    scratchOfChild(&child, parent, ci);
+
+    if (ci > 0 && scratchOfChild(&sib, parent, ci - 1)->count > SORTED_NODE_MIN)
+    {
+        memmove(child.keys + 1, child.keys, sizeof(Value) * child.count);
+        memmove(child.vals + 1, child.vals, sizeof(Value) * child.count);
+        child.keys[0] = parent->keys[ci - 1];
+        child.vals[0] = parent->vals[ci - 1];
+        if (!child.leaf)
+        {
+            memmove(child.children + 1, child.children, sizeof(Value) * (child.count + 1));
+            child.children[0] = sib.children[sib.count];
+        }
+        child.count++;
+
+        parent->keys[ci - 1] = sib.keys[sib.count - 1];
+        parent->vals[ci - 1] = sib.vals[sib.count - 1];
+        sib.count--;
+
+        parent->children[ci - 1] = value_obj(buildNode(vm, b, &sib, 0, sib.count, hasVals));
+        parent->children[ci] = value_obj(buildNode(vm, b, &child, 0, child.count, hasVals));
+        return;
+    }
+
+    if (ci < parent->count && scratchOfChild(&sib, parent, ci + 1)->count > SORTED_NODE_MIN)
+    {
+        Value first = sib.leaf ? value_nil() : sib.children[0];
+        scratchInsert(&child, child.count, parent->keys[ci], parent->vals[ci], first);
+
+        parent->keys[ci] = sib.keys[0];
+        parent->vals[ci] = sib.vals[0];
+        scratchRemove(&sib, 0, 0);
+
+        parent->children[ci] = value_obj(buildNode(vm, b, &child, 0, child.count, hasVals));
+        parent->children[ci + 1] = value_obj(buildNode(vm, b, &sib, 0, sib.count, hasVals));
+        return;
+    }
+
+    // neither sibling has a key to spare, the two halves fit in one node
+    int li = ci > 0 ? ci - 1 : ci;
+    SortedScratch left, right;
+    scratchOfChild(&left, parent, li);
+    scratchOfChild(&right, parent, li + 1);
+
+    left.keys[left.count] = parent->keys[li];
+    left.vals[left.count] = parent->vals[li];
+    memcpy(left.keys + left.count + 1, right.keys, sizeof(Value) * right.count);
+    memcpy(left.vals + left.count + 1, right.vals, sizeof(Value) * right.count);
+    if (!left.leaf)
+        memcpy(left.children + left.count + 1, right.children, sizeof(Value) * (right.count + 1));
+    left.count += 1 + right.count;
+
+    scratchRemove(parent, li, li + 1);
+    parent->children[li] = value_obj(buildNode(vm, b, &left, 0, left.count, hasVals));
+}
+
+SortedObj* sortedobj_dissoc(VM* vm, SortedObj* s, Value key, ExceptionObj** exception)
+{
+    SortedPath path;
+    if (!sortedSearch(vm, s, key, &path, exception))
+        return NULL;
+
+    if (path.foundAt < 0)
+        return s;
+
+    // a key of an inner node is swapped for the last key before it, which is in a leaf
+    int f = path.foundAt;
+    if (!path.nodes[f]->leaf)
+    {
+        SortedNode* n = SNODE_CHILD(path.nodes[f], path.index[f]);
+        for (;;)
+        {
+            path.nodes[path.depth] = n;
+            path.index[path.depth] = n->leaf ? n->count - 1 : n->count;
+            path.depth++;
+
+            if (n->leaf)
+                break;
+            n = SNODE_CHILD(n, n->count);
+        }
+    }
+
+    bool hasVals = !s->isSet;
+    SortedBuild b;
+    b.count = 0;
+
+    int level = path.depth - 1;
+    SortedNode* leaf = path.nodes[level];
+    int li = path.index[level];
+    Value predKey = SNODE_KEY(leaf, li);
+    Value predVal = hasVals ? SNODE_VAL(leaf, li) : value_nil();
+
+    SortedScratch sc;
+    scratchLoad(&sc, leaf);
+    scratchRemove(&sc, li, li);
+    SortedNode* child = buildNode(vm, &b, &sc, 0, sc.count, hasVals);
+
+    for (level--; level >= 0; level--)
+    {
+        int ci = path.index[level];
+        scratchLoad(&sc, path.nodes[level]);
+        sc.children[ci] = value_obj(child);
+
+        if (level == f)
+        {
+            sc.keys[ci] = predKey;
+            sc.vals[ci] = predVal;
+        }
+
+        if (child->count < SORTED_NODE_MIN)
+            sortedRebalance(vm, &b, &sc, ci, hasVals);
+
+        child = buildNode(vm, &b, &sc, 0, sc.count, hasVals);
+    }
+
+    // a root left without keys gives way to its only child
+    if (child->count == 0)
+        child = child->leaf ? NULL : SNODE_CHILD(child, 0);
+
+    SortedObj* newSorted = sortedWithRoot(vm, s, child, s->count - 1);
+    buildEnd(vm, &b);
+    return newSorted;
+}
+
+/* n and its first (last in reverse) children down to a leaf */
+static void sortedIterDescend(SortedIter* iter, SortedNode* n)
+{
+    for (;;)
+    {
+        int i = iter->reverse ? n->count : 0;
+        iter->nodes[iter->depth] = n;
+        iter->index[iter->depth] = i;
+        iter->depth++;
+
+        if (n->leaf)
+            return;
+        n = SNODE_CHILD(n, i);
+    }
+}
+
+void sortediter_init(SortedObj* s, SortedIter* iter, bool reverse)
+{
+    iter->depth = 0;
+    iter->reverse = reverse;
+    if (s->root)
+        sortedIterDescend(iter, s->root);
+}
+
+/**
+ * Puts iter before the first key not below key going forward, or the last
+ * key not above it in reverse; key itself is skipped unless inclusive.
+ */
+bool sortediter_seek(VM* vm, SortedObj* s, SortedIter* iter, Value key, bool inclusive, bool reverse,
+                     ExceptionObj** exception)
+{
+    Callback cb;
+    callback_init(&cb, s->cmp);
+
+    iter->depth = 0;
+    iter->reverse = reverse;
+    SortedNode* n = s->root;
+    while (n)
+    {
+        int i;
+        bool found;
+        if (!sortedNodeSearch(vm, s, &cb, n, key, &i, &found, exception))
+            return false;
+
+        int pos = (found && inclusive == iter->reverse) ? i + 1 : i;
+        iter->nodes[iter->depth] = n;
+        iter->index[iter->depth] = pos;
+        iter->depth++;
+
+        if (n->leaf)
+            return true;
+
+        if (found)
+        {
+            // the child next to key on the walk's side still has to be walked
+            if (pos != (iter->reverse ? i + 1 : i))
+                sortedIterDescend(iter, SNODE_CHILD(n, pos));
+            return true;
+        }
+
+        n = SNODE_CHILD(n, i);
+    }
+
+    return true;
+}
+
+/* value is the key again for a set */
+bool sortediter_next(SortedIter* iter, Value* key, Value* value)
+{
+    while (iter->depth > 0)
+    {
+        int top = iter->depth - 1;
+        SortedNode* n = iter->nodes[top];
+        int i = iter->index[top];
+
+        if (iter->reverse ? i > 0 : i < n->count)
+        {
+            int k = iter->reverse ? i - 1 : i;
+            if (key)
+                *key = SNODE_KEY(n, k);
+            if (value)
+                *value = n->hasVals ? SNODE_VAL(n, k) : SNODE_KEY(n, k);
+
+            iter->index[top] = iter->reverse ? i - 1 : i + 1;
+            if (!n->leaf)
+                sortedIterDescend(iter, SNODE_CHILD(n, iter->index[top]));
+            return true;
+        }
+
+        iter->depth--;
+    }
+
+    return false;
+}
+
+/* ----- lazy seq ----- */
+
+LazySeqObj* lazyseqobj_new(VM* vm, LazyKind kind, Value fn, Value src)
+{
+    VM_SPUSHV(fn);
+    VM_SPUSHV(src);
+    LazySeqObj* ls = CALLOCATE_OBJ(vm, LazySeqObj, LLO_LAZY_SEQ);
+    VM_SPOPV(src);
+    VM_SPOPV(fn);
+
+    ls->kind = kind;
+    ls->realized = false;
+    ls->realizing = false;
+    ls->index = 0;
+    ls->n = -1;
+    ls->fn = fn;
+    ls->src = src;
+    ls->start = 0;
+    ls->end = 0;
+    ls->step = 0;
+    ls->chunk = NULL;
+    ls->offset = 0;
+    ls->length = 0;
+    ls->more = NULL;
+
+    return ls;
+}
+
+LazySeqObj* lazyseqobj_newRange(VM* vm, double start, double end, double step)
+{
+    LazySeqObj* ls = lazyseqobj_new(vm, LAZY_RANGE, value_nil(), value_nil());
+    ls->start = start;
+    ls->end = end;
+    ls->step = step;
+
+    return ls;
+}
+
+LazySeqObj* lazyseqobj_newOfStr(VM* vm, StrObj* s)
+{
+    if (s->length == 0)
+        return NULL;
+
+    return lazyseqobj_new(vm, LAZY_WALK, value_nil(), value_obj(s));
+}
+
+/* realized, head followed by more */
+LazySeqObj* lazyseqobj_cons(VM* vm, Value head, Obj* more)
+{
+    VM_SPUSHV(head);
+    VM_SPUSH(more);
+    ListObj* chunk = allocateList(vm, 1);
+    VM_SPUSH(chunk);
+    LazySeqObj* ls = lazyseqobj_new(vm, LAZY_WALK, value_nil(), value_nil());
+    VM_SPOP(chunk);
+    VM_SPOP(more);
+    VM_SPOPV(head);
+
+    chunk->items[0] = head;
+    ls->chunk = chunk;
+    ls->length = 1;
+    ls->more = more;
+    ls->realized = true;
+
+    return ls;
+}
+
+/* O(1) like listobj_rest, ls must be realized */
+Value lazyseqobj_rest(VM* vm, LazySeqObj* ls)
+{
+    if (ls->length > 1)
+    {
+        VM_SPUSH(ls);
+        LazySeqObj* rest = lazyseqobj_new(vm, LAZY_WALK, value_nil(), value_nil());
+        VM_SPOP(ls);
+
+        rest->chunk = ls->chunk;
+        rest->offset = ls->offset + 1;
+        rest->length = ls->length - 1;
+        rest->more = ls->more;
+        rest->realized = true;
+        return value_obj(rest);
+    }
+
+    if (ls->more != NULL)
+        return value_obj(ls->more);
+
+    return value_listWithEmpty(vm);
+}
+
+/* at most max items of src from index on, realizes a lazy src */
+bool value_nextRun(VM* vm, Value src, int index, int max, SeqRun* run, ExceptionObj** exception)
+{
+    run->count = 0;
+    run->chunk = NULL;
+    run->rest = value_nil();
+    run->restIndex = 0;
+
+    if (value_isVector(src) || value_isSlice(src))
+    {
+        // a slice reads the leaves of the vector it views
+        VectorObj* vo = value_isSlice(src) ? value_asSlice(src)->vec : value_asVector(src);
+        int start = value_isSlice(src) ? value_asSlice(src)->start : 0;
+        int count = value_isSlice(src) ? value_asSlice(src)->count : vo->count;
+        if (index >= count)
+            return true;
+
+        VecNode* leaf = leafFor(vo, start + index);
+        int at = (start + index) & VEC_NODE_MASK;
+        int left = leaf->count - at < count - index ? leaf->count - at : count - index;
+        run->items = leaf->slots + at;
+        run->count = left < max ? left : max;
+
+        if (index + run->count < count)
+        {
+            run->rest = src;
+            run->restIndex = index + run->count;
+        }
+        return true;
+    }
+
+    ListObj* chunk;
+    int offset, length;
+    Obj* more;
+
+    if (value_isList(src))
+    {
+        ListObj* l = value_asList(src);
+        chunk = l->chunk;
+        offset = l->offset;
+        length = l->length;
+        more = (Obj*)l->more;
+    }
+    else if (value_isLazySeq(src))
+    {
+        LazySeqObj* ls = value_asLazySeq(src);
+        if (!lazyseqobj_realize(vm, ls, exception))
+            return false;
+
+        chunk = ls->chunk;
+        offset = ls->offset;
+        length = ls->length;
+        more = ls->more;
+    }
+    else
+    {
+        return true;
+    }
+
+    if (index >= length)
+        return true;
+
+    run->chunk = chunk;
+    run->offset = offset + index;
+    run->items = chunk->items + run->offset;
+    run->count = length - index < max ? length - index : max;
+
+    if (index + run->count < length)
+    {
+        run->rest = src;
+        run->restIndex = index + run->count;
+    }
+    else if (more != NULL)
+    {
+        run->rest = value_obj(more);
+    }
+
+    return true;
+}
+
+/* the seq after run, n items left to take (-1 for all) */
+static Obj* nextStep(VM* vm, LazySeqObj* ls, SeqRun* run, int n)
+{
+    if (value_isNil(run->rest) || n == 0)
+        return NULL;
+
+    // the rest of a list or lazy seq needs no step of its own
+    if (ls->kind == LAZY_WALK && n < 0 && run->restIndex == 0 && !value_isVector(run->rest))
+        return value_asObj(run->rest);
+
+    LazySeqObj* next = lazyseqobj_new(vm, ls->kind, ls->fn, run->rest);
+    next->index = run->restIndex;
+    next->n = n;
+
+    return (Obj*)next;
+}
+
+static void finishRealize(VM* vm, LazySeqObj* ls, ListObj* chunk, int offset, int length, Obj* more)
+{
+    ls->chunk = length > 0 ? chunk : NULL;
+    ls->offset = offset;
+    ls->length = length;
+    ls->more = length > 0 ? more : NULL;
+    ls->fn = value_nil();
+    ls->src = value_nil();
+    ls->realized = true;
+
+    CWRITE_BARRIER(vm, ls);
+}
+
+static bool walkStrStep(VM* vm, LazySeqObj* ls)
+{
+    StrObj* s = value_asStr(ls->src);
+    const char* chars = strobj_chars(vm, s);
+    int left = s->length - ls->index;
+    int count = left < VEC_NODE_WIDTH ? left : VEC_NODE_WIDTH;
+
+    if (count <= 0)
+    {
+        finishRealize(vm, ls, NULL, 0, 0, NULL);
+        return true;
+    }
+
+    ListObj* chunk = allocateList(vm, count);
+    VM_SPUSH(chunk);
+
+    for (int i = 0; i < count; i++)
+        chunk->items[i] = value_str(vm, chars + ls->index + i, 1);
+
+    Obj* more = NULL;
+    if (count < left)
+    {
+        LazySeqObj* next = lazyseqobj_new(vm, LAZY_WALK, value_nil(), ls->src);
+        next->index = ls->index + count;
+        more = (Obj*)next;
+    }
+
+    VM_SPOP(chunk);
+
+    finishRealize(vm, ls, chunk, 0, count, more);
+    return true;
+}
+
+/* walk and take, runs of lists and lazy seqs are shared, not copied */
+static bool walkStep(VM* vm, LazySeqObj* ls, ExceptionObj** exception)
+{
+    if (value_isStr(ls->src))
+        return walkStrStep(vm, ls);
+
+    SeqRun run;
+    if (!value_nextRun(vm, ls->src, ls->index, ls->n < 0 ? INT_MAX : ls->n, &run, exception))
+        return false;
+
+    if (run.count == 0)
+    {
+        finishRealize(vm, ls, NULL, 0, 0, NULL);
+        return true;
+    }
+
+    ListObj* chunk = run.chunk;
+    int offset = run.offset;
+    if (chunk == NULL)
+    {
+        chunk = allocateList(vm, run.count);
+        memcpy(chunk->items, run.items, sizeof(Value) * run.count);
+        offset = 0;
+    }
+
+    VM_SPUSH(chunk);
+    Obj* more = nextStep(vm, ls, &run, ls->n < 0 ? -1 : ls->n - run.count);
+    VM_SPOP(chunk);
+
+    finishRealize(vm, ls, chunk, offset, run.count, more);
+    return true;
+}
+
+static bool thunkStep(VM* vm, LazySeqObj* ls, ExceptionObj** exception)
+{
+    Value ret = value_invoke(vm, ls->fn, 0, NULL, exception);
+    if (HAS_EXCEPTION())
+        return false;
+
+    if (!value_isNil(ret) && !value_isSeq(ret) && !value_isStr(ret))
+    {
+        THROW("RuntimeError: lazy-seq body must return a sequence");
+        return false;
+    }
+
+    // go on as a walk of what the body returned
+    ls->kind = LAZY_WALK;
+    ls->src = ret;
+    ls->index = 0;
+    ls->n = -1;
+    CWRITE_BARRIER(vm, ls);
+
+    return walkStep(vm, ls, exception);
+}
+
+static bool mapStep(VM* vm, LazySeqObj* ls, ExceptionObj** exception)
+{
+    SeqRun run;
+    if (!value_nextRun(vm, ls->src, ls->index, VEC_NODE_WIDTH, &run, exception))
+        return false;
+
+    if (run.count == 0)
+    {
+        finishRealize(vm, ls, NULL, 0, 0, NULL);
+        return true;
+    }
+
+    ListObj* chunk = allocateList(vm, run.count);
+    VM_SPUSH(chunk);
+
+    Callback cb;
+    callback_init(&cb, ls->fn);
+
+    for (int i = 0; i < run.count; i++)
+    {
+        Value item = run.items[i];
+        Value ret = callback_call(vm, &cb, 1, &item, exception);
+        if (HAS_EXCEPTION())
+        {
+            VM_SPOP(chunk);
+            return false;
+        }
+
+        chunk->items[i] = ret;
+    }
+
+    Obj* more = nextStep(vm, ls, &run, -1);
+    VM_SPOP(chunk);
+
+    finishRealize(vm, ls, chunk, 0, run.count, more);
+    return true;
+}
+
+/* skips whole runs without a match, so the result is never an empty run */
+static bool filterStep(VM* vm, LazySeqObj* ls, ExceptionObj** exception)
+{
+    ListObj* chunk = allocateList(vm, VEC_NODE_WIDTH);
+    VM_SPUSH(chunk);
+
+    Callback cb;
+    callback_init(&cb, ls->fn);
+
+    for (;;)
+    {
+        SeqRun run;
+        if (!value_nextRun(vm, ls->src, ls->index, VEC_NODE_WIDTH, &run, exception))
+            break;
+
+        if (run.count == 0)
+        {
+            VM_SPOP(chunk);
+            finishRealize(vm, ls, NULL, 0, 0, NULL);
+            return true;
+        }
+
+        int found = 0;
+        for (int i = 0; i < run.count; i++)
+        {
+            Value item = run.items[i];
+            Value ret = callback_call(vm, &cb, 1, &item, exception);
+            if (HAS_EXCEPTION())
+                break;
+
+            if (value_true(ret))
+                chunk->items[found++] = item;
+        }
+
+        if (HAS_EXCEPTION())
+            break;
+
+        if (found > 0)
+        {
+            Obj* more = nextStep(vm, ls, &run, -1);
+            VM_SPOP(chunk);
+
+            finishRealize(vm, ls, chunk, 0, found, more);
+            return true;
+        }
+
+        ls->src = run.rest;
+        ls->index = run.restIndex;
+        CWRITE_BARRIER(vm, ls);
+    }
+
+    VM_SPOP(chunk);
+    return false;
+}
+
+/* like filterStep, fn is the running copy of the xform shared by the whole seq */
+static bool xformStep(VM* vm, LazySeqObj* ls, ExceptionObj** exception)
+{
+    ListObj* chunk = allocateList(vm, VEC_NODE_WIDTH);
+    VM_SPUSH(chunk);
+
+    XformObj* xf = value_asXform(ls->fn);
+    Callback inlineCbs[XFORM_INLINE_STAGES];
+    Callback* cbs = xformobj_initCallbacks(xf, inlineCbs);
+
+    bool done = false;
+    for (;;)
+    {
+        SeqRun run;
+        if (!value_nextRun(vm, ls->src, ls->index, VEC_NODE_WIDTH, &run, exception))
+            break;
+
+        int found = 0;
+        for (int i = 0; !done && i < run.count; i++)
+        {
+            Value item = run.items[i];
+            if (xformobj_apply(vm, xf, cbs, &item, &done, exception))
+                chunk->items[found++] = item;
+            else if (HAS_EXCEPTION())
+                break;
+        }
+
+        if (HAS_EXCEPTION())
+            break;
+
+        if (found > 0 || done || run.count == 0)
+        {
+            Obj* more = done ? NULL : nextStep(vm, ls, &run, -1);
+            VM_SPOP(chunk);
+            xformobj_freeCallbacks(xf, cbs);
+
+            finishRealize(vm, ls, chunk, 0, found, more);
+            return true;
+        }
+
+        ls->src = run.rest;
+        ls->index = run.restIndex;
+        CWRITE_BARRIER(vm, ls);
+    }
+
+    VM_SPOP(chunk);
+    xformobj_freeCallbacks(xf, cbs);
+    return false;
+}
+
+static bool dropStep(VM* vm, LazySeqObj* ls, ExceptionObj** exception)
+{
+    while (ls->n > 0)
+    {
+        SeqRun run;
+        if (!value_nextRun(vm, ls->src, ls->index, ls->n, &run, exception))
+            return false;
+
+        if (run.count == 0)
+        {
+            finishRealize(vm, ls, NULL, 0, 0, NULL);
+            return true;
+        }
+
+        ls->n -= run.count;
+        ls->src = run.rest;
+        ls->index = run.restIndex;
+        CWRITE_BARRIER(vm, ls);
+    }
+
+    ls->kind = LAZY_WALK;
+    ls->n = -1;
+
+    return walkStep(vm, ls, exception);
+}
+
+static bool rangeStep(VM* vm, LazySeqObj* ls)
+{
+    int count = 0;
+    while (count < VEC_NODE_WIDTH)
+    {
+        double x = ls->start + count * ls->step;
+        if ((ls->step > 0 && x >= ls->end) || (ls->step < 0 && x <= ls->end))
+            break;
+
+        count++;
+    }
+
+    if (count == 0)
+    {
+        finishRealize(vm, ls, NULL, 0, 0, NULL);
+        return true;
+    }
+
+    ListObj* chunk = allocateList(vm, count);
+    for (int i = 0; i < count; i++)
+        chunk->items[i] = value_num(ls->start + i * ls->step);
+
+    Obj* more = NULL;
+    if (count == VEC_NODE_WIDTH)
+    {
+        VM_SPUSH(chunk);
+        more = (Obj*)lazyseqobj_newRange(vm, ls->start + count * ls->step, ls->end, ls->step);
+        VM_SPOP(chunk);
+    }
+
+    finishRealize(vm, ls, chunk, 0, count, more);
+    return true;
+}
+
+/* computes the first run of ls, a no-op once it is realized */
+bool lazyseqobj_realize(VM* vm, LazySeqObj* ls, ExceptionObj** exception)
+{
+    if (ls->realized)
+        return true;
+
+    if (ls->realizing)
+    {
+        THROW("RuntimeError: lazy seq needs itself to be realized");
+        return false;
+    }
+
+    ls->realizing = true;
+    VM_SPUSH(ls);
+
+    bool ok = false;
+    switch (ls->kind)
+    {
+    case LAZY_THUNK:  ok = thunkStep(vm, ls, exception);  break;
+    case LAZY_WALK:
+    case LAZY_TAKE:   ok = walkStep(vm, ls, exception);   break;
+    case LAZY_MAP:    ok = mapStep(vm, ls, exception);    break;
+    case LAZY_FILTER: ok = filterStep(vm, ls, exception); break;
+    case LAZY_DROP:   ok = dropStep(vm, ls, exception);   break;
+    case LAZY_RANGE:  ok = rangeStep(vm, ls);             break;
+    case LAZY_XFORM:  ok = xformStep(vm, ls, exception);  break;
+    }
+
+    VM_SPOP(ls);
+    ls->realizing = false;
+
+    return ok;
+}
+
+/* realizes all of ls, never returns for an infinite seq */
+bool lazyseqobj_force(VM* vm, LazySeqObj* ls, ExceptionObj** exception)
+{
+    for (Obj* o = (Obj*)ls; o != NULL && obj_isLazySeq(o); o = obj_asLazySeq(o)->more)
+    {
+        if (!vm_checkMemory(vm, exception) || !lazyseqobj_realize(vm, obj_asLazySeq(o), exception))
+            return false;
+    }
+
+    return true;
+}
+
+/* whether ls is realized down to its end */
+bool lazyseqobj_isRealized(LazySeqObj* ls)
+{
+    for (Obj* o = (Obj*)ls; o != NULL && obj_isLazySeq(o); o = obj_asLazySeq(o)->more)
+    {
+        if (!obj_asLazySeq(o)->realized)
+            return false;
+    }
+
+    return true;
+}
+
+/* ----- transient ----- */
+
+TransientObj* transientobj_new(VM* vm, Obj* coll)
+{
+    VM_SPUSH(coll);
+    TransientObj* transientObj = CALLOCATE_OBJ(vm, TransientObj, LLO_TRANSIENT);
+    VM_SPOP(coll);
+
+    transientObj->coll = coll;
+    return transientObj;
+}
+
+/* ----- reduced ----- */
+
+ReducedObj* reducedobj_new(VM* vm, Value val)
+{
+    VM_SPUSHV(val);
+    ReducedObj* reducedObj = CALLOCATE_OBJ(vm, ReducedObj, LLO_REDUCED);
+    VM_SPOPV(val);
+
+    reducedObj->val = val;
+    return reducedObj;
+}
+
+/* ----- record ----- */
+
+ShapeObj* shapeobj_new(VM* vm, SymbolObj* name, int count)
+{
+    VM_SPUSH(name);
+    ShapeObj* shape = (ShapeObj*)allocateObject(vm, sizeof(ShapeObj) + sizeof(Value) * count, LLO_SHAPE);
+    VM_SPOP(name);
+
+    shape->name = name;
+    shape->count = count;
+    for (int i = 0; i < count; i++)
+        shape->fields[i] = value_nil();
+
+    return shape;
+}
+
+RecordObj* recordobj_new(VM* vm, ShapeObj* shape)
+{
+    VM_SPUSH(shape);
+    RecordObj* r = (RecordObj*)allocateObject(vm, sizeof(RecordObj) + sizeof(Value) * shape->count, LLO_RECORD);
+    VM_SPOP(shape);
+
+    r->shape = shape;
+    for (int i = 0; i < shape->count; i++)
+        r->slots[i] = value_nil();
+
+    return r;
+}
+
+/**
+ * The keyword looked up keeps the shape and slot it was last found at, so a
+ * call site reading the same field of records of one type scans the fields
+ * once.
+ */
+int recordobj_slot(VM* vm, RecordObj* r, Value key)
+{
+    if (!value_isKeyword(key))
+        return -1;
+
+    KeywordObj* k = value_asKeyword(key);
+    ShapeObj* shape = r->shape;
+    if (k->cacheShape == shape)
+        return k->cacheSlot;
+
+    for (int i = 0; i < shape->count; i++)
+    {
+        if (value_asKeyword(shape->fields[i])->keyword == k->keyword)
+        {
+            k->cacheShape = shape;
+            k->cacheSlot = i;
+            CWRITE_BARRIER(vm, k);
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool recordobj_get(VM* vm, RecordObj* r, Value key, Value* value)
+{
+    int slot = recordobj_slot(vm, r, key);
+    if (slot < 0)
+        return false;
+
+    if (value)
+        *value = r->slots[slot];
+    return true;
+}
+
+RecordObj* recordobj_clone(VM* vm, RecordObj* r)
+{
+    VM_SPUSH(r);
+    RecordObj* copy = recordobj_new(vm, r->shape);
+    VM_SPOP(r);
+
+    memcpy(copy->slots, r->slots, sizeof(Value) * r->shape->count);
+    return copy;
+}
+
+MapObj* recordobj_toMap(VM* vm, RecordObj* r)
+{
+    VM_SPUSH(r);
+    MapObj* m = mapobj_new(vm, 0);
+    VM_SPUSH(m);
+
+    for (int i = 0; i < r->shape->count; i++)
+        mapobj_set(vm, m, r->shape->fields[i], r->slots[i]);
+
+    VM_SPOP(m);
+    VM_SPOP(r);
+    return m;
+}
 
 FuncObj* funcobj_new(VM* vm, FuncPtr func)
 {
@@ -1015,26 +4067,23 @@ EnvObj* envobj_new(VM* vm, EnvObj* outer)
     return envObj;
 }
 
-bool envobj_set(EnvObj* e, Value key, Value value)
+bool envobj_set(VM* vm, EnvObj* e, Value key, Value value)
 {
-    return mapobj_set(e->data, key, value);
+    return mapobj_set(vm, e->data, key, value);
 }
 
-bool envobj_get(EnvObj* e, Value key, Value* value)
+/* the key is hashed once for the whole env chain */
+bool envobj_get(VM* vm, EnvObj* e, Value key, Value* value)
 {
-    Value ret;
-    EnvObj* current = e;
+    uint32_t hash = value_hash(key);
 
-    while (!mapobj_get(current->data, key, &ret))
+    for (EnvObj* current = e; current != NULL; current = current->outer)
     {
-        current = current->outer;
-
-        if (current == NULL)
-            return false;
+        if (mapobj_getWithHash(vm, current->data, key, hash, value))
+            return true;
     }
 
-    *value = ret;
-    return true;
+    return false;
 }
 
 ClosureObj* closureobj_new(VM* vm, EnvObj* env, Value params, Value body)
@@ -1054,30 +4103,31 @@ Value closureobj_invoke(VM* vm, ClosureObj* cobj,
                         ExceptionObj** exception)
 {
     EnvObj* newEnv = envobj_new(vm, cobj->env);
-    VM_PUSH(newEnv);
+    VM_SPUSH(newEnv);
 
     // binding args
-    ValueArray* paramsArr = value_listLikeGetArr(cobj->params);
-    for (size_t i = 0; i < paramsArr->count; i++)
-    {
-        VALUE_ARR_GET_CHILD(paramsArr, i, paramValue);
+    SeqIter iter;
+    value_iterInit(cobj->params, &iter);
 
+    Value paramValue;
+    for (size_t i = 0; seqiter_next(&iter, &paramValue); i++)
+    {
         // variable arguments
         if (value_isSymbol(paramValue)
             && strobj_eq(value_asSymbol(paramValue)->symbol, "&", 1))
         {
-            array_get(paramsArr, i + 1, &paramValue);
+            seqiter_next(&iter, &paramValue);
 
             if (i < len)
             {
                 ListObj* varArgObj = listobj_newWithArr(vm,
                                                         len - i,
                                                         args + i);
-                envobj_set(newEnv, paramValue, value_obj(varArgObj));
+                envobj_set(vm, newEnv, paramValue, value_obj(varArgObj));
             }
             else
             {
-                envobj_set(newEnv, paramValue, value_nil());
+                envobj_set(vm, newEnv, paramValue, value_nil());
             }
 
             break;
@@ -1086,16 +4136,16 @@ Value closureobj_invoke(VM* vm, ClosureObj* cobj,
         if (i < len)
         {
             Value argValue = args[i];
-            envobj_set(newEnv, paramValue, argValue);
+            envobj_set(vm, newEnv, paramValue, argValue);
         }
         else
         {
-            envobj_set(newEnv, paramValue, value_nil());
+            envobj_set(vm, newEnv, paramValue, value_nil());
         }
     }
 
     Value ret = vm_eval(vm, cobj->body, newEnv, exception);
-    VM_POP(newEnv);
+    VM_SPOP(newEnv);
 
     return ret;
 }
@@ -1107,6 +4157,167 @@ ClosureObj* closureobj_clone(VM* vm, ClosureObj* other)
     return cobj;
 }
 
+void callback_init(Callback* cb, Value fn)
+{
+    cb->fn = fn;
+    cb->func = value_isFunc(fn) ? value_asFunc(fn)->func : NULL;
+    cb->closure = NULL;
+    cb->arity = 0;
+
+    if (!value_isClosure(fn))
+        return;
+
+    SeqIter iter;
+    value_iterInit(value_asClosure(fn)->params, &iter);
+
+    Value param;
+    while (seqiter_next(&iter, &param))
+    {
+        if (cb->arity == CALLBACK_MAX_PARAMS || !value_isSymbol(param)
+            || strobj_eq(value_asSymbol(param)->symbol, "&", 1))
+            return;
+
+        cb->params[cb->arity++] = param;
+    }
+
+    cb->closure = value_asClosure(fn);
+}
+
+/* like value_invoke, without looking at the fn or its params again */
+Value callback_call(VM* vm, Callback* cb, int len, Value* args, ExceptionObj** exception)
+{
+    if (cb->func == NULL && cb->closure == NULL)
+        return value_invoke(vm, cb->fn, len, args, exception);
+
+    EnvObj* currentEnv = vm->currentEnv;
+    VM_SPUSH(currentEnv);
+    Value ret;
+
+    if (cb->func != NULL)
+    {
+        ret = cb->func(vm, len, args, exception);
+    }
+    else
+    {
+        EnvObj* newEnv = envobj_new(vm, cb->closure->env);
+        VM_SPUSH(newEnv);
+
+        for (int i = 0; i < cb->arity; i++)
+            envobj_set(vm, newEnv, cb->params[i], i < len ? args[i] : value_nil());
+
+        ret = vm_eval(vm, cb->closure->body, newEnv, exception);
+        VM_SPOP(newEnv);
+    }
+
+    vm->currentEnv = currentEnv;
+    VM_SPOP(currentEnv);
+
+    return ret;
+}
+
+/* ----- xform ----- */
+
+XformObj* xformobj_new(VM* vm, int count)
+{
+    XformObj* xf = (XformObj*)allocateObject(vm, sizeof(XformObj) + sizeof(XformStage) * count, LLO_XFORM);
+    xf->count = count;
+    for (int i = 0; i < count; i++)
+    {
+        xf->stages[i].kind = XFORM_MAP;
+        xf->stages[i].fn = value_nil();
+        xf->stages[i].n = 0;
+    }
+
+    return xf;
+}
+
+/* fresh counters for one pass */
+XformObj* xformobj_running(VM* vm, XformObj* xf)
+{
+    VM_SPUSH(xf);
+    XformObj* running = xformobj_new(vm, xf->count);
+    VM_SPOP(xf);
+
+    memcpy(running->stages, xf->stages, sizeof(XformStage) * xf->count);
+    return running;
+}
+
+/* callbacks of xf's stages, in inlineCbs if they fit, else allocated till xformobj_freeCallbacks */
+Callback* xformobj_initCallbacks(XformObj* xf, Callback* inlineCbs)
+{
+    Callback* cbs = xf->count <= XFORM_INLINE_STAGES ? inlineCbs : ALLOCATE(Callback, xf->count);
+    for (int i = 0; i < xf->count; i++)
+        callback_init(&cbs[i], xf->stages[i].fn);
+
+    return cbs;
+}
+
+void xformobj_freeCallbacks(XformObj* xf, Callback* cbs)
+{
+    if (xf->count > XFORM_INLINE_STAGES)
+        FREE_ARRAY(Callback, cbs, xf->count);
+}
+
+/**
+ * runs *item through the stages of a running xf, false if a stage drops it
+ * or on exception. *done is set once no later item can get through.
+ */
+bool xformobj_apply(VM* vm, XformObj* xf, Callback* cbs, Value* item, bool* done,
+                    ExceptionObj** exception)
+{
+    for (int i = 0; i < xf->count; i++)
+    {
+        XformStage* stage = &xf->stages[i];
+        switch (stage->kind)
+        {
+        case XFORM_MAP:
+        case XFORM_FILTER:
+        {
+            VM_SPUSHV(*item);
+            Value ret = callback_call(vm, &cbs[i], 1, item, exception);
+            VM_SPOPV(*item);
+
+            if (HAS_EXCEPTION())
+                return false;
+
+            if (stage->kind == XFORM_MAP)
+                *item = ret;
+            else if (!value_true(ret))
+                return false;
+
+            break;
+        }
+
+        case XFORM_TAKE:
+        {
+            if (stage->n <= 0)
+            {
+                *done = true;
+                return false;
+            }
+
+            if (--stage->n == 0)
+                *done = true;
+
+            break;
+        }
+
+        case XFORM_DROP:
+        {
+            if (stage->n > 0)
+            {
+                stage->n--;
+                return false;
+            }
+
+            break;
+        }
+        }
+    }
+
+    return true;
+}
+
 AtomObj* atomobj_new(VM* vm, Value ref)
 {
     AtomObj* aobj = CALLOCATE_OBJ(vm, AtomObj, LLO_ATOM);
@@ -1132,35 +4343,225 @@ ExceptionObj* exceptionobj_new(VM* vm, const char* fmt, ...)
     return eobj;
 }
 
-ValueArray* obj_listLikeGetArr(Obj* obj)
+/* realizes every lazy seq reachable from v through seqs, maps, sets, sorted colls and records */
+bool value_realize(VM* vm, Value v, ExceptionObj** exception)
 {
-    if (obj_isList(obj))
+    if (value_isLazySeq(v) && !lazyseqobj_force(vm, value_asLazySeq(v), exception))
+        return false;
+
+    // a pure hash vouches there is no lazy seq left inside
+    if (value_isObj(v) && (value_asObj(v)->hash & HASH_PURE) && hashedByValue(value_asObj(v)))
+        return true;
+
+    if (value_isSeq(v))
     {
-        return &obj_asList(obj)->items;
+        SeqIter iter;
+        value_iterInit(v, &iter);
+
+        Value item;
+        while (seqiter_next(&iter, &item))
+        {
+            if (!value_realize(vm, item, exception))
+                return false;
+        }
+    }
+    else if (value_isMap(v) || value_isSet(v))
+    {
+        // a set maps each item to itself
+        bool isSet = value_isSet(v);
+        MapIter iter;
+        mapobj_iterInit(isSet ? value_asSet(v)->map : value_asMap(v), &iter);
+
+        Value key, value;
+        while (mapobj_iterNext(&iter, &key, &value))
+        {
+            if (!value_realize(vm, key, exception) || (!isSet && !value_realize(vm, value, exception)))
+                return false;
+        }
     }
-    else if (obj_isVector(obj))
+    else if (value_isSorted(v))
     {
-        return &obj_asVector(obj)->items;
+        SortedObj* so = value_asSorted(v);
+        SortedIter iter;
+        sortediter_init(so, &iter, false);
+
+        Value key, value;
+        while (sortediter_next(&iter, &key, &value))
+        {
+            if (!value_realize(vm, key, exception) || (!so->isSet && !value_realize(vm, value, exception)))
+                return false;
+        }
     }
-    else
+    else if (value_isRecord(v))
     {
-        // RLOG_ERROR("RuntimeError: get array failed! obj is not a list or vector");
-        return NULL;
+        RecordObj* r = value_asRecord(v);
+        for (int i = 0; i < r->shape->count; i++)
+        {
+            if (!value_realize(vm, r->slots[i], exception))
+                return false;
+        }
     }
+
+    return true;
 }
 
-ValueArray* value_listLikeGetArr(Value v)
+/* of a lazy seq only the realized items count */
+int value_listLikeCount(Value v)
 {
-    if (value_isObj(v))
-        return obj_listLikeGetArr(value_asObj(v));
-    else
-        return NULL;
+    if (value_isList(v))
+        return value_asList(v)->count;
+
+    if (value_isVector(v))
+        return value_asVector(v)->count;
+
+    if (value_isSlice(v))
+        return value_asSlice(v)->count;
+
+    if (value_isLazySeq(v))
+    {
+        int count = 0;
+        for (Obj* o = value_asObj(v); o != NULL; o = obj_asLazySeq(o)->more)
+        {
+            if (obj_isList(o))
+                return count + obj_asList(o)->count;
+
+            if (!obj_asLazySeq(o)->realized)
+                break;
+
+            count += obj_asLazySeq(o)->length;
+        }
+
+        return count;
+    }
+
+    return 0;
+}
+
+bool value_listLikeGet(Value v, int index, Value* out)
+{
+    if (value_isList(v))
+        return listobj_get(value_asList(v), index, out);
+
+    if (value_isVector(v))
+        return vectorobj_get(value_asVector(v), index, out);
+
+    if (value_isSlice(v))
+    {
+        SliceObj* s = value_asSlice(v);
+        return index >= 0 && index < s->count && vectorobj_get(s->vec, s->start + index, out);
+    }
+
+    if (value_isLazySeq(v) && index >= 0)
+    {
+        for (Obj* o = value_asObj(v); o != NULL; o = obj_asLazySeq(o)->more)
+        {
+            if (obj_isList(o))
+                return listobj_get(obj_asList(o), index, out);
+
+            LazySeqObj* ls = obj_asLazySeq(o);
+            if (!ls->realized)
+                break;
+
+            if (index < ls->length)
+            {
+                *out = ls->chunk->items[ls->offset + index];
+                return true;
+            }
+
+            index -= ls->length;
+        }
+    }
+
+    return false;
+}
+
+/* v must stay alive while iterating, walks the realized part of a lazy seq */
+void value_iterInit(Value v, SeqIter* iter)
+{
+    iter->obj = value_isSeq(v) ? value_asObj(v) : NULL;
+    iter->index = 0;
+    iter->count = value_listLikeCount(v);
+    iter->chunk = NULL;
+    iter->chunkLeft = 0;
+}
+
+bool seqiter_next(SeqIter* iter, Value* v)
+{
+    while (iter->chunkLeft == 0)
+    {
+        if (iter->index >= iter->count)
+            return false;
+
+        if (obj_isList(iter->obj))
+        {
+            // one step per run of shared items
+            ListObj* l = obj_asList(iter->obj);
+            iter->chunk = listobj_items(l);
+            iter->chunkLeft = l->length;
+            iter->obj = (Obj*)l->more;
+        }
+        else if (obj_isLazySeq(iter->obj))
+        {
+            LazySeqObj* ls = obj_asLazySeq(iter->obj);
+            iter->chunk = ls->chunk ? ls->chunk->items + ls->offset : NULL;
+            iter->chunkLeft = ls->length;
+            iter->obj = ls->more;
+        }
+        else if (obj_isSlice(iter->obj))
+        {
+            SliceObj* s = obj_asSlice(iter->obj);
+            int at = s->start + iter->index;
+            VecNode* leaf = leafFor(s->vec, at);
+            iter->chunk = leaf->slots + (at & VEC_NODE_MASK);
+            iter->chunkLeft = leaf->count - (at & VEC_NODE_MASK);
+            if (iter->chunkLeft > iter->count - iter->index)
+                iter->chunkLeft = iter->count - iter->index;
+        }
+        else
+        {
+            VecNode* leaf = leafFor(obj_asVector(iter->obj), iter->index);
+            iter->chunk = leaf->slots;
+            iter->chunkLeft = leaf->count;
+        }
+
+        iter->index += iter->chunkLeft;
+    }
+
+    *v = *iter->chunk++;
+    iter->chunkLeft--;
+    return true;
+}
+
+/* (:key coll) and (:key coll default) look key up in a map or record */
+static Value keywordobj_invoke(VM* vm, KeywordObj* k, int len, Value* args, ExceptionObj** exception)
+{
+    if (len < 1 || len > 2)
+    {
+        THROW("RuntimeError: keyword call needs a map and an optional default");
+        return value_none();
+    }
+
+    Value ret;
+    Value coll = args[0];
+    if (value_isRecord(coll) && recordobj_get(vm, value_asRecord(coll), value_obj(k), &ret))
+        return ret;
+
+    if (value_isMap(coll) && mapobj_get(vm, value_asMap(coll), value_obj(k), &ret))
+        return ret;
+
+    if (value_isSortedMap(coll) && sortedobj_get(vm, value_asSorted(coll), value_obj(k), &ret, exception))
+        return ret;
+
+    if (HAS_EXCEPTION())
+        return value_none();
+
+    return len == 2 ? args[1] : value_nil();
 }
 
 Value obj_invoke(VM* vm, Obj* obj, int len, Value* args, ExceptionObj** exception)
 {
     EnvObj* currentEnv = vm->currentEnv;
-    VM_PUSH(currentEnv);
+    VM_SPUSH(currentEnv);
     Value ret;
 
     if (obj_isFunc(obj))
@@ -1173,13 +4574,17 @@ Value obj_invoke(VM* vm, Obj* obj, int len, Value* args, ExceptionObj** exceptio
         ClosureObj* cobj = obj_asClosure(obj);
         ret = closureobj_invoke(vm, cobj, len, args, exception);
     }
+    else if (obj_isKeyword(obj))
+    {
+        ret = keywordobj_invoke(vm, obj_asKeyword(obj), len, args, exception);
+    }
     else
     {
         ret = value_none();
     }
 
     vm->currentEnv = currentEnv;
-    VM_POP(currentEnv);
+    VM_SPOP(currentEnv);
 
     return ret;
 }
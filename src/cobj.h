@@ -18,26 +18,35 @@ extern EscapeData escapeCharDatas[ESCAPE_DATA_LEN];
 
 typedef enum
 {
-    LLO_STRING    = 3,
-    LLO_LIST      = 4,
-    LLO_SYMBOL    = 5,
-    LLO_KEYWORD   = 6,
-    LLO_VECTOR    = 7,
-    LLO_MAP       = 8,
-    LLO_FUNCTION  = 9,
-    LLO_ENV       = 10,
-    LLO_CLOSURE   = 11,
-    LLO_ATOM      = 12,
-    LLO_EXCEPTION = 13,
+    LLO_STRING     = 3,
+    LLO_LIST       = 4,
+    LLO_SYMBOL     = 5,
+    LLO_KEYWORD    = 6,
+    LLO_VECTOR     = 7,
+    LLO_MAP        = 8,
+    LLO_FUNCTION   = 9,
+    LLO_ENV        = 10,
+    LLO_CLOSURE    = 11,
+    LLO_ATOM       = 12,
+    LLO_EXCEPTION  = 13,
+    LLO_MAP_NODE   = 14, // internal node of a MapObj, never a value
+    LLO_VEC_NODE   = 15, // internal node of a VectorObj, never a value
+    LLO_LAZY_SEQ   = 17,
+    LLO_TRANSIENT  = 18,
+    LLO_REDUCED    = 19,
+    LLO_XFORM      = 20,
+    LLO_SHAPE      = 21, // field layout of a record type
+    LLO_RECORD     = 22,
+    LLO_SET        = 23,
+    LLO_SORTED     = 24,
+    LLO_SORTED_NODE = 25, // internal node of a SortedObj, never a value
+    LLO_SLICE      = 26,
 } ObjType;
 
 struct sObj
 {
     ObjType  type;
-    bool     isMarked;
     uint32_t hash;
-
-    struct sObj* next;
 };
 
 typedef struct sMetaObj
@@ -46,52 +55,322 @@ typedef struct sMetaObj
     Value meta;
 } MetaObj;
 
+/**
+ * A flat string holds its chars inline, '\0' ended. A rope is the
+ * concatenation of left and right until something needs its chars
+ * contiguous, see strobj_chars. A view borrows length chars at offset in
+ * the flat string left, so they need not end in '\0'. Only strobj_intern
+ * puts strings in vm->strings, the rest hash on first use.
+ */
 typedef struct sStrObj
 {
-    Obj   base;
-    int   length;
-    char* chars;
+    Obj             base;
+    int             length;
+    int             depth;  // ropes only
+    int             offset; // views only
+    struct sStrObj* left;
+    struct sStrObj* right;
+    char            chars[];
 } StrObj;
 
+/**
+ * A list is a run of length items of a chunk followed by the list more.
+ * The chunk is a list holding its items inline: a freshly built list is its
+ * own chunk (one allocation), cons puts a one item list in front of the list
+ * it extends, rest views the same chunk from offset + 1; neither copies
+ * items. Only a list that is its own chunk has items, exactly length of them.
+ */
 typedef struct sListObj
 {
-    Obj        base;
-    Value      meta;
-    ValueArray items;
+    Obj              base;
+    Value            meta;
+    int              count;  // items of the whole list
+    int              length; // items taken from chunk
+    int              offset;
+    struct sListObj* chunk;  // NULL for ()
+    struct sListObj* more;   // NULL at the end, never an empty list
+    Value            items[];
 } ListObj;
 
+#define listobj_ownsItems(l) ((l)->chunk == (l))
+
 typedef struct sSymbolObj
 {
     Obj     base;
     StrObj* symbol;
 } SymbolObj;
 
+/**
+ * Keyword. Each occurrence in read code is its own object, so it remembers
+ * where it last found its field in a record (a call site cache): the slot of
+ * it in cacheShape.
+ */
 typedef struct sKeywordObj
 {
-    Obj     base;
-    StrObj* keyword;
+    Obj               base;
+    StrObj*           keyword;
+    struct sShapeObj* cacheShape; // NULL until looked up in a record
+    int               cacheSlot;
 } KeywordObj;
 
+#define VEC_NODE_BITS  5
+#define VEC_NODE_WIDTH (1 << VEC_NODE_BITS)
+#define VEC_NODE_MASK  (VEC_NODE_WIDTH - 1)
+
+/**
+ * Node of the trie behind VectorObj. Leaves hold items, inner nodes hold
+ * their children as obj values. A node is never changed after the vector
+ * it was built for is handed out, except by the transient vector whose edit
+ * token it carries; such nodes have room for VEC_NODE_WIDTH slots.
+ */
+typedef struct sVecNode
+{
+    Obj      base;
+    int      count;
+    uint64_t edit;
+    Value    slots[];
+} VecNode;
+
+/**
+ * Persistent vector: a 32-way trie of full leaves plus a tail of up to 32
+ * items. conj copies the tail only, nth and assoc walk shift / 5 levels.
+ */
 typedef struct sVectorObj
 {
-    Obj        base;
-    Value      meta;
-    ValueArray items;
+    Obj      base;
+    Value    meta;
+    int      count;
+    int      shift; // index bits consumed above the leaves
+    uint64_t edit;  // 0 unless transient
+    VecNode* root;  // NULL while all items fit in the tail
+    VecNode* tail;  // NULL for an empty vector
 } VectorObj;
 
-typedef struct sMapObjEntry
+/**
+ * count items of vec from start on, viewed in place: a subvec, or the seq
+ * rest and seq give of a vector, which prints and compares as a list. It
+ * keeps all of vec alive.
+ */
+typedef struct sSliceObj
 {
-    Value      key;
-    Value      value;
-} MapObjEntry;
-
+    Obj        base;
+    Value      meta;
+    VectorObj* vec;
+    int        start;
+    int        count;
+    bool       isVector; // subvec, else a seq
+} SliceObj;
+
+#define MAP_NODE_BITS  5
+#define MAP_NODE_WIDTH (1 << MAP_NODE_BITS)
+#define MAP_MAX_DEPTH  8 // 7 levels use up the 32 bit hash, then a collision node
+#define MAP_FLAT_MAX   8 // pairs a map keeps in a flat root before it becomes a trie
+
+/**
+ * Node of the hash array mapped trie behind MapObj. The key value pairs which
+ * live in this node come first in slots (ordered by dataMap), child nodes
+ * follow (ordered by nodeMap). Keys whose whole hash collides end up in a
+ * collision node, a plain list of pairs. A map of at most MAP_FLAT_MAX pairs
+ * is a collision node at the root, scanned without hashing keys.
+ */
+typedef struct sMapNode
+{
+    Obj      base;
+    uint32_t dataMap;        // hash fragments of the inline pairs
+    uint32_t nodeMap;        // hash fragments of the child nodes
+    uint64_t edit;           // a map with this edit token may change the node in place
+    uint16_t capacity;       // slots allocated
+    uint16_t collisionCount; // pairs of a collision node
+    bool     collision;
+    Value    slots[];
+} MapNode;
+
+/**
+ * Persistent map. Maps share nodes, a node is only changed in place by the
+ * map whose edit token it carries (maps being built, env maps); sharing a
+ * map's nodes gives the map a new token.
+ */
 typedef struct sMapObj
 {
     Obj        base;
     Value      meta;
-    Table      table;
+    int        count;
+    uint64_t   edit;
+    MapNode*   root;  // NULL for an empty map
 } MapObj;
 
+/* persistent set: a map of each item to itself, hashed and compared as map keys */
+typedef struct sSetObj
+{
+    Obj     base;
+    Value   meta;
+    MapObj* map;
+} SetObj;
+
+#define SORTED_NODE_MAX  15 // keys of a full node, one more splits it in two
+#define SORTED_NODE_MIN  7  // keys of any node but the root
+#define SORTED_MAX_DEPTH 16
+
+/**
+ * Node of the B-tree behind SortedObj: count keys in order, then their values
+ * if the tree is a map, then count + 1 children unless it is a leaf. Nodes are
+ * never changed, an edit copies the path from the root to the keys it touches.
+ */
+typedef struct sSortedNode
+{
+    Obj      base;
+    uint16_t count;
+    bool     leaf;
+    bool     hasVals;
+    Value    slots[];
+} SortedNode;
+
+/* persistent sorted map or set, ordered by cmp or by value_compare if cmp is nil */
+typedef struct sSortedObj
+{
+    Obj         base;
+    Value       meta;
+    int         count;
+    bool        isSet;
+    Value       cmp;
+    SortedNode* root; // NULL for an empty one
+} SortedObj;
+
+/* in order walk, from the first or last key or from where sortediter_seek put it */
+typedef struct sSortedIter
+{
+    SortedNode* nodes[SORTED_MAX_DEPTH];
+    int         index[SORTED_MAX_DEPTH]; // next key forward, one past it in reverse
+    int         depth;
+    bool        reverse;
+} SortedIter;
+
+typedef struct sMapIter
+{
+    MapNode* nodes[MAP_MAX_DEPTH];
+    int      index[MAP_MAX_DEPTH]; // next pair, then next child of each level
+    int      depth;
+} MapIter;
+
+/* walks a list or a vector a leaf at a time */
+typedef struct sSeqIter
+{
+    Obj*   obj;
+    int    index; // of the first item after the current chunk
+    int    count;
+    Value* chunk;
+    int    chunkLeft;
+} SeqIter;
+
+/* items of a seq value_nextRun reads at a time */
+typedef struct sSeqRun
+{
+    Value*     items;
+    int        count;
+    ListObj*   chunk;     // items point into it, NULL for a vector
+    int        offset;
+    Value      rest;      // seq after the run, nil at the end
+    int        restIndex;
+} SeqRun;
+
+typedef enum
+{
+    LAZY_THUNK,  // seq of what fn returns
+    LAZY_WALK,   // src from index on
+    LAZY_MAP,
+    LAZY_FILTER,
+    LAZY_TAKE,
+    LAZY_DROP,
+    LAZY_RANGE,
+    LAZY_XFORM,  // src run through the transducer fn
+} LazyKind;
+
+/**
+ * Seq whose items are computed when first needed. Realizing runs one step of
+ * kind, which yields a run of at most VEC_NODE_WIDTH items (length items of
+ * chunk from offset) followed by the seq more, like a list. A realized lazy
+ * seq has length 0 only if it is empty. Steps read src from index, a position
+ * in the first run of a list or lazy src, or in a vector or string.
+ */
+typedef struct sLazySeqObj
+{
+    Obj        base;
+    LazyKind   kind;
+    bool       realized;
+    bool       realizing;
+    int        index;
+    int        n;     // items left to take or drop
+    Value      fn;    // thunk, fn of map and filter
+    Value      src;
+    double     start; // range
+    double     end;
+    double     step;
+    ListObj*   chunk; // NULL while unrealized or empty
+    int        offset;
+    int        length;
+    Obj*       more;  // list or lazy seq after the run, NULL at the end
+} LazySeqObj;
+
+/* mutable builder of a vector or map, persistent! hands out coll and ends it */
+typedef struct sTransientObj
+{
+    Obj  base;
+    Obj* coll; // NULL after persistent!
+} TransientObj;
+
+#define XFORM_INLINE_STAGES 16 // callbacks of up to this many stages live on the c stack
+
+typedef enum
+{
+    XFORM_MAP,
+    XFORM_FILTER,
+    XFORM_TAKE,
+    XFORM_DROP,
+} XformKind;
+
+typedef struct
+{
+    XformKind kind;
+    Value     fn; // map and filter
+    int       n;  // take and drop, counted down by a running copy
+} XformStage;
+
+/**
+ * Transducer: stages each item goes through in order, all in one pass. comp
+ * joins the stages of several. A running copy (xformobj_running) holds the
+ * state of one pass, the xform itself is never changed.
+ */
+typedef struct sXformObj
+{
+    Obj        base;
+    int        count;
+    XformStage stages[];
+} XformObj;
+
+/* wraps the result of a reducing fn to end the reduce early */
+typedef struct sReducedObj
+{
+    Obj   base;
+    Value val;
+} ReducedObj;
+
+/* field keywords of a record type, shared by all its records */
+typedef struct sShapeObj
+{
+    Obj        base;
+    SymbolObj* name;
+    int        count;
+    Value      fields[];
+} ShapeObj;
+
+/* map with the fixed keys of its shape, the values sit in slots in field order */
+typedef struct sRecordObj
+{
+    Obj       base;
+    ShapeObj* shape;
+    Value     slots[];
+} RecordObj;
+
 typedef struct sFuncObj
 {
     Obj        base;
@@ -116,6 +395,22 @@ typedef struct sClosureObj
     bool            isMacro;
 } ClosureObj;
 
+#define CALLBACK_MAX_PARAMS 4
+
+/**
+ * A fn resolved once to be called many times from C. A closure whose params
+ * are at most CALLBACK_MAX_PARAMS plain symbols has them bound straight from
+ * params, other fns go through value_invoke. fn must stay rooted by the caller.
+ */
+typedef struct sCallback
+{
+    Value       fn;
+    FuncPtr     func;    // builtin, NULL otherwise
+    ClosureObj* closure; // closure with plain params, NULL otherwise
+    int         arity;
+    Value       params[CALLBACK_MAX_PARAMS];
+} Callback;
+
 typedef struct sAtomObj
 {
     Obj             base;
@@ -134,6 +429,18 @@ struct sExceptionObj
 #define obj_asKeyword(o)   ((KeywordObj*)o)
 #define obj_asVector(o)    ((VectorObj*)o)
 #define obj_asMap(o)       ((MapObj*)o)
+#define obj_asSet(o)       ((SetObj*)o)
+#define obj_asSorted(o)    ((SortedObj*)o)
+#define obj_asSlice(o)     ((SliceObj*)o)
+#define obj_asSortedNode(o) ((SortedNode*)o)
+#define obj_asMapNode(o)   ((MapNode*)o)
+#define obj_asVecNode(o)   ((VecNode*)o)
+#define obj_asLazySeq(o)   ((LazySeqObj*)o)
+#define obj_asTransient(o) ((TransientObj*)o)
+#define obj_asReduced(o)   ((ReducedObj*)o)
+#define obj_asXform(o)     ((XformObj*)o)
+#define obj_asShape(o)     ((ShapeObj*)o)
+#define obj_asRecord(o)    ((RecordObj*)o)
 #define obj_asFunc(o)      ((FuncObj*)o)
 #define obj_asEnv(o)       ((EnvObj*)o)
 #define obj_asClosure(o)   ((ClosureObj*)o)
@@ -142,11 +449,27 @@ struct sExceptionObj
 
 #define _obj_is(o, objType) ((o)->type == (objType))
 #define obj_isStr(o)       _obj_is(o, LLO_STRING)
+#define strobj_isRope(s)   ((s)->right != NULL)
+#define strobj_isView(s)   ((s)->left != NULL && (s)->right == NULL)
+#define strobj_leafChars(s) \
+    ((s)->left ? (s)->left->chars + (s)->offset : (s)->chars) // flat strings and views
 #define obj_isList(o)      _obj_is(o, LLO_LIST)
 #define obj_isSymbol(o)    _obj_is(o, LLO_SYMBOL)
 #define obj_isKeyword(o)   _obj_is(o, LLO_KEYWORD)
 #define obj_isVector(o)    _obj_is(o, LLO_VECTOR)
 #define obj_isMap(o)       _obj_is(o, LLO_MAP)
+#define obj_isSet(o)       _obj_is(o, LLO_SET)
+#define obj_isSorted(o)    _obj_is(o, LLO_SORTED)
+#define obj_isSlice(o)     _obj_is(o, LLO_SLICE)
+#define obj_isSortedNode(o) _obj_is(o, LLO_SORTED_NODE)
+#define obj_isMapNode(o)   _obj_is(o, LLO_MAP_NODE)
+#define obj_isVecNode(o)   _obj_is(o, LLO_VEC_NODE)
+#define obj_isLazySeq(o)   _obj_is(o, LLO_LAZY_SEQ)
+#define obj_isTransient(o) _obj_is(o, LLO_TRANSIENT)
+#define obj_isReduced(o)   _obj_is(o, LLO_REDUCED)
+#define obj_isXform(o)     _obj_is(o, LLO_XFORM)
+#define obj_isShape(o)     _obj_is(o, LLO_SHAPE)
+#define obj_isRecord(o)    _obj_is(o, LLO_RECORD)
 #define obj_isFunc(o)      _obj_is(o, LLO_FUNCTION)
 #define obj_isEnv(o)       _obj_is(o, LLO_ENV)
 #define obj_isClosure(o)   _obj_is(o, LLO_CLOSURE)
@@ -160,10 +483,19 @@ struct sExceptionObj
 #define value_asKeyword(v)   _value_asObjType(v, obj_asKeyword)
 #define value_asVector(v)    _value_asObjType(v, obj_asVector)
 #define value_asMap(v)       _value_asObjType(v, obj_asMap)
+#define value_asSet(v)       _value_asObjType(v, obj_asSet)
+#define value_asSorted(v)    _value_asObjType(v, obj_asSorted)
+#define value_asSlice(v)     _value_asObjType(v, obj_asSlice)
 #define value_asFunc(v)      _value_asObjType(v, obj_asFunc)
 #define value_asClosure(v)   _value_asObjType(v, obj_asClosure)
 #define value_asAtom(v)      _value_asObjType(v, obj_asAtom)
 #define value_asException(v) _value_asObjType(v, obj_asException)
+#define value_asLazySeq(v)   _value_asObjType(v, obj_asLazySeq)
+#define value_asTransient(v) _value_asObjType(v, obj_asTransient)
+#define value_asReduced(v)   _value_asObjType(v, obj_asReduced)
+#define value_asXform(v)     _value_asObjType(v, obj_asXform)
+#define value_asShape(v)     _value_asObjType(v, obj_asShape)
+#define value_asRecord(v)    _value_asObjType(v, obj_asRecord)
 
 #define _value_isObjType(v, f) (value_isObj(v) && f(value_asObj(v)))
 #define value_isStr(v)       _value_isObjType(v, obj_isStr)
@@ -172,15 +504,29 @@ struct sExceptionObj
 #define value_isKeyword(v)   _value_isObjType(v, obj_isKeyword)
 #define value_isVector(v)    _value_isObjType(v, obj_isVector)
 #define value_isMap(v)       _value_isObjType(v, obj_isMap)
+#define value_isSet(v)       _value_isObjType(v, obj_isSet)
+#define value_isSorted(v)    _value_isObjType(v, obj_isSorted)
+#define value_isSortedMap(v) (value_isSorted(v) && !value_asSorted(v)->isSet)
+#define value_isSortedSet(v) (value_isSorted(v) && value_asSorted(v)->isSet)
+#define value_isSlice(v)     _value_isObjType(v, obj_isSlice)
+#define value_isSubvec(v)    (value_isSlice(v) && value_asSlice(v)->isVector)
 #define value_isFunc(v)      _value_isObjType(v, obj_isFunc)
 #define value_isClosure(v)   _value_isObjType(v, obj_isClosure)
 #define value_isAtom(v)      _value_isObjType(v, obj_isAtom)
 #define value_isException(v) _value_isObjType(v, obj_isException)
+#define value_isLazySeq(v)   _value_isObjType(v, obj_isLazySeq)
+#define value_isTransient(v) _value_isObjType(v, obj_isTransient)
+#define value_isReduced(v)   _value_isObjType(v, obj_isReduced)
+#define value_isXform(v)     _value_isObjType(v, obj_isXform)
+#define value_isShape(v)     _value_isObjType(v, obj_isShape)
+#define value_isRecord(v)    _value_isObjType(v, obj_isRecord)
 
 #define obj_hasMeta(o) \
-    (obj_isList((o)) || obj_isVector((o)) || obj_isMap((o)) || obj_isFunc((o)) || obj_isClosure((o)))
+    (obj_isList((o)) || obj_isVector((o)) || obj_isSlice((o)) || obj_isMap((o)) || obj_isSet((o)) || obj_isSorted((o)) || obj_isFunc((o)) || obj_isClosure((o)))
 
-#define value_isListLike(v) (value_isList(v) || value_isVector(v))
+#define value_isListLike(v) (value_isList(v) || value_isVector(v) || value_isSlice(v))
+#define value_isVectorLike(v) (value_isVector(v) || value_isSubvec(v))
+#define value_isSeq(v)      (value_isListLike(v) || value_isLazySeq(v))
 #define value_isMacro(v)    (value_isClosure(v) && (value_asClosure(v)->isMacro))
 #define value_isCallable(v) (value_isClosure(v) || value_isFunc(v))
 #define value_hasMeta(v)    (value_isObj((v)) && obj_hasMeta((value_asObj((v)))))
@@ -193,15 +539,28 @@ bool     obj_eq(VM* vm, Obj* a, Obj* b);
 void     obj_print(Obj* o);
 
 /* ----- str ----- */
-StrObj*  strobj_new(VM* vm, const char* chars, int length);
+StrObj*  strobj_new(VM* vm, int length); // flat, chars to be filled in by the caller
 StrObj*  strobj_copy(VM* vm, const char* chars, int length);
+StrObj*  strobj_intern(VM* vm, const char* chars, int length);
+StrObj*  strobj_internStr(VM* vm, StrObj* o);
+StrObj*  strobj_concat(VM* vm, StrObj* a, StrObj* b);
+StrObj*  strobj_sub(VM* vm, StrObj* o, int start, int length);
+char*    strobj_chars(VM* vm, StrObj* o); // flattens a rope in place
+char*    strobj_cstr(VM* vm, StrObj* o);  // as strobj_chars, '\0' ended
 uint32_t strobj_hash(StrObj* o);
 bool     strobj_eq(StrObj* o, const char* chars, int length);
+int      strobj_compare(StrObj* a, StrObj* b);
+int      strobj_indexOf(VM* vm, StrObj* o, StrObj* part, int from); // -1 if not found
 
 /* ----- list ----- */
 ListObj* listobj_new(VM* vm, int len, ...);
 ListObj* listobj_newWithNil(VM* vm, int len);
 ListObj* listobj_newWithArr(VM* vm, int len, Value* arr);
+ListObj* listobj_newWithListLike(VM* vm, Value v, int start);
+ListObj* listobj_cons(VM* vm, Value head, ListObj* rest);
+ListObj* listobj_rest(VM* vm, ListObj* l);
+ListObj* listobj_contiguous(VM* vm, ListObj* l);
+Value*   listobj_items(ListObj* l);
 bool     listobj_set(ListObj* l, int index, Value v);
 bool     listobj_get(ListObj* l, int index, Value* v);
 
@@ -217,16 +576,78 @@ KeywordObj* keywordobj_newWithStr(VM* vm, StrObj* strObj);
 VectorObj* vectorobj_new(VM* vm, int len, ...);
 VectorObj* vectorobj_newWithNil(VM* vm, int len);
 VectorObj* vectorobj_newWithArr(VM* vm, int len, Value* arr);
-bool       vectorobj_set(VectorObj* vo, int index, Value v);
+bool       vectorobj_set(VectorObj* vo, int index, Value v); // in place, only while building vo
 bool       vectorobj_get(VectorObj* vo, int index, Value* v);
+VectorObj* vectorobj_conj(VM* vm, VectorObj* vo, Value v);
+VectorObj* vectorobj_assoc(VM* vm, VectorObj* vo, int index, Value v);
+VectorObj* vectorobj_transient(VM* vm, VectorObj* vo);
+void       vectorobj_persistent(VectorObj* vo);
+void       vectorobj_conjInPlace(VM* vm, VectorObj* vo, Value v);             // vo transient
+void       vectorobj_assocInPlace(VM* vm, VectorObj* vo, int index, Value v); // vo transient
+
+/* ----- slice ----- */
+SliceObj*  sliceobj_new(VM* vm, Value coll, int start, int count, bool isVector); // coll a vector or slice
+SliceObj*  sliceobj_assoc(VM* vm, SliceObj* s, int index, Value v);            // index up to count
+VectorObj* sliceobj_toVector(VM* vm, SliceObj* s);
 
 /* ----- map ----- */
 MapObj* mapobj_new(VM* vm, int len, ...);
 MapObj* mapobj_newWithArr(VM* vm, int len, Value* arr);
 MapObj* mapobj_clone(VM* vm, MapObj* other);
-bool    mapobj_set(MapObj* m, Value key, Value value);
-bool    mapobj_get(MapObj* m, Value key, Value* value);
-bool    mapobj_del(MapObj* m, Value key);
+MapObj* mapobj_assoc(VM* vm, MapObj* m, Value key, Value value);
+MapObj* mapobj_dissoc(VM* vm, MapObj* m, Value key);
+bool    mapobj_set(VM* vm, MapObj* m, Value key, Value value); // in place
+bool    mapobj_get(VM* vm, MapObj* m, Value key, Value* value);
+bool    mapobj_getWithHash(VM* vm, MapObj* m, Value key, uint32_t hash, Value* value);
+bool    mapobj_del(VM* vm, MapObj* m, Value key);              // in place
+void    mapobj_iterInit(MapObj* m, MapIter* iter);
+bool    mapobj_iterNext(MapIter* iter, Value* key, Value* value);
+int     mapnode_pairCount(MapNode* n);
+int     mapnode_slotCount(MapNode* n); // pairs take two slots, children one
+
+/* ----- set ----- */
+SetObj* setobj_new(VM* vm, MapObj* map); // map is the set's from now on
+SetObj* setobj_newWithArr(VM* vm, int len, Value* arr);
+SetObj* setobj_conj(VM* vm, SetObj* s, Value v);
+SetObj* setobj_disj(VM* vm, SetObj* s, Value v);
+bool    setobj_get(VM* vm, SetObj* s, Value v, Value* item);
+
+/* ----- sorted ----- */
+SortedObj* sortedobj_new(VM* vm, bool isSet, Value cmp);
+bool       sortedobj_get(VM* vm, SortedObj* s, Value key, Value* value, ExceptionObj** exception);
+SortedObj* sortedobj_assoc(VM* vm, SortedObj* s, Value key, Value value, ExceptionObj** exception);
+SortedObj* sortedobj_dissoc(VM* vm, SortedObj* s, Value key, ExceptionObj** exception);
+int        sortednode_slotCount(SortedNode* n);
+void       sortediter_init(SortedObj* s, SortedIter* iter, bool reverse);
+bool       sortediter_seek(VM* vm, SortedObj* s, SortedIter* iter, Value key, bool inclusive, bool reverse,
+                           ExceptionObj** exception);
+bool       sortediter_next(SortedIter* iter, Value* key, Value* value);
+bool       sortedobj_compare(VM* vm, SortedObj* s, Callback* cb, Value a, Value b, int* out,
+                             ExceptionObj** exception);
+
+/* ----- lazy seq ----- */
+LazySeqObj* lazyseqobj_new(VM* vm, LazyKind kind, Value fn, Value src);
+LazySeqObj* lazyseqobj_newRange(VM* vm, double start, double end, double step);
+LazySeqObj* lazyseqobj_newOfStr(VM* vm, StrObj* s); // NULL for ""
+LazySeqObj* lazyseqobj_cons(VM* vm, Value head, Obj* more);
+Value       lazyseqobj_rest(VM* vm, LazySeqObj* ls);
+bool        lazyseqobj_realize(VM* vm, LazySeqObj* ls, ExceptionObj** exception);
+bool        lazyseqobj_force(VM* vm, LazySeqObj* ls, ExceptionObj** exception);
+bool        lazyseqobj_isRealized(LazySeqObj* ls);
+
+/* ----- transient ----- */
+TransientObj* transientobj_new(VM* vm, Obj* coll);
+
+/* ----- reduced ----- */
+ReducedObj* reducedobj_new(VM* vm, Value val);
+
+/* ----- record ----- */
+ShapeObj*  shapeobj_new(VM* vm, SymbolObj* name, int count);
+RecordObj* recordobj_new(VM* vm, ShapeObj* shape); // slots nil
+int        recordobj_slot(VM* vm, RecordObj* r, Value key); // -1 unless key is a field
+bool       recordobj_get(VM* vm, RecordObj* r, Value key, Value* value);
+RecordObj* recordobj_clone(VM* vm, RecordObj* r);
+MapObj*    recordobj_toMap(VM* vm, RecordObj* r);
 
 /* ----- func ----- */
 FuncObj* funcobj_new(VM* vm, FuncPtr func);
@@ -234,8 +655,8 @@ FuncObj* funcobj_clone(VM* vm, FuncObj* other);
 
 /* ----- env ----- */
 EnvObj* envobj_new(VM* vm, EnvObj* outer);
-bool    envobj_set(EnvObj* e, Value key, Value value);
-bool    envobj_get(EnvObj* e, Value key, Value* value);
+bool    envobj_set(VM* vm, EnvObj* e, Value key, Value value);
+bool    envobj_get(VM* vm, EnvObj* e, Value key, Value* value);
 
 /* ----- closure ----- */
 ClosureObj* closureobj_new(VM* vm, EnvObj* outer, Value params, Value body);
@@ -244,14 +665,30 @@ Value       closureobj_invoke(VM* vm, ClosureObj* cobj,
                               ExceptionObj** exception);
 ClosureObj* closureobj_clone(VM* vm, ClosureObj* other);
 
+void  callback_init(Callback* cb, Value fn);
+Value callback_call(VM* vm, Callback* cb, int len, Value* args, ExceptionObj** exception);
+
+/* ----- xform ----- */
+XformObj* xformobj_new(VM* vm, int count);
+XformObj* xformobj_running(VM* vm, XformObj* xf);
+Callback* xformobj_initCallbacks(XformObj* xf, Callback* inlineCbs);
+void      xformobj_freeCallbacks(XformObj* xf, Callback* cbs);
+bool      xformobj_apply(VM* vm, XformObj* xf, Callback* cbs, Value* item, bool* done,
+                         ExceptionObj** exception);
+
 /* ----- atom ----- */
 AtomObj* atomobj_new(VM* vm, Value ref);
 
 /* ----- exception ----- */
 ExceptionObj* exceptionobj_new(VM* vm, const char* fmt, ...);
 
-ValueArray* obj_listLikeGetArr(Obj* obj);
-ValueArray* value_listLikeGetArr(Value v);
+bool value_realize(VM* vm, Value v, ExceptionObj** exception);
+
+int  value_listLikeCount(Value v);
+bool value_listLikeGet(Value v, int index, Value* out);
+void value_iterInit(Value v, SeqIter* iter);
+bool value_nextRun(VM* vm, Value src, int index, int max, SeqRun* run, ExceptionObj** exception);
+bool seqiter_next(SeqIter* iter, Value* v);
 
 Value obj_invoke(VM* vm, Obj* obj, int len, Value* args, ExceptionObj** exception);
 Value value_invoke(VM* vm, Value value, int len, Value* args, ExceptionObj** exception);
@@ -294,6 +731,8 @@ Value value_meta(Value value);
 #define value_mapWithArr(vm, len, arr)    (value_obj(mapobj_newWithArr((vm), (len), (arr))))
 #define value_mapWithEmpty(vm)            (value_obj(mapobj_new((vm), 0)))
 
+#define value_setWithArr(vm, len, arr)    (value_obj(setobj_newWithArr((vm), (len), (arr))))
+
 #define value_func(vm, func)              (value_obj(funcobj_new((vm), (func))))
 
 #define value_closure(vm, env, params, body) (value_obj(closureobj_new((vm), (env), (params), (body))))
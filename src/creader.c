@@ -181,6 +181,17 @@ static Token scanner_scanToken(Scanner* s)
             // ~
             return scanner_makeToken(s);
 
+        case '#':
+            // #{
+            if (scanner_match(s, '{'))
+                return scanner_makeToken(s);
+
+            // symbol starting with #
+            while (!scanner_isAtEnd(s) && !isIllegalSymbol(scanner_peek(s)))
+                scanner_next(s);
+
+            return scanner_makeToken(s);
+
         // special single character
         case '[':
         case ']':
@@ -207,19 +218,15 @@ static Token scanner_scanToken(Scanner* s)
     }
 }
 
-static Array scanner_tokenize(Scanner* s, const char* source)
+static TokenVec scanner_tokenize(Scanner* s, const char* source)
 {
-    Array _;
-    Array* tokens = &_;
-    ARR_INIT(tokens, Token);
+    TokenVec tokens;
+    tokenvec_init(&tokens);
 
     while (!scanner_isAtEnd(s))
-    {
-        Token t = scanner_scanToken(s);
-        array_push(tokens, &t);
-    }
+        tokenvec_push(&tokens, scanner_scanToken(s));
 
-    return *tokens;
+    return tokens;
 }
 
 /* ----- end scanner ----- */
@@ -245,38 +252,34 @@ void token_print(Token* t)
 
 /* ----- reader ----- */
 
-void reader_init(Reader* r, Array tokens)
+void reader_init(Reader* r, TokenVec tokens)
 {
     r->position = 0;
     r->tokens = tokens;
+    valuevec_init(&r->items);
 }
 
 void reader_free(Reader* r)
 {
     r->position = 0;
-    array_free(&r->tokens);
+    tokenvec_free(&r->tokens);
+    valuevec_free(&r->items);
 }
 
 Token reader_prev(Reader* r)
 {
-    Token ret;
-    array_get(&r->tokens, r->position - 1, &ret);
-    return ret;
+    return tokenvec_get(&r->tokens, r->position - 1);
 }
 
 Token reader_next(Reader* r)
 {
     r->position++;
-    Token ret;
-    array_get(&r->tokens, r->position - 1, &ret);
-    return ret;
+    return tokenvec_get(&r->tokens, r->position - 1);
 }
 
 Token reader_peek(Reader* r)
 {
-    Token ret;
-    array_get(&r->tokens, r->position, &ret);
-    return ret;
+    return tokenvec_get(&r->tokens, r->position);
 }
 
 bool reader_isAtEnd(Reader* r)
@@ -297,14 +300,30 @@ static bool tokenMatch(Token* t, const char* expectedString, const int len)
 static Value readList(VM* vm, Reader* r);
 static Value readVector(VM* vm, Reader* r);
 static Value readMap(VM* vm, Reader* r);
+static Value readSet(VM* vm, Reader* r);
 static Value readAtom(VM* vm, Reader* r);
 static Value readForm(VM* vm, Reader* r);
 
-static Value readList(VM* vm, Reader* r)
+/* reads forms up to close onto r->items, where the ones of enclosing colls wait, returns where they start */
+static size_t readItems(VM* vm, Reader* r, char close, ErrorCode errorCode)
 {
-    static Value s_listItemBuf[LIST_MAX_ITEM_COUNT];
-    static int s_listItemBufIdx = 0;
+    size_t start = r->items.count;
+    while (*reader_peek(r).start != close)
+    {
+        Value item = readForm(vm, r);
+        valuevec_push(&r->items, item);
+
+        if (reader_isAtEnd(r))
+        {
+            reportReaderError(r, reader_prev(r), errorCode);
+        }
+    }
+
+    return start;
+}
 
+static Value readList(VM* vm, Reader* r)
+{
     // consume '('
     reader_next(r);
 
@@ -324,38 +343,19 @@ static Value readList(VM* vm, Reader* r)
         return ret;
     }
 
-    int listItemBuffStart = s_listItemBufIdx;
-    int listItemBuffCurr = listItemBuffStart;
-
-    while (*reader_peek(r).start != ')')
-    {
-        s_listItemBufIdx = listItemBuffCurr + 1;
-        s_listItemBuf[listItemBuffCurr] = readForm(vm, r);
-        listItemBuffCurr++;
-
-        if (reader_isAtEnd(r))
-        {
-            reportReaderError(r, reader_prev(r), EC_NoMatchRightParen);
-        }
-    }
-
-    s_listItemBufIdx = listItemBuffStart;
+    size_t start = readItems(vm, r, ')', EC_NoMatchRightParen);
 
     // consume ')'
     reader_next(r);
 
-    Value ret = value_listWithArr(vm,
-                                  listItemBuffCurr - listItemBuffStart, 
-                                  s_listItemBuf + listItemBuffStart);
+    Value ret = value_listWithArr(vm, (int)(r->items.count - start), r->items.data + start);
+    r->items.count = start;
     VM_CPUSHV(ret);
     return ret;
 }
 
 static Value readVector(VM* vm, Reader* r)
 {
-    static Value s_vectorItemBuf[LIST_MAX_ITEM_COUNT];
-    static int s_vectorItemBufIdx = 0;
-
     // consume '['
     reader_next(r);
 
@@ -375,38 +375,19 @@ static Value readVector(VM* vm, Reader* r)
         return ret;
     }
 
-    int listItemBuffStart = s_vectorItemBufIdx;
-    int listItemBuffCurr = listItemBuffStart;
-
-    while (*reader_peek(r).start != ']')
-    {
-        s_vectorItemBufIdx = listItemBuffCurr + 1;
-        s_vectorItemBuf[listItemBuffCurr] = readForm(vm, r);
-        listItemBuffCurr++;
-
-        if (reader_isAtEnd(r))
-        {
-            reportReaderError(r, reader_prev(r), EC_NoMatchRightSquareBracket);
-        }
-    }
-
-    s_vectorItemBufIdx = listItemBuffStart;
+    size_t start = readItems(vm, r, ']', EC_NoMatchRightSquareBracket);
 
     // consume ']'
     reader_next(r);
 
-    Value ret = value_vectorWithArr(vm,
-                                    listItemBuffCurr - listItemBuffStart, 
-                                    s_vectorItemBuf + listItemBuffStart);
+    Value ret = value_vectorWithArr(vm, (int)(r->items.count - start), r->items.data + start);
+    r->items.count = start;
     VM_CPUSHV(ret);
     return ret;
 }
 
 static Value readMap(VM* vm, Reader* r)
 {
-    static Value s_mapItemBuf[LIST_MAX_ITEM_COUNT];
-    static int s_mapItemBufIdx = 0;
-
     // consume '{'
     reader_next(r);
 
@@ -426,29 +407,34 @@ static Value readMap(VM* vm, Reader* r)
         return ret;
     }
 
-    int listItemBuffStart = s_mapItemBufIdx;
-    int listItemBuffCurr = listItemBuffStart;
+    size_t start = readItems(vm, r, '}', EC_NoMatchRightCurlyBracket);
 
-    while (*reader_peek(r).start != '}')
-    {
-        s_mapItemBufIdx = listItemBuffCurr + 1;
-        s_mapItemBuf[listItemBuffCurr] = readForm(vm, r);
-        listItemBuffCurr++;
+    // consume '}'
+    reader_next(r);
 
-        if (reader_isAtEnd(r))
-        {
-            reportReaderError(r, reader_prev(r), EC_NoMatchRightCurlyBracket);
-        }
+    Value ret = value_mapWithArr(vm, (int)(r->items.count - start), r->items.data + start);
+    r->items.count = start;
+    VM_CPUSHV(ret);
+    return ret;
+}
+
+static Value readSet(VM* vm, Reader* r)
+{
+    // consume '#{'
+    reader_next(r);
+
+    if (reader_isAtEnd(r))
+    {
+        reportReaderError(r, reader_prev(r), EC_NoMatchRightCurlyBracket);
     }
 
-    s_mapItemBufIdx = listItemBuffStart;
+    size_t start = readItems(vm, r, '}', EC_NoMatchRightCurlyBracket);
 
     // consume '}'
     reader_next(r);
 
-    Value ret = value_mapWithArr(vm,
-                                 listItemBuffCurr - listItemBuffStart, 
-                                 s_mapItemBuf + listItemBuffStart);
+    Value ret = value_setWithArr(vm, (int)(r->items.count - start), r->items.data + start);
+    r->items.count = start;
     VM_CPUSHV(ret);
     return ret;
 }
@@ -472,7 +458,7 @@ static Value readAtom(VM* vm, Reader* r)
     }
     else if (*t->start == ':') // keyworld
     {
-        StrObj* obj = strobj_copy(vm, t->start, t->len);
+        StrObj* obj = strobj_intern(vm, t->start, t->len);
         VM_CPUSH(obj);
         Value ret = value_keywordWithStr(vm, obj);
         VM_CPUSHV(ret);
@@ -512,7 +498,7 @@ static Value readAtom(VM* vm, Reader* r)
             }
         }
 
-        StrObj* obj = strobj_copy(vm, chars, (int)(current - chars));
+        StrObj* obj = strobj_intern(vm, chars, (int)(current - chars));
         VM_CPUSH(obj);
         Value ret = value_obj(obj);
 
@@ -530,7 +516,7 @@ static Value readAtom(VM* vm, Reader* r)
     }
 
     // symbol
-    StrObj* obj = strobj_copy(vm, t->start, t->len);
+    StrObj* obj = strobj_intern(vm, t->start, t->len);
     VM_CPUSH(obj);
     Value ret = value_symbolWithStr(vm, obj);
     VM_CPUSHV(ret);
@@ -566,6 +552,12 @@ static Value readForm(VM* vm, Reader* r)
     case '{':
         return readMap(vm, r);
 
+    case '#':
+        if (t.len == 2 && t.start[1] == '{')
+            return readSet(vm, r);
+
+        return readAtom(vm, r);
+
     case '\'':
         EXPAND_TO("quote", 5);
 
@@ -641,16 +633,12 @@ Value readStr(VM* vm, const char* source)
     if (errorCode == 0)
     {
         scanner_init(&scanner, source);
-        const Array tokens = scanner_tokenize(&scanner, source);
+        const TokenVec tokens = scanner_tokenize(&scanner, source);
 
 #if DEBUG_TOKEN
         RLOG_DEBUG("---- tokens ----\n");
         for (size_t i = 0; i < tokens.count; i++)
-        {
-            Token t;
-            array_get(&tokens, i, &t);
-            token_print(&t);
-        }
+            token_print(&tokens.data[i]);
         RLOG_DEBUG("---------------\n\n");
 #endif
 
@@ -693,6 +681,10 @@ Value readStr(VM* vm, const char* source)
             default:
                 break;
         }
+
+        // a reader error leaves the tokens and the items of the open colls
+        if (errorCode != EC_NoMatchQuote)
+            reader_free(&reader);
         
         ret = value_none();
     }
@@ -11,16 +11,19 @@ typedef struct sToken
     int         line;
 } Token;
 
+DEFINE_VEC(TokenVec, Token, tokenvec)
+
 typedef struct sReader
 {
-    Array tokens;
-    int   position;
-    Token errorToken;
+    TokenVec tokens;
+    int      position;
+    Token    errorToken;
+    ValueVec items; // forms read so far of the colls still open
 } Reader;
 
 void  token_print(Token* t);
 
-void  reader_init(Reader* r, Array tokens);
+void  reader_init(Reader* r, TokenVec tokens);
 void  reader_free(Reader* r);
 
 Token reader_next(Reader* r);
@@ -2,14 +2,18 @@
 
 uint32_t hash(char* bytes, int length)
 {
-    uint32_t hash = 2166136261u;
+    return hashContinue(HASH_INIT, bytes, length);
+}
+
+uint32_t hashContinue(uint32_t h, char* bytes, int length)
+{
     for (int i = 0; i < length; i++)
     {
-        hash ^= bytes[i];
-        hash *= 16777619;
+        h ^= bytes[i];
+        h *= 16777619;
     }
 
-    return hash;
+    return h;
 }
 
 bool readFile(const char* path, char** content, int* size)
@@ -4,8 +4,10 @@
 #include "ccommon.h"
 
 #define HASH(bytes, len) hash((char*)((bytes)), len)
+#define HASH_INIT        2166136261u
 
 uint32_t hash(char* bytes, int length);
+uint32_t hashContinue(uint32_t h, char* bytes, int length); // hash of pieces, starting from HASH_INIT
 
 bool readFile(const char* path, /* out */ char** content, /* out */ int* fileSize);
 
@@ -112,6 +112,97 @@ bool value_eq(VM* vm, Value a, Value b)
     return false;
 }
 
+/* rank of the values that have an order, -1 for the rest */
+static int compareRank(Value v)
+{
+    if (value_isNil(v))
+        return 0;
+    if (value_isBool(v))
+        return 1;
+    if (value_isNum(v))
+        return 2;
+    if (value_isStr(v))
+        return 3;
+    if (value_isKeyword(v))
+        return 4;
+    if (value_isSymbol(v))
+        return 5;
+    if (value_isVector(v))
+        return 6;
+    return -1;
+}
+
+/**
+ * Default order of sorted colls: nil, booleans, numbers, strings, keywords,
+ * symbols, vectors, each kind among itself by value. Shorter vectors come
+ * first, vectors of one length compare item by item.
+ */
+bool value_compare(Value a, Value b, int* out)
+{
+    int rank = compareRank(a);
+    int brank = compareRank(b);
+    if (rank < 0 || brank < 0)
+        return false;
+
+    if (rank != brank)
+    {
+        *out = rank < brank ? -1 : 1;
+        return true;
+    }
+
+    switch (rank)
+    {
+    case 0:
+        *out = 0;
+        return true;
+
+    case 1:
+        *out = value_asBool(a) == value_asBool(b) ? 0 : (value_asBool(a) ? 1 : -1);
+        return true;
+
+    case 2:
+        *out = value_asNum(a) < value_asNum(b) ? -1 : (value_asNum(a) > value_asNum(b) ? 1 : 0);
+        return true;
+
+    case 3:
+        *out = strobj_compare(value_asStr(a), value_asStr(b));
+        return true;
+
+    case 4:
+        *out = strobj_compare(value_asKeyword(a)->keyword, value_asKeyword(b)->keyword);
+        return true;
+
+    case 5:
+        *out = strobj_compare(value_asSymbol(a)->symbol, value_asSymbol(b)->symbol);
+        return true;
+
+    default:
+    {
+        VectorObj* va = value_asVector(a);
+        VectorObj* vb = value_asVector(b);
+        if (va->count != vb->count)
+        {
+            *out = va->count < vb->count ? -1 : 1;
+            return true;
+        }
+
+        for (int i = 0; i < va->count; i++)
+        {
+            Value ia, ib;
+            vectorobj_get(va, i, &ia);
+            vectorobj_get(vb, i, &ib);
+            if (!value_compare(ia, ib, out))
+                return false;
+            if (*out != 0)
+                return true;
+        }
+
+        *out = 0;
+        return true;
+    }
+    }
+}
+
 void value_print(Value v)
 {
     if (value_isNil(v))
@@ -157,8 +248,7 @@ bool value_isPair(Value v)
 {
     if (value_isListLike(v))
     {
-        ValueArray* va = value_listLikeGetArr(v);
-        return va && va->count > 0;
+        return value_listLikeCount(v) > 0;
     }
 
     return false;
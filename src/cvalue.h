@@ -2,6 +2,7 @@
 #define __C_VALUE_H_
 
 #include "ccommon.h"
+#include "cvec.h"
 
 typedef enum
 {
@@ -22,6 +23,8 @@ struct sValue
     } as;
 };
 
+DEFINE_VEC(ValueVec, Value, valuevec)
+
 #define value_none()    VAL_NONE
 #define value_nil()     VAL_NIL
 #define value_bool(b)   (b ? VAL_TRUE : VAL_FALSE)
@@ -44,6 +47,7 @@ struct sValue
 uint32_t        value_hash(Value v);
 struct sStrObj* value_toStr(VM* vm, Value v, bool readably);
 bool            value_eq(VM* vm, Value a, Value b);
+bool            value_compare(Value a, Value b, int* out); // false if a and b have no order
 
 void            value_print(Value v);
 
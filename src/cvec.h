@@ -0,0 +1,65 @@
+#ifndef __C_VEC_H_
+#define __C_VEC_H_
+
+#include "ccommon.h"
+
+#define VEC_INIT_CAPACITY 8
+
+/**
+ * Growable array of one element type. DEFINE_VEC(Name, T, prefix) declares
+ * Name and inline prefix_init, _free, _reserve, _push, _pop, _top, _get,
+ * _set and _clear. Unlike rlib's Array the element size is known where it's
+ * used, so an access is a plain load or store rather than a call copying
+ * elemSize bytes. Only _push and _reserve grow; indices are the caller's to
+ * keep in range, _pop and _top need a non empty vec.
+ */
+#define DEFINE_VEC(Name, T, prefix) \
+    typedef struct \
+    { \
+        T*     data; \
+        size_t count; \
+        size_t capacity; \
+    } Name; \
+    \
+    static inline void prefix##_init(Name* v) \
+    { \
+        v->data = NULL; \
+        v->count = 0; \
+        v->capacity = 0; \
+    } \
+    \
+    static inline void prefix##_free(Name* v) \
+    { \
+        if (v->data) \
+            FREE_ARRAY(T, v->data, v->capacity); \
+        prefix##_init(v); \
+    } \
+    \
+    static inline void prefix##_reserve(Name* v, size_t capacity) \
+    { \
+        if (capacity <= v->capacity) \
+            return; \
+        size_t newCapacity = v->capacity < VEC_INIT_CAPACITY ? VEC_INIT_CAPACITY : v->capacity; \
+        while (newCapacity < capacity) \
+            newCapacity *= 2; \
+        v->data = (T*)reallocate(v->data, sizeof(T) * v->capacity, sizeof(T) * newCapacity); \
+        v->capacity = newCapacity; \
+    } \
+    \
+    static inline void prefix##_push(Name* v, T item) \
+    { \
+        if (v->count == v->capacity) \
+            prefix##_reserve(v, v->count + 1); \
+        v->data[v->count++] = item; \
+    } \
+    \
+    static inline T    prefix##_pop(Name* v)                 { return v->data[--v->count]; } \
+    static inline T    prefix##_top(const Name* v)           { return v->data[v->count - 1]; } \
+    static inline T    prefix##_get(const Name* v, size_t i) { return v->data[i]; } \
+    static inline void prefix##_set(Name* v, size_t i, T item) { v->data[i] = item; } \
+    static inline void prefix##_clear(Name* v)               { v->count = 0; }
+
+DEFINE_VEC(ObjPtrVec, Obj*, objvec)
+DEFINE_VEC(IntVec, int, intvec)
+
+#endif // __C_VEC_H_
@@ -6,6 +6,7 @@
 #include "cobj.h"
 #include "ccorelib.h"
 #include "cmem.h"
+#include "cutils.h"
 
 #define EXPAND_TO(chars, len, secondValue) \
     Value symbol = value_symbol(vm, (chars), (len)); \
@@ -13,6 +14,18 @@
     Value ret = value_list(vm, 2, symbol, (secondValue)); \
     VM_POPV(symbol)
 
+#ifdef GC_SCAN_STACK
+// the outermost entry marks where the vm's part of the c stack begins
+#define ENTER_STACK_SCOPE(vm) \
+    bool __outermost = (vm)->stackBottom == NULL; \
+    if (__outermost) (vm)->stackBottom = CSTACK_FRAME_ADDR()
+#define LEAVE_STACK_SCOPE(vm) \
+    if (__outermost) (vm)->stackBottom = NULL
+#else
+#define ENTER_STACK_SCOPE(vm)
+#define LEAVE_STACK_SCOPE(vm)
+#endif
+
 static Value   READ(VM* vm, const char* input);
 static Value   EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception);
 static StrObj* PRINT(VM* vm, Value value);
@@ -22,7 +35,7 @@ Value evalAst(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
     if (value_isSymbol(value))
     {
         Value ret;
-        if (envobj_get(env, value, &ret))
+        if (envobj_get(vm, env, value, &ret))
         {
             return ret;
         }
@@ -36,24 +49,26 @@ Value evalAst(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
     else if (value_isList(value))
     {
         ListObj* listObj = value_asList(value);
-        int len = listObj->items.count;
 
-        ListObj* retList = listobj_newWithNil(vm, len);
-        VM_PUSH(retList);
+        // the result is contiguous, callers pass its items as args
+        ListObj* retList = listobj_newWithNil(vm, listObj->count);
+        VM_SPUSH(retList);
+
+        SeqIter iter;
+        value_iterInit(value, &iter);
 
         Value temp;
-        for (size_t i = 0; i < len; i++)
+        for (size_t i = 0; seqiter_next(&iter, &temp); i++)
         {
-            listobj_get(listObj, i, &temp);
             listobj_set(retList, i, EVAL(vm, temp, env, exception));
             if (HAS_EXCEPTION())
             {
-                VM_POP(retList); // retList
+                VM_SPOP(retList); // retList
                 return value_none();
             }
         }
 
-        VM_POP(retList); // retList
+        VM_SPOP(retList); // retList
         return value_obj(retList);
     }
 
@@ -74,11 +89,10 @@ static Value quasiquote(VM* vm, Value listArg)
     }
     else
     {
-        ValueArray* va = value_listLikeGetArr(listArg);
-        VALUE_ARR_GET_CHILD(va, 0, quasiFirstValue);
+        LISTLIKE_GET_CHILD(listArg, 0, quasiFirstValue);
         if (value_symbolIs(quasiFirstValue, "unquote"))
         {
-            VALUE_ARR_GET_CHILD(va, 1, quasiSecondValue);
+            LISTLIKE_GET_CHILD(listArg, 1, quasiSecondValue);
             return quasiSecondValue;
         }
         else
@@ -87,26 +101,21 @@ static Value quasiquote(VM* vm, Value listArg)
             {
                 if (value_isPair(quasiFirstValue))
                 {
-                    ValueArray* va2 = value_listLikeGetArr(quasiFirstValue);
-                    VALUE_ARR_GET_CHILD(va2, 0, quasiChildFirstValue);
+                    LISTLIKE_GET_CHILD(quasiFirstValue, 0, quasiChildFirstValue);
 
                     if (value_symbolIs(quasiChildFirstValue, "splice-unquote"))
                     {
                         Value sv = value_symbol(vm, "concat", 6);
                         VM_PUSHV(sv);
 
-                        VALUE_ARR_GET_CHILD(va2, 1, quasiSecondValue);
-
-                        Value remainValue = value_listWithArr(vm,
-                                                              va->count - 1,
-                                                              (Value*)va->data + 1);
+                        Value remainValue = value_obj(listobj_newWithListLike(vm, listArg, 1));
                         VM_PUSHV(remainValue);
                         Value handledRemainValue = quasiquote(vm, remainValue);
                         VM_POPV(remainValue);
 
                         VM_PUSHV(handledRemainValue);
 
-                        VALUE_ARR_GET_CHILD(va2, 1, quasiChildSecondValue);
+                        LISTLIKE_GET_CHILD(quasiFirstValue, 1, quasiChildSecondValue);
                         Value ret = value_list(vm, 3, sv, quasiChildSecondValue, handledRemainValue);
 
                         VM_POPV(handledRemainValue);
@@ -122,9 +131,7 @@ static Value quasiquote(VM* vm, Value listArg)
                 Value handledQuasiFirstValue = quasiquote(vm, quasiFirstValue);
                 VM_PUSHV(handledQuasiFirstValue);
 
-                Value remainValue = value_listWithArr(vm,
-                                                      va->count - 1,
-                                                      (Value*)va->data + 1);
+                Value remainValue = value_obj(listobj_newWithListLike(vm, listArg, 1));
                 VM_PUSHV(remainValue);
                 Value handledRemainValue = quasiquote(vm, remainValue);
                 VM_POPV(remainValue);
@@ -151,7 +158,7 @@ static bool isMacroCall(VM* vm, Value v, EnvObj* env, /* out */ ClosureObj** cob
 
     LIST_GET_CHILD(value_asList(v), 0, symbolValue);
     Value funcValue;
-    if (!envobj_get(env, symbolValue, &funcValue))
+    if (!envobj_get(vm, env, symbolValue, &funcValue))
         return false;
 
     if (!value_isMacro(funcValue))
@@ -174,12 +181,13 @@ static bool macroExpand(VM* vm, Value v, EnvObj* env, ExceptionObj** exception,
     {
         expandFlag = true;
 
-        ListObj* lobj = value_asList(currentValue);
+        // forms built by other macros may share their tail, args need one array
+        ListObj* lobj = listobj_contiguous(vm, value_asList(currentValue));
         VM_PUSH(lobj);
 
         currentValue = closureobj_invoke(vm, cobj,
-                                         lobj->items.count - 1,
-                                         (Value*)lobj->items.data + 1,
+                                         lobj->count - 1,
+                                         listobj_items(lobj) + 1,
                                          exception);
 
         VM_POP(lobj); // lobj
@@ -197,6 +205,17 @@ static bool macroExpand(VM* vm, Value v, EnvObj* env, ExceptionObj** exception,
 
 static int s_EvalDepth = 0;
 
+/* turns a limit hit by an allocation into an exception, the vm stays usable */
+void vm_raiseMemoryError(VM* vm, ExceptionObj** exception)
+{
+    if (vm->memoryError == VM_MEM_HEAP_LIMIT)
+        THROW("MemoryError: heap limit of %ld bytes exceeded", vm->config.heapLimit);
+    else
+        THROW("MemoryError: allocation budget exceeded");
+
+    vm->memoryError = VM_MEM_OK;
+}
+
 Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
 {
 #define SYMBOL_IS(str) (strcmp(sobj->symbol->chars, str) == 0)
@@ -210,19 +229,19 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
         for (int i = gcTraceArr.count - 1; i >= 0; i--) \
         { \
             /*RLOG_ERROR("EEEE POP------------------------------ %d", s_EvalDepth);*/ \
-            array_get(&gcTraceArr, i, &o); \
+            o = objvec_get(&gcTraceArr, i); \
             VM_POP(o); \
         } \
         /*RLOG_ERROR("EEEE RETURN------------------------------ %d", s_EvalDepth);*/ \
         s_EvalDepth--; \
-        array_free(&gcTraceArr); \
+        objvec_free(&gcTraceArr); \
         vm->currentEnv = oldEnv; /* restore current env */ \
         vm->callDepth--; \
         for (int i = 0; i < closureNum; i++) \
         { \
-            array_pop(&vm->closureStackIdx, NULL); \
-            array_pop(&vm->closureStackCallDepth, NULL); \
-            array_pop(&vm->closureStack, NULL); \
+            intvec_pop(&vm->closureStackIdx); \
+            intvec_pop(&vm->closureStackCallDepth); \
+            objvec_pop(&vm->closureStack); \
         } \
         return (__ret); \
     } while (false)
@@ -236,9 +255,9 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
         vm->callDepth--; \
         for (int i = 0; i < closureNum; i++) \
         { \
-            array_pop(&vm->closureStackIdx, NULL); \
-            array_pop(&vm->closureStackCallDepth, NULL); \
-            array_pop(&vm->closureStack, NULL); \
+            intvec_pop(&vm->closureStackIdx); \
+            intvec_pop(&vm->closureStackCallDepth); \
+            objvec_pop(&vm->closureStack); \
         } \
         /*RLOG_ERROR("EEEE RETURN------------------------------ %d", s_EvalDepth);*/ \
         s_EvalDepth--; \
@@ -255,8 +274,8 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
     int blockStackCount = 0;
 
 #if DEBUG_TRACE_GC
-    Array gcTraceArr;
-    ARR_INIT(&gcTraceArr, Obj*);
+    ObjPtrVec gcTraceArr;
+    objvec_init(&gcTraceArr);
 #endif
 
     s_EvalDepth++;
@@ -271,6 +290,13 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
 
     for(;;)
     {
+        if (vm->memoryError != VM_MEM_OK)
+        {
+            vm_raiseMemoryError(vm, exception);
+            RETURN_VALUE(value_none());
+        }
+
+#ifndef GC_SCAN_STACK
         if (vm->currentEnv != env)
         {
             vm->currentEnv = env;
@@ -278,7 +304,7 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
             blockStackCount++;
 
 #if DEBUG_TRACE_GC
-            array_push(&gcTraceArr, &env);
+            objvec_push(&gcTraceArr, (Obj*)env);
 #endif
 
             // RLOG_ERROR("EEEE PUSH------------------------------ %d", s_EvalDepth);
@@ -290,7 +316,7 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
             blockStackCount++;
 
 #if DEBUG_TRACE_GC
-            array_push(&gcTraceArr, &value_asObj(value));
+            objvec_push(&gcTraceArr, value_asObj(value));
 #endif
 
             // if (value_isList(value))
@@ -301,13 +327,33 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
 
             // RLOG_ERROR("EEEE PUSH------------------------------ %d", s_EvalDepth);
         }
-        
+#else
+        // env and value stay alive in this frame, the collector finds them on the stack
+        vm->currentEnv = env;
+#endif
+
+        // forms built by lazy fns (map over code) evaluate as the list they realize to
+        if (value_isLazySeq(value))
+        {
+            if (!lazyseqobj_force(vm, value_asLazySeq(value), exception))
+                RETURN_VALUE(value_none());
+
+            value = value_obj(listobj_newWithListLike(vm, value, 0));
+            goto CONTINUE_LOOP;
+        }
+
+        // so do the seqs rest and seq give of a vector
+        if (value_isSlice(value) && !value_asSlice(value)->isVector)
+        {
+            value = value_obj(listobj_newWithListLike(vm, value, 0));
+            goto CONTINUE_LOOP;
+        }
 
         if (value_isList(value))
         {
             ListObj* lobj = value_asList(value);
 
-            if (lobj->items.count == 0)
+            if (lobj->count == 0)
             {
                 DTRACE(vm, "EVAL list count is 0, return value");
 
@@ -338,7 +384,10 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                             value = EVAL(vm, value, env, exception);
 
                             if (!HAS_EXCEPTION())
-                                envobj_set(env, key, value);
+                            {
+                                envobj_set(vm, env, key, value);
+                                CWRITE_BARRIER(vm, env->data);
+                            }
 
                             RETURN_VALUE(value);
                         }
@@ -346,31 +395,34 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                         {
                             DTRACE(vm, "EVAL let*");
 
-                            if (lobj->items.count != 3)
+                            if (lobj->count != 3)
                             {
                                 THROW("RuntimeError: let* must have binding list and body");
                                 RETURN_VALUE(value_none());
                             }
 
                             EnvObj* newEnv = envobj_new(vm, env);
-                            VM_PUSH(newEnv);
+                            VM_SPUSH(newEnv);
 
                             LIST_GET_CHILD(lobj, 1, bindingList);
 
-                            ValueArray* itemArray = value_listLikeGetArr(bindingList);
-                            for (size_t i = 0; i < itemArray->count; i = i + 2)
+                            SeqIter iter;
+                            value_iterInit(bindingList, &iter);
+
+                            Value key;
+                            while (seqiter_next(&iter, &key))
                             {
-                                VALUE_ARR_GET_CHILD(itemArray, i, key);
-                                VALUE_ARR_GET_CHILD(itemArray, i + 1, value);
+                                Value value = value_nil();
+                                seqiter_next(&iter, &value);
                                 value = EVAL(vm, value, newEnv, exception);
 
                                 if (!HAS_EXCEPTION())
                                 {
-                                    envobj_set(newEnv, key, value);
+                                    envobj_set(vm, newEnv, key, value);
                                 }
                                 else
                                 {
-                                    VM_POP(newEnv); // newEnv
+                                    VM_SPOP(newEnv); // newEnv
                                     RETURN_VALUE(value_none());
                                 }
                             }
@@ -378,7 +430,7 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                             LIST_GET_CHILD(lobj, 2, statements);
                             value = statements;
                             env = newEnv;
-                            VM_POP(newEnv); // newEnv
+                            VM_SPOP(newEnv); // newEnv
 
                             goto CONTINUE_LOOP;
                         }
@@ -386,11 +438,11 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                         {
                             DTRACE(vm, "EVAL do");
 
-                            if (lobj->items.count == 1)
+                            if (lobj->count == 1)
                                 RETURN_VALUE(value_nil());
                             else
                             {
-                                for (int i = 1; i < lobj->items.count - 1; i++)
+                                for (int i = 1; i < lobj->count - 1; i++)
                                 {
                                     LIST_GET_CHILD(lobj, i, child);
                                     EVAL(vm, child, env, exception);
@@ -399,11 +451,78 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                                         RETURN_VALUE(value_none());
                                 }
 
-                                LIST_GET_CHILD(lobj, lobj->items.count - 1, child);
+                                LIST_GET_CHILD(lobj, lobj->count - 1, child);
                                 value = child;
                                 goto CONTINUE_LOOP;
                             }
                         }
+                        else if (SYMBOL_IS("with-arena"))
+                        {
+                            DTRACE(vm, "EVAL with-arena");
+
+                            vm_beginArena(vm);
+
+                            Value ret = value_nil();
+                            for (int i = 1; i < lobj->count; i++)
+                            {
+                                LIST_GET_CHILD(lobj, i, child);
+                                ret = EVAL(vm, child, env, exception);
+
+                                if (HAS_EXCEPTION())
+                                    break;
+                            }
+
+                            // not a tail call, the arena must end after the body
+                            ret = vm_endArena(vm, ret, exception);
+
+                            if (HAS_EXCEPTION())
+                                RETURN_VALUE(value_none());
+
+                            RETURN_VALUE(ret);
+                        }
+                        else if (SYMBOL_IS("with-budget"))
+                        {
+                            DTRACE(vm, "EVAL with-budget");
+
+                            if (lobj->count < 2)
+                            {
+                                THROW("RuntimeError: with-budget must have a budget");
+                                RETURN_VALUE(value_none());
+                            }
+
+                            LIST_GET_CHILD(lobj, 1, budgetValue);
+                            Value budget = EVAL(vm, budgetValue, env, exception);
+
+                            if (HAS_EXCEPTION())
+                                RETURN_VALUE(value_none());
+
+                            if (!value_isNum(budget) || value_asNum(budget) < 0
+                                || value_asNum(budget) >= (double)SIZE_MAX)
+                            {
+                                THROW("RuntimeError: with-budget budget is not a byte count");
+                                RETURN_VALUE(value_none());
+                            }
+
+                            size_t oldCeiling = vm_beginBudget(vm, (size_t)value_asNum(budget));
+
+                            Value ret = value_nil();
+                            for (int i = 2; i < lobj->count; i++)
+                            {
+                                LIST_GET_CHILD(lobj, i, child);
+                                ret = EVAL(vm, child, env, exception);
+
+                                if (HAS_EXCEPTION())
+                                    break;
+                            }
+
+                            // not a tail call, the budget must end after the body
+                            ret = vm_endBudget(vm, oldCeiling, ret, exception);
+
+                            if (HAS_EXCEPTION())
+                                RETURN_VALUE(value_none());
+
+                            RETURN_VALUE(ret);
+                        }
                         else if (SYMBOL_IS("if"))
                         {
                             DTRACE(vm, "EVAL if");
@@ -416,7 +535,7 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
 
                             if (value_false(condRet))
                             {
-                                if (lobj->items.count == 4)
+                                if (lobj->count == 4)
                                     listobj_get(lobj, 3, &value);
                                 else
                                     value = value_nil();
@@ -476,7 +595,8 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
 
                             Value ret = value_obj(funcClone);
                             LIST_GET_CHILD(lobj, 1, key);
-                            envobj_set(env, key, ret);
+                            envobj_set(vm, env, key, ret);
+                            CWRITE_BARRIER(vm, env->data);
                             RETURN_VALUE(ret);
                         }
                         else if (SYMBOL_IS("macroexpand"))
@@ -499,15 +619,14 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                                 if (!HAS_EXCEPTION())
                                     break;
 
-                                if (lobj->items.count < 3)
+                                if (lobj->count < 3)
                                     break;
 
                                 LIST_GET_CHILD(lobj, 2, catchBody);
                                 if (!value_isPair(catchBody))
                                     break;
 
-                                ValueArray* catchArr = value_listLikeGetArr(catchBody);
-                                VALUE_ARR_GET_CHILD(catchArr, 0, catchSymbol);
+                                LISTLIKE_GET_CHILD(catchBody, 0, catchSymbol);
 
                                 if (value_symbolIs(catchSymbol, "catch*"))
                                 {
@@ -522,11 +641,11 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                                     VM_POP(*exception); // *exception
                                     VM_PUSH(newEnv);
 
-                                    VALUE_ARR_GET_CHILD(catchArr, 1, exceptionVar);
+                                    LISTLIKE_GET_CHILD(catchBody, 1, exceptionVar);
 
-                                    envobj_set(newEnv, exceptionVar, value_obj(*exception));
+                                    envobj_set(vm, newEnv, exceptionVar, value_obj(*exception));
 
-                                    VALUE_ARR_GET_CHILD(catchArr, 2, handleBody);
+                                    LISTLIKE_GET_CHILD(catchBody, 2, handleBody);
 
                                     *exception = NULL;
 
@@ -574,34 +693,35 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                     if (value_isClosure(funcValue))
                     {
                         ClosureObj* cobj = value_asClosure(funcValue);
-                        int len = funcListObj->items.count - 1;
-                        Value* args = (Value*)funcListObj->items.data + 1;
+                        int len = funcListObj->count - 1;
+                        Value* args = listobj_items(funcListObj) + 1;
 
                         EnvObj* newEnv = envobj_new(vm, cobj->env);
                         VM_PUSH(newEnv);
 
                         // binding args
-                        ValueArray* paramsArr = value_listLikeGetArr(cobj->params);
-                        for (size_t i = 0; i < paramsArr->count; i++)
-                        {
-                            VALUE_ARR_GET_CHILD(paramsArr, i, paramValue);
+                        SeqIter iter;
+                        value_iterInit(cobj->params, &iter);
 
+                        Value paramValue;
+                        for (size_t i = 0; seqiter_next(&iter, &paramValue); i++)
+                        {
                             // variable arguments
                             if (value_isSymbol(paramValue)
                                 && strobj_eq(value_asSymbol(paramValue)->symbol, "&", 1))
                             {
-                                array_get(paramsArr, i + 1, &paramValue);
+                                seqiter_next(&iter, &paramValue);
 
                                 if (i < len)
                                 {
                                     ListObj* varArgObj = listobj_newWithArr(vm,
                                                                             len - i,
                                                                             args + i);
-                                    envobj_set(newEnv, paramValue, value_obj(varArgObj));
+                                    envobj_set(vm, newEnv, paramValue, value_obj(varArgObj));
                                 }
                                 else
                                 {
-                                    envobj_set(newEnv, paramValue, value_nil());
+                                    envobj_set(vm, newEnv, paramValue, value_nil());
                                 }
 
                                 break;
@@ -610,11 +730,11 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                             if (i < len)
                             {
                                 Value argValue = args[i];
-                                envobj_set(newEnv, paramValue, argValue);
+                                envobj_set(vm, newEnv, paramValue, argValue);
                             }
                             else
                             {
-                                envobj_set(newEnv, paramValue, value_nil());
+                                envobj_set(vm, newEnv, paramValue, value_nil());
                             }
                         }
 
@@ -631,17 +751,13 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                             {
                                 int index = vm->closureStack.count - 1;
                                 
-                                ClosureObj* topCobj;
-                                array_get(&vm->closureStack, index, &topCobj);
-
-                                int callDepth;
-                                array_get(&vm->closureStackCallDepth, index, &callDepth);
+                                ClosureObj* topCobj = (ClosureObj*)objvec_get(&vm->closureStack, index);
+                                int callDepth = intvec_get(&vm->closureStackCallDepth, index);
 
                                 // tail recur
                                 if (vm->callDepth == callDepth && topCobj == cobj)
                                 {
-                                    int stackIndex;
-                                    array_get(&vm->closureStackIdx, index, &stackIndex);
+                                    int stackIndex = intvec_get(&vm->closureStackIdx, index);
                                     
                                     while (vm->rtblockArray.count > stackIndex)
                                     {
@@ -654,9 +770,9 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                             }
 
                             closureNum++;
-                            array_push(&vm->closureStackIdx, &vm->rtblockArray.count);
-                            array_push(&vm->closureStackCallDepth, &vm->callDepth);
-                            array_push(&vm->closureStack, &cobj);
+                            intvec_push(&vm->closureStackIdx, (int)vm->rtblockArray.count);
+                            intvec_push(&vm->closureStackCallDepth, vm->callDepth);
+                            objvec_push(&vm->closureStack, (Obj*)cobj);
                         } while (false);
 
                         goto CONTINUE_LOOP;
@@ -664,8 +780,8 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                     else
                     {
                         Value ret = value_invoke(vm, funcValue,
-                                                 funcListObj->items.count - 1,
-                                                 (Value*)funcListObj->items.data + 1,
+                                                 funcListObj->count - 1,
+                                                 listobj_items(funcListObj) + 1,
                                                  exception);
 
                         VM_POPV(funcListValue);
@@ -674,6 +790,12 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
                         if (value_isNone(ret))
                             RETURN_VALUE(ret);
 
+                        if (vm->memoryError != VM_MEM_OK)
+                        {
+                            vm_raiseMemoryError(vm, exception);
+                            RETURN_VALUE(value_none());
+                        }
+
                         RETURN_VALUE(ret);
                     }
                 } while (false);
@@ -682,9 +804,9 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
         else if (value_isVector(value))
         {
             VectorObj* vobj = value_asVector(value);
-            int len = vobj->items.count;
+            int len = vobj->count;
             VectorObj* ret = vectorobj_newWithNil(vm, len);
-            VM_PUSH(ret);
+            VM_SPUSH(ret);
 
             Value temp;
             for (size_t i = 0; i < len; i++)
@@ -694,12 +816,12 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
 
                 if (HAS_EXCEPTION())
                 {
-                    VM_POP(ret); // ret
+                    VM_SPOP(ret); // ret
                     RETURN_VALUE(value_none());
                 }
             }
 
-            VM_POP(ret); // ret
+            VM_SPOP(ret); // ret
             RETURN_VALUE(value_obj(ret));
         }
         else if (value_isMap(value))
@@ -707,35 +829,66 @@ Value EVAL(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
             MapObj* oldMap = value_asMap(value);
 
             MapObj* newMap = mapobj_new(vm, 0);
-            VM_PUSH(newMap);
-
-            int len = oldMap->table.count;
+            VM_SPUSH(newMap);
 
-            uint32_t* keys = CALLOCATE(vm, uint32_t, len);
-            table_keys(&oldMap->table, keys);
+            MapIter iter;
+            mapobj_iterInit(oldMap, &iter);
 
-            MapObjEntry entry;
-            for (size_t i = 0; i < len; i++)
+            Value key, oldValue;
+            while (mapobj_iterNext(&iter, &key, &oldValue))
             {
-                table_get(&oldMap->table, keys[i], &entry);
-                Value newValue = EVAL(vm, entry.value, env, exception);
+                Value newValue = EVAL(vm, oldValue, env, exception);
 
                 if (HAS_EXCEPTION())
                 {
-                    CFREE_ARRAY(vm, uint32_t, keys, len);
-                    VM_POP(newMap); // newMap
+                    VM_SPOP(newMap); // newMap
                     RETURN_VALUE(value_none());
                 }
 
-                MapObjEntry newEntry = {entry.key, newValue};
-                table_set(&newMap->table, keys[i], &newEntry);
+                mapobj_set(vm, newMap, key, newValue);
             }
 
-            CFREE_ARRAY(vm, uint32_t, keys, len);
-            VM_POP(newMap); // newMap
+            VM_SPOP(newMap); // newMap
 
             RETURN_VALUE(value_obj(newMap));
         }
+        else if (value_isSet(value))
+        {
+            MapObj* oldMap = value_asSet(value)->map;
+
+            MapObj* newMap = mapobj_new(vm, 0);
+            VM_SPUSH(newMap);
+
+            MapIter iter;
+            mapobj_iterInit(oldMap, &iter);
+
+            Value oldItem;
+            while (mapobj_iterNext(&iter, &oldItem, NULL))
+            {
+                Value newItem = EVAL(vm, oldItem, env, exception);
+
+                // hashed by its items
+                if (!HAS_EXCEPTION())
+                {
+                    VM_PUSHV(newItem);
+                    value_realize(vm, newItem, exception);
+                    VM_POPV(newItem);
+                }
+
+                if (HAS_EXCEPTION())
+                {
+                    VM_SPOP(newMap); // newMap
+                    RETURN_VALUE(value_none());
+                }
+
+                mapobj_set(vm, newMap, newItem, newItem);
+            }
+
+            SetObj* newSet = setobj_new(vm, newMap);
+            VM_SPOP(newMap); // newMap
+
+            RETURN_VALUE(value_obj(newSet));
+        }
 
         RETURN_VALUE(evalAst(vm, value, env, exception));
 
@@ -751,26 +904,94 @@ StrObj* PRINT(VM* vm, Value value)
     return printReadablyStr(vm, value);
 }
 
+static void configFromEnv(const char* name, size_t* out)
+{
+    const char* str = getenv(name);
+    if (str == NULL || *str == '\0')
+        return;
+
+    char* end;
+    double num = strtod(str, &end);
+    if (end == str || num < 0)
+        return;
+
+    // allow a k/m/g suffix
+    switch (*end)
+    {
+    case 'k': case 'K': num *= 1024; break;
+    case 'm': case 'M': num *= 1024 * 1024; break;
+    case 'g': case 'G': num *= 1024 * 1024 * 1024; break;
+    }
+
+    *out = (size_t)num;
+}
+
+/*
+ * cconfig.h defaults, overridden by CLISP_GC_MIN_HEAP, CLISP_GC_MAX_HEAP,
+ * CLISP_HEAP_LIMIT and CLISP_GC_PERCENT
+ */
+void vm_defaultConfig(VMConfig* config)
+{
+    config->gcMinHeap = GC_MIN_HEAP;
+    config->gcMaxHeap = GC_MAX_HEAP;
+    config->heapLimit = GC_HEAP_LIMIT;
+    config->gcTargetPercent = GC_TARGET_PERCENT;
+
+    configFromEnv("CLISP_GC_MIN_HEAP", &config->gcMinHeap);
+    configFromEnv("CLISP_GC_MAX_HEAP", &config->gcMaxHeap);
+    configFromEnv("CLISP_HEAP_LIMIT", &config->heapLimit);
+
+    const char* percent = getenv("CLISP_GC_PERCENT");
+    if (percent != NULL && atof(percent) > 0)
+        config->gcTargetPercent = (float)atof(percent);
+}
+
+void vm_setConfig(VM* vm, const VMConfig* config)
+{
+    vm->config = *config;
+    cpaceGC(vm);
+}
+
 VM* vm_create()
+{
+    return vm_createWithConfig(NULL);
+}
+
+VM* vm_createWithConfig(const VMConfig* config)
 {
     VM* vm = ALLOCATE(VM, 1);
     vm->env = NULL;
     vm->currentEnv = NULL;
 
     vm->callDepth = 0;
-    ARR_INIT(&vm->closureStackIdx, int);
-    ARR_INIT(&vm->closureStackCallDepth, int);
-    ARR_INIT(&vm->closureStack, ClosureObj*);
+    intvec_init(&vm->closureStackIdx);
+    intvec_init(&vm->closureStackCallDepth);
+    objvec_init(&vm->closureStack);
 
     /* init gc */
-    vm->objs = NULL;
+    cheap_init(&vm->heap);
     vm->bytesAllocated = 0;
-    vm->nextGC = 1024 * 1024;
-    ARR_INIT(&vm->grayObjArray, Obj*);
-    ARR_INIT(&vm->cmBlockArray, Obj*);
-    ARR_INIT(&vm->rtblockArray, Obj*);
+    vm->bytesAllocatedTotal = 0;
+    vm->gcGrowth = GC_INIT_GROWTH;
+    vm->lastGCEnd = clock();
+    cheap_initArena(&vm->arena);
+    vm->arenaDepth = 0;
+    objvec_init(&vm->arenaRemembered);
+    vm->arenaTracing = false;
+    vm->budgetCeiling = 0;
+    vm->memoryError = VM_MEM_OK;
+    if (config != NULL)
+        vm->config = *config;
+    else
+        vm_defaultConfig(&vm->config);
+    cpaceGC(vm);
+    objvec_init(&vm->grayObjArray);
+    objvec_init(&vm->cmBlockArray);
+    objvec_init(&vm->rtblockArray);
+    vm->stackBottom = NULL;
+    vm->compactRequested = false;
 
-    TABLE_INIT(&vm->strings, StrObj*);
+    cintern_init(&vm->strings);
 
     vm->env = envobj_new(vm, NULL);
     vm->currentEnv = vm->env;
@@ -786,6 +1007,15 @@ VM* vm_create()
     // define load file
     vm_rep(vm, "(def! load-file (fn* [f] (eval (read-string (str \"(do \" (slurp f) \"\nnil)\")))))");
 
+    // define lazy-seq
+    vm_rep(vm, "(defmacro! lazy-seq (fn* [& body] (list 'lazy-seq* (cons 'fn* (cons [] body)))))");
+
+    // define comp, transducers are joined natively
+    vm_rep(vm, "(def! comp (fn* [& fs] (let* [xf (apply xform-comp* fs)] (if xf xf (reduce (fn* [g f] (fn* [& args] (g (apply f args)))) fs)))))");
+
+    // define defrecord, ->Name builds records of one shape made at expansion
+    vm_rep(vm, "(defmacro! defrecord (fn* [name fields] (list 'def! (symbol (str \"->\" name)) (list 'fn* fields (cons 'record* (cons (record-shape* name fields) fields))))))");
+
     // define cond
     vm_rep(vm, "(defmacro! cond (fn* [& xs] (if (> (count xs) 0) (list 'if (first xs) (if (> (count xs) 1) (nth xs 1) (throw \"odd number of forms to cond\")) (cons 'cond (rest (rest xs)))))))");
 
@@ -794,35 +1024,47 @@ VM* vm_create()
 
 void vm_free(VM* vm)
 {
-    table_free(&vm->strings);
+    cintern_free(&vm->strings);
 
     vm->env = NULL;
     vm->currentEnv = NULL;
 
     vm->callDepth = 0;
-    array_free(&vm->closureStackIdx);
-    array_free(&vm->closureStackCallDepth);
-    array_free(&vm->closureStack);
+    intvec_free(&vm->closureStackIdx);
+    intvec_free(&vm->closureStackCallDepth);
+    objvec_free(&vm->closureStack);
 
-    array_free(&vm->cmBlockArray);
-    array_free(&vm->rtblockArray);
-    array_free(&vm->grayObjArray);
+    objvec_free(&vm->cmBlockArray);
+    objvec_free(&vm->rtblockArray);
+    objvec_free(&vm->arenaRemembered);
+    objvec_free(&vm->grayObjArray);
 
     ccollectGarbage(vm);
+    cheap_free(&vm->heap);
 
-    vm->objs = NULL;
     vm->bytesAllocated = 0;
     vm->nextGC = 0;
 
     FREE(VM, vm);
 }
 
+/* between top level forms nothing is evaluating, no c frame holds obj pointers */
+static void compactIfRequested(VM* vm)
+{
+    if (vm->compactRequested && vm->callDepth == 0 && vm->arenaDepth == 0)
+        ccompactHeap(vm);
+}
+
 const char* vm_rep(VM* vm, const char* input)
 {
+    compactIfRequested(vm);
+
     Value astRoot = READ(vm, input);
     if (value_isNone(astRoot))
         return "";
 
+    ENTER_STACK_SCOPE(vm);
+
     // vm_pushAstRoot(vm, astRoot);
     vm_clearBlockCmArr(vm);
 
@@ -832,6 +1074,13 @@ const char* vm_rep(VM* vm, const char* input)
     // vm_popAstRoot(vm);
     VM_PUSHV(evalRet);
 
+    // the printed result is realized in full
+    if (!exceptionPtr && !value_realize(vm, evalRet, &exceptionPtr))
+    {
+        VM_POPV(evalRet);
+        evalRet = value_none();
+    }
+
     // TODO handle exception
     if (exceptionPtr)
     {
@@ -842,19 +1091,128 @@ const char* vm_rep(VM* vm, const char* input)
 
     VM_POPV(evalRet);
 
-    return ret == NULL ? "" : ret->chars;
+    LEAVE_STACK_SCOPE(vm);
+
+    return ret == NULL ? "" : strobj_cstr(vm, ret);
 }
 
 Value vm_eval(VM* vm, Value value, EnvObj* env, ExceptionObj** exception)
 {
     DTRACE(vm, "vm_eval");
 
+    ENTER_STACK_SCOPE(vm);
+
     Value ret = EVAL(vm, value, env, exception);
+
+    LEAVE_STACK_SCOPE(vm);
+
     return ret;
 }
 
+/**
+ * Objs allocated until the matching vm_endArena go to an arena which is
+ * dropped at once when it ends. Arenas nest, the outermost one does the work.
+ */
+void vm_beginArena(VM* vm)
+{
+    vm->arenaDepth++;
+}
+
+/* returns ret, moved out of the arena if it was allocated there */
+Value vm_endArena(VM* vm, Value ret, ExceptionObj** exception)
+{
+    if (vm->arenaDepth == 0 || --vm->arenaDepth > 0)
+        return ret;
+
+    cleaveArena(vm, &ret, exception);
+    return ret;
+}
+
+/*
+ * Until the matching vm_endBudget at most budget more bytes may be allocated
+ * (0 for no budget), garbage collected meanwhile counts too. A nested budget
+ * can't exceed the one it runs in. Returns the ceiling vm_endBudget restores.
+ */
+size_t vm_beginBudget(VM* vm, size_t budget)
+{
+    size_t oldCeiling = vm->budgetCeiling;
+
+    if (budget > 0)
+    {
+        size_t ceiling = vm->bytesAllocatedTotal + budget;
+        if (oldCeiling == 0 || ceiling < oldCeiling)
+            vm->budgetCeiling = ceiling;
+    }
+
+    return oldCeiling;
+}
+
+/* returns ret, or none with a MemoryError if the budget ran out after the last eval step */
+Value vm_endBudget(VM* vm, size_t oldCeiling, Value ret, ExceptionObj** exception)
+{
+    // exceeded by the last step, no safe point left to raise it
+    if (vm->memoryError == VM_MEM_BUDGET)
+    {
+        if (*exception == NULL)
+        {
+            vm_raiseMemoryError(vm, exception);
+            ret = value_none();
+        }
+        vm->memoryError = VM_MEM_OK;
+    }
+
+    vm->budgetCeiling = oldCeiling;
+
+    return ret;
+}
+
+/* evaluates with a budget of at most budget bytes allocated (see vm_beginBudget) */
+Value vm_evalWithBudget(VM* vm, Value value, EnvObj* env, size_t budget, ExceptionObj** exception)
+{
+    size_t oldCeiling = vm_beginBudget(vm, budget);
+
+    Value ret = vm_eval(vm, value, env, exception);
+
+    return vm_endBudget(vm, oldCeiling, ret, exception);
+}
+
+/* evaluates the forms of (do forms...) one at a time, compacting in between when requested */
+static void runForms(VM* vm, Value forms)
+{
+    ENTER_STACK_SCOPE(vm);
+
+    vm_clearBlockCmArr(vm);
+    VM_PUSHV(forms);
+    size_t formsSlot = vm->rtblockArray.count - 1;
+    int count = value_asList(forms)->count;
+
+    for (int i = 1; i < count; i++)
+    {
+        compactIfRequested(vm);
+
+        // the forms may have moved
+        LIST_GET_CHILD((ListObj*)objvec_get(&vm->rtblockArray, formsSlot), i, form);
+
+        ExceptionObj* exceptionPtr = NULL;
+        EVAL(vm, form, vm->env, &exceptionPtr);
+        vm->currentEnv = vm->env;
+
+        if (exceptionPtr)
+        {
+            RLOG_ERROR("%s", exceptionPtr->info->chars);
+            break;
+        }
+    }
+
+    VM_POP(objvec_get(&vm->rtblockArray, formsSlot));
+
+    LEAVE_STACK_SCOPE(vm);
+}
+
 void vm_dofile(VM* vm, const char* filePath, int argc, char** argv)
 {
+    ENTER_STACK_SCOPE(vm);
+
     // set *ARGV* variable
     Value argvSymbol = value_symbol(vm, "*ARGV*", 6);
     VM_PUSHV(argvSymbol);
@@ -870,68 +1228,79 @@ void vm_dofile(VM* vm, const char* filePath, int argc, char** argv)
             listobj_set(l, i, value_str(vm, argv[i], slen));
         }
 
-        envobj_set(vm->env, argvSymbol, value_obj(l));
+        envobj_set(vm, vm->env, argvSymbol, value_obj(l));
         VM_POP(l); // l
     }
     else
     {
-        envobj_set(vm->env, argvSymbol, value_nil());
+        envobj_set(vm, vm->env, argvSymbol, value_nil());
     }
 
     VM_POPV(argvSymbol);
 
-    int cmdLen = 15 + strlen(filePath);
-    char* cmd = CALLOCATE(vm, char, cmdLen);
-    sprintf(cmd, "(load-file \"%s\")", filePath);
-    cmd[cmdLen - 1] = '\0';
+    LEAVE_STACK_SCOPE(vm);
 
-    vm_rep(vm, cmd);
+    char* content;
+    int contentSize;
+    if (!readFile(filePath, &content, &contentSize))
+        return;
 
-    CFREE_ARRAY(vm, char, cmd, cmdLen);
+    // read as one (do ...) like load-file does
+    int sourceLen = contentSize + 10;
+    char* source = CALLOCATE(vm, char, sourceLen);
+    sprintf(source, "(do %s\nnil)", content);
+    FREE_ARRAY(char, content, contentSize + 1);
+
+    Value forms = READ(vm, source);
+    CFREE_ARRAY(vm, char, source, sourceLen);
+
+    if (value_isList(forms))
+        runForms(vm, forms);
 }
 
 void vm_registerFunc(VM* vm, const char* funcName, const int nameLen, FuncPtr funcPtr)
 {
+    // setting a binding allocates map nodes, scan this frame for them
+    ENTER_STACK_SCOPE(vm);
+
     Value sv = value_symbol(vm, funcName, nameLen);
     VM_PUSHV(sv);
-    envobj_set(vm->env, sv, value_func(vm, funcPtr));
+    Value fv = value_func(vm, funcPtr);
+    VM_PUSHV(fv);
+    envobj_set(vm, vm->env, sv, fv);
+    VM_POPV(fv);
     VM_POPV(sv);
+
+    LEAVE_STACK_SCOPE(vm);
 }
 
 void vm_pushBlockCmObj(VM* vm, Obj* obj)
 {
-    array_push(&vm->cmBlockArray, &obj);
+    objvec_push(&vm->cmBlockArray, obj);
 }
 
 void vm_popBlockCmObj(VM* vm)
 {
-    array_pop(&vm->cmBlockArray, NULL);
+    objvec_pop(&vm->cmBlockArray);
 }
 
 void vm_clearBlockCmArr(VM* vm)
 {
-    array_clear(&vm->cmBlockArray);
+    objvec_clear(&vm->cmBlockArray);
 }
 
+#ifdef DEBUG_TRACE_GC
 void vm_pushBlockRtObj(VM* vm, Obj* obj)
 {
-#ifdef DEBUG_TRACE_GC
     RLOG_DEBUG("++++++ RuntimeBlock Push Obj %p", obj);
     obj_print(obj);
-#endif
 
-    array_push(&vm->rtblockArray, &obj);
+    objvec_push(&vm->rtblockArray, obj);
 }
 
-#ifdef DEBUG_TRACE_GC
 void vm_popBlockRtObj(VM* vm, Obj* obj)
-#else
-void vm_popBlockRtObj(VM* vm)
-#endif
 {
-#ifdef DEBUG_TRACE_GC
-    Obj* outObj;
-    array_pop(&vm->rtblockArray, &outObj);
+    Obj* outObj = objvec_pop(&vm->rtblockArray);
     RLOG_DEBUG("++++++ RuntimeBlock Pop Obj %p", outObj);
     obj_print(outObj);
 
@@ -940,12 +1309,10 @@ void vm_popBlockRtObj(VM* vm)
         RLOG_ERROR("XXXXXX RuntimeBlock Pop Error , obj is not at stack top!!!");
         obj_print(obj);
     }
-#else
-    array_pop(&vm->rtblockArray, NULL);
-#endif
 }
+#endif
 
 void vm_clearBlockRtArr(VM* vm)
 {
-    array_clear(&vm->rtblockArray);
+    objvec_clear(&vm->rtblockArray);
 }
@@ -2,35 +2,87 @@
 #define __C_VM_H_
 
 #include <string.h>
+#include <time.h>
 
 #include "ccommon.h"
 #include "cobj.h"
+#include "cheap.h"
+#include "cintern.h"
+#include "cvec.h"
+
+typedef struct sVMConfig
+{
+    size_t gcMinHeap;       // never collect while less than this is allocated
+    size_t gcMaxHeap;       // soft cap of the gc trigger, 0 for no cap
+    size_t heapLimit;       // hard cap, exceeding it raises a MemoryError, 0 for no cap
+    float  gcTargetPercent; // share of cpu time the collector aims to use
+} VMConfig;
+
+typedef enum
+{
+    VM_MEM_OK,
+    VM_MEM_HEAP_LIMIT,  // heapLimit exceeded even after a full gc
+    VM_MEM_BUDGET,      // budget of the running vm_evalWithBudget exceeded
+} VMMemoryError;
 
 struct sVM
 {
-    Table   strings;
+    InternTable strings;
     EnvObj* env;
     EnvObj* currentEnv;
 
     int callDepth;
-    Array closureStackIdx;
-    Array closureStackCallDepth;
-    Array closureStack;
+    IntVec    closureStackIdx;
+    IntVec    closureStackCallDepth;
+    ObjPtrVec closureStack;
 
     /* ---- gc ----- */
-    Obj*        objs;           // all obj chain
+    Heap        heap;           // page heap of all objs
     size_t      bytesAllocated; // current allocated size
+    size_t      bytesAllocatedTotal; // allocated ever, frees don't lower it (budgets)
     size_t      nextGC;         // next gc size
-    ObjPtrArray grayObjArray;   // mark gray obj array
-    ObjPtrArray cmBlockArray;   // compile block array
-    ObjPtrArray rtblockArray;   // runtime block array
+    ObjPtrVec   grayObjArray;   // mark gray obj array
+    ObjPtrVec   cmBlockArray;   // compile block array
+    ObjPtrVec   rtblockArray;   // runtime block array
+    void*       stackBottom;    // c stack scanned conservatively (GC_SCAN_STACK)
+    bool        compactRequested; // compact before the next top level form (vm_rep, vm_dofile)
+    VMConfig    config;
+    float       gcGrowth;       // headroom over the live size, adapted to gcTargetPercent
+    clock_t     lastGCEnd;
+    /* ---- arena ----- */
+    HeapArena   arena;          // objs allocated inside with-arena
+    int         arenaDepth;     // nested arenas share the outermost one
+    ObjPtrVec   arenaRemembered; // objs outside the arena which got arena refs stored
+    bool        arenaTracing;   // markObj only follows arena objs
+
+    size_t      budgetCeiling;  // bytesAllocatedTotal allowed by the innermost budget, 0 for none
+    VMMemoryError memoryError;  // raised as an exception at the next eval step
 };
 
+void        vm_defaultConfig(VMConfig* config);
 VM*         vm_create();
+VM*         vm_createWithConfig(const VMConfig* config);
+void        vm_setConfig(VM* vm, const VMConfig* config);
 void        vm_free(VM* vm);
 const char* vm_rep(VM* vm, const char* input);
 Value       vm_eval(VM* vm, Value value, EnvObj* env, ExceptionObj** exception);
+Value       vm_evalWithBudget(VM* vm, Value value, EnvObj* env, size_t budget, ExceptionObj** exception);
+size_t      vm_beginBudget(VM* vm, size_t budget);
+Value       vm_endBudget(VM* vm, size_t oldCeiling, Value ret, ExceptionObj** exception);
+void        vm_beginArena(VM* vm);
+Value       vm_endArena(VM* vm, Value ret, ExceptionObj** exception);
 void        vm_dofile(VM* vm, const char* filePath, int argc, char** argv);
+void        vm_raiseMemoryError(VM* vm, ExceptionObj** exception);
+
+/* native loops don't step through EVAL, they poll this: false once a pending MemoryError is raised */
+static inline bool vm_checkMemory(VM* vm, ExceptionObj** exception)
+{
+    if (vm->memoryError == VM_MEM_OK)
+        return true;
+
+    vm_raiseMemoryError(vm, exception);
+    return false;
+}
 
 #define     VM_REGISTER_FUNC(vm, funcName, funcPtr) \
     vm_registerFunc((vm), (funcName), (strlen((funcName))), (funcPtr))
@@ -42,11 +94,13 @@ void        vm_pushBlockCmObj(VM* vm, Obj* obj);
 void        vm_popBlockCmObj(VM* vm);
 void        vm_clearBlockCmArr(VM* vm);
 
-void        vm_pushBlockRtObj(VM* vm, Obj* obj);
 #ifdef DEBUG_TRACE_GC
+void        vm_pushBlockRtObj(VM* vm, Obj* obj);
 void        vm_popBlockRtObj(VM* vm, Obj* obj);
 #else
-void        vm_popBlockRtObj(VM* vm);
+// every VM_PUSH / VM_POP, inline
+static inline void vm_pushBlockRtObj(VM* vm, Obj* obj) { objvec_push(&vm->rtblockArray, obj); }
+static inline void vm_popBlockRtObj(VM* vm)            { vm->rtblockArray.count--; }
 #endif
 void        vm_clearBlockRtArr(VM* vm);
 
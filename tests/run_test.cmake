@@ -0,0 +1,22 @@
+# cmake -DCLISP=<clisp> -DSCRIPT=<file.mal> -DEXPECTED=<file.out> [-DINPUT=<stdin file>] -P run_test.cmake
+if(INPUT)
+    set(INPUT_ARGS INPUT_FILE ${INPUT})
+endif()
+
+execute_process(
+    COMMAND ${CLISP} ${SCRIPT}
+    ${INPUT_ARGS}
+    OUTPUT_VARIABLE ACTUAL
+    ERROR_VARIABLE ACTUAL
+    RESULT_VARIABLE RESULT
+)
+
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "${SCRIPT} exited with ${RESULT}\n${ACTUAL}")
+endif()
+
+file(READ ${EXPECTED} EXPECTED_OUTPUT)
+
+if(NOT ACTUAL STREQUAL EXPECTED_OUTPUT)
+    message(FATAL_ERROR "${SCRIPT} output differs from ${EXPECTED}\n--- expected\n${EXPECTED_OUTPUT}\n--- actual\n${ACTUAL}")
+endif()